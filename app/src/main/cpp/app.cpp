@@ -1,6 +1,8 @@
 #include <stereokit.h>
 #include <stereokit_ui.h>
 #include <random>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <time.h>
 #include <opencv2/opencv.hpp>
@@ -16,21 +18,32 @@
 #include "mavlink/mavlink.h"
 
 #include "VideoDecoder.h"
+#include "convert/YUVConverter.h"
+#include "helper/FramePacer.hpp"
 #include "Helpers.h"
 //#include "VideoDecoder.cpp"
 #include <chrono>
+#include <mutex>
 #include <android_native_app_glue.h>
 
 // Define a tag for logging
 using namespace sk;
 using namespace std::chrono;
-WfbngLink wfb;
+// Created by the wfb thread once the adapters are open, read by the render and input threads. Take a copy with
+// wfbLink() instead of using it directly
+std::mutex wfb_mutex;
+std::shared_ptr<WfbngLink> wfb;
+std::shared_ptr<WfbngLink> wfbLink() {
+    std::lock_guard<std::mutex> lock(wfb_mutex);
+    return wfb;
+}
 JNIEnv* env = nullptr;
 JavaVM* lJavaVM = nullptr;
 
 pose_t plane_pose = {{0.13, -0.01,-2.0f}, {0,0,0,1}};
 
-int32_t rtl8812UsbPath(JNIEnv* env,struct android_app *app);
+// Opens every attached adapter, one fd each
+std::vector<int32_t> rtl8812UsbFds(JNIEnv* env,struct android_app *app);
 std::string copyGsKey(JNIEnv * env, android_app *app);
 
 #define NANOS_IN_SECOND 1000000000
@@ -39,35 +52,28 @@ static long currentTimeInNanos() {
     clock_gettime(CLOCK_MONOTONIC, &res);
     return (res.tv_sec * NANOS_IN_SECOND) + res.tv_nsec;
 }
-JNIEXPORT void JNICALL Java_com_geehe_fpvue_1xr_NativeRecorder_startRecordingNative(JNIEnv* env, jobject thiz) {
-    // Récupérer la classe ScreenRecordingService
-    jclass serviceClass = env->FindClass("com/geehe/fpvue_xr/ScreenRecordingService");
-    if (serviceClass == NULL) {
-        //__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "ScreenRecordingService class not found");
-        return;
-    }
-    // Récupérer la méthode statique startRecordingStatic() : signature "()V"
-    jmethodID startMethod = env->GetStaticMethodID(serviceClass, "startRecordingStatic", "()V");
-    if (startMethod == NULL) {
-        //__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "startRecordingStatic method not found");
-        return;
-    }
-
+// Ground recording (VideoPlayer::groundRecorder) runs while video is received, unless disabled through NativeRecorder.
+// The recorder itself is only started / stopped by the render thread, see updateRecordingState(). Neither blocks, the
+// recorder's I/O thread creates and finalizes the file
+std::atomic<bool> ground_recording_enabled = true;
+std::string ground_recording_directory;
+
+extern "C" JNIEXPORT void JNICALL Java_com_geehe_fpvue_1xr_NativeRecorder_startRecordingNative(JNIEnv* env, jobject thiz) {
+    ground_recording_enabled = true;
 }
-JNIEXPORT void JNICALL Java_com_geehe_fpvue_1xr_NativeRecorder_stopRecordingNative(JNIEnv* env, jobject thiz) {
-    // Récupérer la classe ScreenRecordingService
-    jclass serviceClass = env->FindClass("com/geehe/fpvue_xr/ScreenRecordingService");
-    if (serviceClass == NULL) {
-    //    __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "ScreenRecordingService class not found");
-        return;
-    }
-    // Récupérer la méthode statique stopRecordingStatic() : signature "()V"
-    jmethodID stopMethod = env->GetStaticMethodID(serviceClass, "stopRecordingStatic", "()V");
-    if (stopMethod == NULL) {
-       // __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "stopRecordingStatic method not found");
-        return;
-    }
-
+extern "C" JNIEXPORT void JNICALL Java_com_geehe_fpvue_1xr_NativeRecorder_stopRecordingNative(JNIEnv* env, jobject thiz) {
+    ground_recording_enabled = false;
+}
+// Raw capture of the received wfb-ng frames (WfbngLink::frameRecorder) for link debugging, off by default.
+// One file per enable, also started / stopped in updateRecordingState()
+std::atomic<bool> raw_capture_enabled = false;
+// Handed to the link before it runs, outlives its restarts
+const std::shared_ptr<PcapngRecorder> raw_capture = std::make_shared<PcapngRecorder>();
+extern "C" JNIEXPORT void JNICALL Java_com_geehe_fpvue_1xr_NativeRecorder_startCaptureNative(JNIEnv* env, jobject thiz) {
+    raw_capture_enabled = true;
+}
+extern "C" JNIEXPORT void JNICALL Java_com_geehe_fpvue_1xr_NativeRecorder_stopCaptureNative(JNIEnv* env, jobject thiz) {
+    raw_capture_enabled = false;
 }
 
 
@@ -77,7 +83,8 @@ std::vector<int> channels = {36, 40, 44, 48, 52, 56, 60, 64, 100, 104,
                              149, 153, 157, 161, 165, 169, 171, 173};
 int channelIndex = 0;
 
-int currentChannel;
+// Written by the input and render threads, read by the wfb thread
+std::atomic<int> currentChannel;
 
 // Video conversion
 mesh_t plane_mesh;
@@ -87,7 +94,21 @@ material_t plane_mat;
 //material_t  background_mat;
 
 tex_t vid0;
+// Decoded (still YUV) frames, handed from the decoder output thread to the render thread, which converts and uploads
+// only the one the pacer selects for the next display frame.
+// Holds up to 4 pooled buffers, which needs VideoDecoder::FrameOwnership::COPY (codec output buffers would starve the decoder)
+FramePacer<DecodedFrame> framePacer;
+// A frame rendered now is displayed this many display frames later (OpenXR frame pipelining)
+constexpr float DISPLAY_PIPELINE_FRAMES = 2.0f;
+// RGBA, as tex_format_rgba32 expects it. Only touched by the render thread
 cv::Mat buffer0;
+// Splits the rows of each frame across the render thread and one worker
+constexpr size_t YUV_CONVERTER_THREADS = 2;
+std::unique_ptr<YUVConverter> yuvConverter;
+// The per-frame latency breakdown is exported here when the app is paused
+std::string frameLatencyExportPath;
+// ASYNCHRONOUS never blocks the receiving thread waiting for a decoder input buffer
+constexpr VideoDecoder::Mode DECODER_MODE = VideoDecoder::Mode::SYNCHRONOUS;
 
 // Screen size
 float screen_width = 3.0;
@@ -95,12 +116,28 @@ float screen_width = 3.0;
 //float background_aspect_ratio = 9.0/16.0;
 //float screen_height = 3.0;
 float screen_aspect_ratio = 9.0 / 16.0;
+// The texture is only as large as the plane can show: its angular width times what the panel resolves
+constexpr float DISPLAY_PIXELS_PER_DEGREE = 25.0f;
+// Digital zoom (>=1) into the center of the video, right thumbstick up / down
+float video_zoom = 1.0f;
+constexpr float MAX_VIDEO_ZOOM = 4.0f;
 
 // Video stats
 int32_t video_width = 0;
 int32_t video_height = 0;
 int framerate = 0;
 int screen_refresh_rate = 0;
+// Video frames uploaded / skipped without being converted during the last fps_log_interval
+int video_frames_displayed = 0;
+int video_frames_dropped = 0;
+FramePacer<DecodedFrame>::Stats last_pacer_stats;
+// Frames the decryption / FEC worker could not keep up with, logged when it grows
+uint64_t last_worker_dropped = 0;
+// With several adapters, what each one received / contributed first during the last fps_log_interval
+RadioReceiver::DiversityStats last_diversity_stats;
+// Conversion time and bytes through tex_set_colors during the current fps_log_interval
+double video_convert_ms = 0;
+uint64_t video_upload_bytes = 0;
 
 
 int rssi = WFB_PACKET_DATA;
@@ -108,8 +145,6 @@ int rssi = WFB_PACKET_DATA;
 bool no_adapter = 0;
 int decoded_frame_period = 0;
 
-float DecodingInfo::avgDecodingTime_ms = 0.0f;
-float DecodingInfo::currentKiloBitsPerSecond = 0.0f;
 
 time_point decoded_period_start = steady_clock::now();
 time_point<steady_clock> last_frame_time = steady_clock::now();
@@ -120,13 +155,20 @@ duration fps_log_interval = std::chrono::seconds(1);
 
 struct mavlink_data mavlink_data;
 
-void onNewFrame(const uint8_t *data, const std::size_t data_length, int32_t width, int32_t height) {
-    video_width = width;
-    video_height = height;
-    cv::Mat yuv(height + height / 2, width, CV_8UC1, const_cast<uint8_t *>(data)); //
+VideoPlayer* videoPlayer = nullptr;
 
-    cv::cvtColor(yuv, buffer0, cv::COLOR_YUV2BGRA_NV21);
-    displayed_frame_period = displayed_frame_period + 1;
+// Texture width for the plane at its current distance. Rounded up to 64 pixels such that small head movements
+// do not re-allocate the texture
+int32_t targetTextureWidth() {
+    const float distance = std::max(0.1f, vec3_distance(plane_pose.position, input_head()->position));
+    const float angularWidth = 2.0f * atanf(screen_width * 0.5f / distance) * 180.0f / (float) M_PI;
+    return ((int32_t) (angularWidth * DISPLAY_PIXELS_PER_DEGREE) + 63) & ~63;
+}
+
+void onNewFrame(const DecodedFrame &frame) {
+    // The decoder already released its output buffer, frame.data is a pooled copy (VideoDecoder::FrameOwnership::COPY).
+    // Conversion happens on the render thread, for the frames it actually displays
+    framePacer.onFrameDecoded(frame, frame.pts);
 
     decoded_frame_period++;
     auto now = steady_clock::now();
@@ -156,6 +198,16 @@ bool app_init(struct android_app *state) {
 
 
 
+    yuvConverter = std::make_unique<YUVConverter>(YUV_CONVERTER_THREADS);
+    // Video decoding. Created before StereoKit and the wifi adapter, so the decoder can be configured from
+    // the cached parameter sets while those are initialised.
+    videoPlayer = new VideoPlayer(onNewFrame, DECODER_MODE);
+    videoPlayer->prewarmDecoder(state->activity->internalDataPath, WfbngLink::DEFAULT_LINK_ID);
+    if (state->activity->externalDataPath != nullptr) {
+        frameLatencyExportPath = std::string(state->activity->externalDataPath) + "/frame_latency.csv";
+        ground_recording_directory = state->activity->externalDataPath;
+    }
+
     if (!sk_init(settings)) {
         return false;
     }
@@ -166,16 +218,26 @@ bool app_init(struct android_app *state) {
         return false;
     }
 
-    auto fd = rtl8812UsbPath(env, state);
+    auto fds = rtl8812UsbFds(env, state);
 
 
-    if (fd > 0) {
-        std::thread wfb_thread([&fd, key_path]() {
-            WfbngLink wfb(env, fd, key_path.c_str());
-
-            ::wfb = std::move(wfb);
-            while (true)
-                ::wfb.run(env, currentChannel);
+    if (!fds.empty()) {
+        // Several adapters are received as one (diversity)
+        std::thread wfb_thread([fds, key_path]() {
+            const auto link = std::make_shared<WfbngLink>(env, fds, key_path.c_str());
+            link->scanChannels.assign(channels.begin(), channels.end());
+            link->frameRecorder = raw_capture;
+            {
+                std::lock_guard<std::mutex> lock(wfb_mutex);
+                wfb = link;
+            }
+            int channel = currentChannel;
+            while (true) {
+                link->run(env, channel);
+                // Restarts on the channel the scanner locked onto, or the one the user retuned to
+                channel = link->getChannel();
+                currentChannel = channel;
+            }
         });
         wfb_thread.detach();
     } else {
@@ -210,12 +272,7 @@ bool app_init(struct android_app *state) {
     tex_set_address(vid0, tex_address_clamp);
     material_set_texture(plane_mat, "diffuse", vid0);
 
-    auto *p = new VideoPlayer(std::bind(onNewFrame,
-                                        std::placeholders::_1,
-                                        std::placeholders::_2,
-                                        std::placeholders::_3,
-                                        std::placeholders::_4));
-    p->start();
+    videoPlayer->start();
     return true;
 }
 
@@ -230,11 +287,44 @@ void app_handle_cmd(android_app *evt_app, int32_t cmd) {
         case APP_CMD_TERM_WINDOW:
             sk_set_window(nullptr);
             break;
+        case APP_CMD_PAUSE:
+            if (videoPlayer != nullptr && !frameLatencyExportPath.empty()) {
+                videoPlayer->videoDecoder.getFrameLatencyTracker().exportCSV(frameLatencyExportPath);
+            }
+            break;
     }
 }
 
 
 
+// Keeps the adapter, firmware and aggregators running. If the link is not running (yet) the wfb thread restarts it
+// on currentChannel
+void retuneWfb() {
+    const auto link = wfbLink();
+    if (link && !link->retune(currentChannel)) {
+        link->stop(env);
+    }
+}
+
+// Follows the channel the scanner locked onto, such that the volume keys continue from there
+uint64_t lastScanLogged = 0;
+void updateScanState() {
+    const auto link = wfbLink();
+    if (!link) return;
+    const auto stats = link->getScanStats();
+    if (stats.state != ChannelScanner::State::LOCKED || stats.channel == 0) return;
+    const auto it = std::find(channels.begin(), channels.end(), stats.channel);
+    if (it != channels.end()) {
+        channelIndex = (int) (it - channels.begin());
+        currentChannel = stats.channel;
+    }
+    if (stats.nScans != lastScanLogged) {
+        lastScanLogged = stats.nScans;
+        __android_log_print(ANDROID_LOG_DEBUG, "ChannelScanner", "Locked onto channel %d in %lldms (%llu empty scans)",
+                            stats.channel, (long long) stats.lastTimeToLock.count(), (unsigned long long) stats.nEmptyScans);
+    }
+}
+
 int32_t handle_input(struct android_app *app, AInputEvent *event) {
 
 
@@ -242,62 +332,66 @@ int32_t handle_input(struct android_app *app, AInputEvent *event) {
         AKeyEvent_getKeyCode(event) == AKEYCODE_VOLUME_UP) {
         channelIndex = (channelIndex + 1) % channels.size();
         currentChannel = channels[channelIndex];
-        wfb.stop(env);
+        retuneWfb();
 
         return 1;
     }
     if (AInputEvent_getType(event) == AINPUT_EVENT_TYPE_KEY &&
         AKeyEvent_getKeyCode(event) == AKEYCODE_VOLUME_DOWN) {        // Attacher le thread courant pour obtenir un JNIEnv*
-        channelIndex = (channelIndex - 1) % channels.size();
+        channelIndex = (channelIndex + channels.size() - 1) % channels.size();
         currentChannel = channels[channelIndex];
-        wfb.stop(env);
+        retuneWfb();
         return 1;
     }
 
     return 0;
 }
 
-// Variable globale pour suivre l'état de l'enregistrement
-
-
-// Fonction pour mettre à jour l'état d'enregistrement en fonction du bitrate actuel
-void updateRecordingState(JNIEnv* env) {
-   static bool recordingActive = false;
-
-    // Si le bitrate est > 0 et que l'enregistrement n'est pas encore démarré
-    if (DecodingInfo::currentKiloBitsPerSecond > 0 && !recordingActive) {
-        // Trouver la classe ScreenRecordingService
-        jclass serviceClass = env->FindClass("com/geehe/fpvue_xr/ScreenRecordingService");
-        if (!serviceClass) {
-            __android_log_print(ANDROID_LOG_ERROR, "ScreenRecordingService", "Classe ScreenRecordingService introuvable");
-            return;
-        }
-        // Récupérer la méthode statique startRecordingStatic()
-        jmethodID startRecordingMethod = env->GetStaticMethodID(serviceClass, "startRecordingStatic", "()V");
-        if (!startRecordingMethod) {
-            __android_log_print(ANDROID_LOG_ERROR, "ScreenRecordingService", "Méthode startRecordingStatic non trouvée");
-            return;
+// Once per fps_log_interval: records while the stream is live, a new file each time the stream (re-)starts
+void updateRecordingState() {
+    if (videoPlayer == nullptr || ground_recording_directory.empty()) {
+        return;
+    }
+    GroundRecorder &recorder = videoPlayer->groundRecorder;
+    const bool record = ground_recording_enabled && DecodingInfo::currentKiloBitsPerSecond > 0;
+    if (record && !recorder.isRecording()) {
+        recorder.start(GroundRecorder::createFileName(ground_recording_directory, true));
+    } else if (!record && recorder.isRecording()) {
+        recorder.stop();
+    }
+    if (recorder.isRecording()) {
+        const auto stats = recorder.getStats();
+        if (stats.openErrno != 0) {
+            __android_log_print(ANDROID_LOG_ERROR, "GroundRecorder", "Cannot create recording %s", strerror(stats.openErrno));
+            recorder.stop();
+            ground_recording_enabled = false;
+        } else {
+            __android_log_print(ANDROID_LOG_DEBUG, "GroundRecorder", "%.1fMB written, %.0fMB/s write throughput, dropped NALUs %llu, write errors %llu",
+                                stats.nBytesWritten / (1024.0 * 1024.0), stats.writeMBytesPerSecond,
+                                (unsigned long long) stats.nNALUsDropped, (unsigned long long) stats.nWriteErrors);
         }
-        // Appeler la méthode statique
-        env->CallStaticVoidMethod(serviceClass, startRecordingMethod);
-        __android_log_print(ANDROID_LOG_INFO, "ScreenRecordingService", "Enregistrement démarré");
-        recordingActive = true;
     }
-        // Si le bitrate est égal à 0 et que l'enregistrement est en cours
-    else if (DecodingInfo::currentKiloBitsPerSecond == 0 && recordingActive) {
-        jclass serviceClass = env->FindClass("com/geehe/fpvue_xr/ScreenRecordingService");
-        if (!serviceClass) {
-            __android_log_print(ANDROID_LOG_ERROR, "ScreenRecordingService", "Classe ScreenRecordingService introuvable");
-            return;
+    PcapngRecorder &capture = *raw_capture;
+    if (raw_capture_enabled && !capture.isRecording()) {
+        const auto fileName = PcapngRecorder::createFileName(ground_recording_directory);
+        if (!capture.start(fileName)) {
+            __android_log_print(ANDROID_LOG_ERROR, "WfbCapture", "Cannot start %s %s", fileName.c_str(), strerror(errno));
+            raw_capture_enabled = false;
         }
-        jmethodID stopRecordingMethod = env->GetStaticMethodID(serviceClass, "stopRecordingStatic", "()V");
-        if (!stopRecordingMethod) {
-            __android_log_print(ANDROID_LOG_ERROR, "ScreenRecordingService", "Méthode stopRecordingStatic non trouvée");
-            return;
+    } else if (!raw_capture_enabled && capture.isRecording()) {
+        capture.stop();
+    }
+    if (capture.isRecording()) {
+        const auto stats = capture.getStats();
+        if (stats.openErrno != 0) {
+            __android_log_print(ANDROID_LOG_ERROR, "WfbCapture", "Cannot create capture %s", strerror(stats.openErrno));
+            capture.stop();
+            raw_capture_enabled = false;
+        } else {
+            __android_log_print(ANDROID_LOG_DEBUG, "WfbCapture", "%.1fMB written, frames %llu, dropped frames %llu, write errors %llu",
+                                stats.nBytesWritten / (1024.0 * 1024.0), (unsigned long long) stats.nFramesRecorded,
+                                (unsigned long long) stats.nFramesDropped, (unsigned long long) stats.nWriteErrors);
         }
-        env->CallStaticVoidMethod(serviceClass, stopRecordingMethod);
-        __android_log_print(ANDROID_LOG_INFO, "ScreenRecordingService", "Enregistrement arrêté");
-        recordingActive = false;
     }
 }
 
@@ -310,8 +404,85 @@ void app_step() {
             screen_refresh_rate = displayed_frame_period;
             displayed_period_start = now;
             displayed_frame_period = 0;
+            const auto pacerStats = framePacer.getStats();
+            video_frames_displayed = (int) (pacerStats.nDisplayed - last_pacer_stats.nDisplayed);
+            video_frames_dropped = (int) (pacerStats.nSkipped - last_pacer_stats.nSkipped);
+            if (video_frames_displayed > 0) {
+                const auto decodeToUpload = framePacer.decodeToUpload.takeIntervalSnapshot();
+                const auto uploadToDisplay = framePacer.uploadToDisplay.takeIntervalSnapshot();
+                __android_log_print(ANDROID_LOG_DEBUG, "VideoTexture",
+                                    "%dx%d zoom %.2f convert avg %.2fms upload %.1fMB/s decode->upload p50 %.2fms p99 %.2fms upload->display p50 %.2fms"
+                                    " late %d duplicated %d skipped %d",
+                                    video_width, video_height, video_zoom, video_convert_ms / video_frames_displayed,
+                                    video_upload_bytes / (1024.0 * 1024.0), decodeToUpload.getPercentile_ms(50),
+                                    decodeToUpload.getPercentile_ms(99), uploadToDisplay.getPercentile_ms(50),
+                                    (int) (pacerStats.nLate - last_pacer_stats.nLate),
+                                    (int) (pacerStats.nDuplicated - last_pacer_stats.nDuplicated), video_frames_dropped);
+            }
+            last_pacer_stats = pacerStats;
+            video_convert_ms = 0;
+            video_upload_bytes = 0;
+            updateRecordingState();
+            updateScanState();
+            const auto link = wfbLink();
+            const auto workerStats = link ? link->getWorkerStats() : RxFrameWorker::Stats{};
+            if (workerStats.nDropped != last_worker_dropped) {
+                last_worker_dropped = workerStats.nDropped;
+                __android_log_print(ANDROID_LOG_WARN, "WfbRxWorker", "queued %zu max %zu/%zu dropped %llu",
+                                    workerStats.occupancy, workerStats.maxOccupancy, RxFrameWorker::N_BUFFERS,
+                                    (unsigned long long) workerStats.nDropped);
+            }
+            const auto diversityStats = link ? link->getDiversityStats() : RadioReceiver::DiversityStats{};
+            if (diversityStats.nDuplicates > last_diversity_stats.nDuplicates) {
+                std::string adapters;
+                for (size_t i = 0; i < RxInfo::MAX_ADAPTERS; i++) {
+                    const auto &adapter = diversityStats.adapters[i];
+                    const auto &last = last_diversity_stats.adapters[i];
+                    if (adapter.nFrames <= last.nFrames) continue;
+                    RadioReceiver::AdapterStats interval{adapter.nFrames - last.nFrames, adapter.nFirst - last.nFirst, adapter.rssiSum - last.rssiSum};
+                    adapters += " #" + std::to_string(i) + " " + std::to_string(interval.nFrames) + " frames " +
+                                std::to_string(interval.nFirst) + " first " + std::to_string((int) interval.getRssiAvg()) + "dBm";
+                }
+                __android_log_print(ANDROID_LOG_DEBUG, "Diversity", "duplicates %llu%s",
+                                    (unsigned long long) (diversityStats.nDuplicates - last_diversity_stats.nDuplicates), adapters.c_str());
+            }
+            last_diversity_stats = diversityStats;
+        }
 
+        const controller_t *controller = input_controller(handed_right);
+        if (controller->tracked & button_state_active) {
+            video_zoom = std::clamp(video_zoom + controller->stick.y * time_stepf(), 1.0f, MAX_VIDEO_ZOOM);
+        }
+        // Instant replay: X on the left controller saves the last seconds of video
+        const controller_t *left_controller = input_controller(handed_left);
+        if ((left_controller->x1 & button_state_just_active) && !ground_recording_directory.empty()) {
+            videoPlayer->preRollBuffer.exportTo(GroundRecorder::createFileName(ground_recording_directory, true, "replay"));
+        }
+        // Y searches all channels for the strongest signal of the link
+        if (left_controller->x2 & button_state_just_active) {
+            if (const auto link = wfbLink()) link->scan();
+        }
 
+        // Approximation of the OpenXR predicted display time from the current frame interval
+        const auto predictedDisplay = now + duration_cast<steady_clock::duration>(
+                duration<float>(DISPLAY_PIPELINE_FRAMES * time_stepf()));
+        bool newVideoFrame = false;
+        uint64_t newVideoFramePts = 0;
+        if (auto selected = framePacer.select(predictedDisplay)) {
+            const DecodedFrame &frame = selected->payload;
+            const auto image = SemiPlanarImage::fromDecodedFrame(frame).zoomed(video_zoom);
+            // Crop and downscale happen in the same pass, never upscaled
+            video_width = std::min(image.getWidth(), targetTextureWidth());
+            video_height = std::max(2, (int32_t) ((int64_t) video_width * image.getHeight() / image.getWidth()) & ~1);
+            // Only allocates if the size changed
+            buffer0.create(video_height, video_width, CV_8UC4);
+            const auto before = steady_clock::now();
+            if (yuvConverter->convertScaled(image, buffer0.data, buffer0.step, video_width, video_height)) {
+                video_convert_ms += duration<double, std::milli>(steady_clock::now() - before).count();
+                videoPlayer->videoDecoder.getFrameLatencyTracker().mark(frame.pts, FrameLatencyTracker::CONVERTED);
+                newVideoFrame = true;
+                newVideoFramePts = frame.pts;
+            }
         }
 
 
@@ -325,7 +496,12 @@ void app_step() {
         } else {
             if (!buffer0.empty()) {
                 // ui render show video while connect
-                tex_set_colors(vid0, buffer0.cols, buffer0.rows, (void *) buffer0.datastart);
+                if (newVideoFrame) {
+                    tex_set_colors(vid0, buffer0.cols, buffer0.rows, (void *) buffer0.datastart);
+                    video_upload_bytes += buffer0.total() * buffer0.elemSize();
+                    videoPlayer->videoDecoder.getFrameLatencyTracker().mark(newVideoFramePts, FrameLatencyTracker::UPLOADED);
+                    framePacer.onUploaded(newVideoFramePts);
+                }
                 ui_handle_begin("Plane", plane_pose, mesh_get_bounds(plane_mesh), false);
                 render_add_mesh(plane_mesh, plane_mat, matrix_identity);
 
@@ -346,8 +522,18 @@ void app_step() {
         std::string txt =
                 "" + std::to_string(DecodingInfo::currentKiloBitsPerSecond) + "\t" "mbps" +
                 std::to_string(video_height) + "\t" +
+                std::to_string(video_frames_displayed) + "/" + std::to_string(framerate) + "fps" +
+                "(-" + std::to_string(video_frames_dropped) + ")\t" +
                 std::to_string(DecodingInfo::avgDecodingTime_ms) + "ms" +
                 std::to_string(currentChannel);
+        // Per antenna RSSI of the last 100ms
+        const auto link = wfbLink();
+        if (const auto signal = link ? link->signalQuality->getLatest() : std::nullopt) {
+            for (const auto &antenna : signal->antennas) {
+                if (antenna.nPackets == 0) continue;
+                txt += "\t" + std::to_string((int) antenna.rssiAvg) + "dBm/" + std::to_string((int) antenna.snrAvg) + "dB";
+            }
+        }
         text_add_at(txt.c_str(),
                     matrix_trs({-0.1, -0.52, -1.4f}, quat_identity, vec3{-1.0f, 1.0f, 1.0f}), 0,
                     text_align_bottom_center);
@@ -431,7 +617,8 @@ std::string copyGsKey(JNIEnv *env, android_app *app) {
     return destinationFilePath.str();
 }
 
-int32_t rtl8812UsbPath(JNIEnv *env, struct android_app *app) {
+std::vector<int32_t> rtl8812UsbFds(JNIEnv *env, struct android_app *app) {
+    std::vector<int32_t> fds;
 
     jclass natact = env->FindClass("android/app/NativeActivity");
     jmethodID getSystemServiceMethod = env->GetMethodID(natact, "getSystemService",
@@ -442,7 +629,7 @@ int32_t rtl8812UsbPath(JNIEnv *env, struct android_app *app) {
     env->DeleteLocalRef(usbServiceName);
     if (usbManager == nullptr) {
         __android_log_write(ANDROID_LOG_ERROR, "android_usb_devices", "UsbManager not available");
-        return -1;
+        return fds;
     }
 
     // Get device list
@@ -452,7 +639,7 @@ int32_t rtl8812UsbPath(JNIEnv *env, struct android_app *app) {
     jobject deviceListObj = env->CallObjectMethod(usbManager, getDeviceListMethod);
     if (deviceListObj == nullptr) {
         __android_log_write(ANDROID_LOG_ERROR, "android_usb_devices", "Device list is null");
-        return -1;
+        return fds;
     }
 
     // Convert Java HashMap to C++ std::map
@@ -494,6 +681,11 @@ int32_t rtl8812UsbPath(JNIEnv *env, struct android_app *app) {
         jmethodID openDeviceMethod = env->GetMethodID(usbManagerClass, "openDevice",
                                                       "(Landroid/hardware/usb/UsbDevice;)Landroid/hardware/usb/UsbDeviceConnection;");
         jobject deviceConnection = env->CallObjectMethod(usbManager, openDeviceMethod, usbDevice);
+        if (deviceConnection == nullptr) {
+            __android_log_print(ANDROID_LOG_ERROR, "android_usb_devices", "Cannot open %s",
+                                deviceNameChars);
+            continue;
+        }
 
         jclass deviceConnectionClass = env->GetObjectClass(deviceConnection);
         jmethodID getFileDescriptor = env->GetMethodID(deviceConnectionClass, "getFileDescriptor",
@@ -503,9 +695,11 @@ int32_t rtl8812UsbPath(JNIEnv *env, struct android_app *app) {
         __android_log_print(ANDROID_LOG_ERROR, "android_usb_devices", "Gof fd=%d",
                             deviceConnectionFD);
 
-        return deviceConnectionFD;
+        if (deviceConnectionFD > 0) {
+            fds.push_back(deviceConnectionFD);
+        }
     }
-    return -1;
+    return fds;
 }
 
 
@@ -17,7 +17,6 @@ bool app_run = true;
 void android_request_permission(struct android_app *app, const char *permission);
 bool android_has_permission(struct android_app *app, const char *perm_name);
 extern int32_t handle_input(struct android_app *app, AInputEvent *event);
-extern void updateRecordingState(JNIEnv* env);
 
 
 
@@ -39,8 +38,6 @@ void android_main(struct android_app *state)
     {
         int events;
         struct android_poll_source *source;
-        JNIEnv *env;
-        updateRecordingState(env);
 
         while (ALooper_pollAll(0, nullptr, &events, (void **)&source) >= 0)
         {
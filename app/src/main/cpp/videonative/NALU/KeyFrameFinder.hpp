@@ -40,7 +40,7 @@ public:
     }
     // H264 needs sps and pps
     // H265 needs sps,pps and vps
-    bool allKeyFramesAvailable(const bool IS_H265=false){
+    bool allKeyFramesAvailable(const bool IS_H265=false)const{
         if(IS_H265){
             return SPS != nullptr && PPS != nullptr && VPS!=nullptr;
         }
@@ -59,9 +59,18 @@ public:
         assert(VPS);
         return VPS->get_nal();
     }
+    // True if both hold the same (byte by byte) parameter sets
+    bool sameParameterSets(const KeyFrameFinder& other,const bool IS_H265)const{
+        if(!allKeyFramesAvailable(IS_H265) || !other.allKeyFramesAvailable(IS_H265))return false;
+        if(!sameData(getCSD0(),other.getCSD0()) || !sameData(getCSD1(),other.getCSD1()))return false;
+        return !IS_H265 || sameData(getVPS(),other.getVPS());
+    }
     static void appendNaluData(std::vector<uint8_t>& buff,const NALU& nalu){
         buff.insert(buff.begin(),nalu.getData(),nalu.getData()+nalu.getSize());
     }
+    static bool sameData(const NALU& a,const NALU& b){
+        return a.getSize()==b.getSize() && std::memcmp(a.getData(),b.getData(),a.getSize())==0;
+    }
     void reset(){
         SPS=nullptr;
         PPS=nullptr;
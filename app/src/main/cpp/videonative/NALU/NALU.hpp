@@ -17,11 +17,14 @@
 #include <optional>
 #include <assert.h>
 #include <memory>
+#include <functional>
 
 #include "NALUnitType.hpp"
 
 // dependency could be easily removed again
+#ifdef __ANDROID__
 #include <android/log.h>
+#endif
 #include <variant>
 #include <optional>
 
@@ -34,8 +37,11 @@
  */
 class NALU{
 public:
-    NALU(const uint8_t* data1,size_t data_len1,const bool IS_H265_PACKET1=false,const std::chrono::steady_clock::time_point creationTime=std::chrono::steady_clock::now()):
-            m_data(data1),m_data_len(data_len1),IS_H265_PACKET(IS_H265_PACKET1),creationTime{creationTime}
+    // lastPacketTime defaults to the creation time (NALU was not fragmented)
+    NALU(const uint8_t* data1,size_t data_len1,const bool IS_H265_PACKET1=false,const std::chrono::steady_clock::time_point creationTime=std::chrono::steady_clock::now(),
+         const std::chrono::steady_clock::time_point lastPacketTime={}):
+            m_data(data1),m_data_len(data_len1),IS_H265_PACKET(IS_H265_PACKET1),creationTime{creationTime},
+            lastPacketTime{lastPacketTime==std::chrono::steady_clock::time_point{} ? creationTime : lastPacketTime}
     {
         assert(hasValidPrefix());
         assert(getSize()>=getMinimumNaluSize(IS_H265_PACKET1));
@@ -55,6 +61,8 @@ public:
     const bool IS_H265_PACKET;
     // creation time is used to measure latency
     const std::chrono::steady_clock::time_point creationTime;
+    // time the last fragment (rtp packet) of this NALU was received
+    const std::chrono::steady_clock::time_point lastPacketTime;
 public:
     // returns true if starts with 0001, false otherwise
     bool hasValidPrefixLong()const{
@@ -145,6 +153,14 @@ public:
    bool is_config(){
        return isSPS() || isPPS() || (IS_H265_PACKET && isVPS());
    }
+   // coded slice (video coding layer), e.g. the codec produces a frame from it
+   bool is_vcl()const{
+       const auto nut=get_nal_unit_type();
+       if(IS_H265_PACKET){
+           return nut<32;
+       }
+       return nut>=NALUnitType::H264::NAL_UNIT_TYPE_CODED_SLICE_NON_IDR && nut<=NALUnitType::H264::NAL_UNIT_TYPE_CODED_SLICE_IDR;
+   }
    // keyframe / IDR frame
    bool is_keyframe()const{
        const auto nut=get_nal_unit_type();
@@ -156,6 +172,15 @@ public:
        }
        return false;
    }
+   // Intra random access point - decoding can (re-) start here without any previous frames
+   // H265: BLA, IDR, CRA (and the reserved IRAP types), H264: IDR
+   bool is_irap()const{
+       const auto nut=get_nal_unit_type();
+       if(IS_H265_PACKET){
+           return nut>=NALUnitType::H265::NAL_UNIT_CODED_SLICE_BLA_W_LP && nut<=NALUnitType::H265::NAL_UNIT_RESERVED_IRAP_VCL23;
+       }
+       return nut==NALUnitType::H264::NAL_UNIT_TYPE_CODED_SLICE_IDR;
+   }
    bool is_frame_but_not_keyframe()const{
        const auto nut=get_nal_unit_type();
        if(IS_H265_PACKET)return false;
@@ -256,7 +281,7 @@ public:
     }
     NALUBuffer(const NALU& nalu){
         m_data=std::make_shared<std::vector<uint8_t>>(nalu.getData(),nalu.getData()+nalu.getSize());
-        m_nalu=std::make_unique<NALU>(m_data->data(),m_data->size(),nalu.IS_H265_PACKET,nalu.creationTime);
+        m_nalu=std::make_unique<NALU>(m_data->data(),m_data->size(),nalu.IS_H265_PACKET,nalu.creationTime,nalu.lastPacketTime);
     }
     NALUBuffer(const NALUBuffer&)=delete;
     NALUBuffer(const NALUBuffer&&)=delete;
@@ -0,0 +1,89 @@
+#ifndef FPVUE_PARAMETERSETCACHE_HPP
+#define FPVUE_PARAMETERSETCACHE_HPP
+
+#include "KeyFrameFinder.hpp"
+#include "../helper/AndroidLogger.hpp"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Persists the last known VPS / SPS / PPS of a stream to disk, so the decoder can be created and configured
+// at startup before the first key frame of the live stream has been received.
+// File layout: "PSC1" magic, 1 byte IS_H265, then VPS,SPS,PPS each as uint32 size followed by the NALU data (with prefix)
+namespace ParameterSetCache{
+    inline constexpr char MAGIC[4]={'P','S','C','1'};
+    // One cache file per link and per stream (udp port)
+    inline std::string fileName(const std::string& directory,const uint32_t linkId,const int streamPort){
+        std::stringstream ss;
+        ss<<directory<<"/csd_"<<linkId<<"_"<<streamPort<<".bin";
+        return ss.str();
+    }
+    inline bool writeEntry(FILE* f,const NALU* nalu){
+        const uint32_t size=nalu==nullptr ? 0 : (uint32_t)nalu->getSize();
+        if(fwrite(&size,sizeof(size),1,f)!=1)return false;
+        if(size==0)return true;
+        return fwrite(nalu->getData(),size,1,f)==1;
+    }
+    inline bool readEntry(FILE* f,std::vector<uint8_t>& out){
+        uint32_t size=0;
+        if(fread(&size,sizeof(size),1,f)!=1)return false;
+        if(size>NALU::NALU_MAXLEN)return false;
+        out.resize(size);
+        if(size==0)return true;
+        return fread(out.data(),size,1,f)==1;
+    }
+    // Write the parameter sets held by kff. Written to a temporary file first and then renamed,
+    // such that a crash during writing never leaves a half-written cache behind.
+    inline bool store(const std::string& path,const KeyFrameFinder& kff,const bool IS_H265){
+        if(path.empty() || !kff.allKeyFramesAvailable(IS_H265))return false;
+        const std::string tmpPath=path+".tmp";
+        FILE* f=fopen(tmpPath.c_str(),"wb");
+        if(f==nullptr){
+            MLOGE2("ParameterSetCache")<<"Cannot open "<<tmpPath;
+            return false;
+        }
+        const uint8_t isH265=IS_H265 ? 1 : 0;
+        bool ok=fwrite(MAGIC,sizeof(MAGIC),1,f)==1 && fwrite(&isH265,1,1,f)==1;
+        ok=ok && writeEntry(f,IS_H265 ? &kff.getVPS() : nullptr);
+        ok=ok && writeEntry(f,&kff.getCSD0());
+        ok=ok && writeEntry(f,&kff.getCSD1());
+        ok=(fclose(f)==0) && ok;
+        if(!ok || rename(tmpPath.c_str(),path.c_str())!=0){
+            MLOGE2("ParameterSetCache")<<"Cannot write "<<path;
+            remove(tmpPath.c_str());
+            return false;
+        }
+        MLOGD2("ParameterSetCache")<<"Stored parameter sets to "<<path;
+        return true;
+    }
+    // Fill kff with the cached parameter sets. Returns false if there is no (valid) cache file.
+    inline bool load(const std::string& path,KeyFrameFinder& kff,bool& IS_H265){
+        FILE* f=fopen(path.c_str(),"rb");
+        if(f==nullptr)return false;
+        char magic[4];
+        uint8_t isH265=0;
+        std::vector<uint8_t> entries[3];
+        bool ok=fread(magic,sizeof(magic),1,f)==1 && memcmp(magic,MAGIC,sizeof(MAGIC))==0 && fread(&isH265,1,1,f)==1;
+        for(auto& entry:entries){
+            ok=ok && readEntry(f,entry);
+        }
+        fclose(f);
+        if(!ok){
+            MLOGE2("ParameterSetCache")<<"Invalid cache file "<<path;
+            return false;
+        }
+        IS_H265=isH265!=0;
+        kff.reset();
+        for(const auto& entry:entries){
+            if(entry.size()<NALU::getMinimumNaluSize(IS_H265))continue;
+            // The NALU constructor only asserts the prefix, validate it here since the data comes from disk
+            if(!(entry[0]==0 && entry[1]==0 && (entry[2]==1 || (entry[2]==0 && entry[3]==1))))continue;
+            kff.saveIfKeyFrame(NALU(entry.data(),entry.size(),IS_H265));
+        }
+        return kff.allKeyFramesAvailable(IS_H265);
+    }
+}
+
+#endif //FPVUE_PARAMETERSETCACHE_HPP
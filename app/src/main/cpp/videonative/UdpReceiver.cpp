@@ -11,7 +11,9 @@
 #include <array>
 
 #include "AndroidThreadPrioValues.hpp"
+#ifdef __ANDROID__
 #include "helper/NDKThreadHelper.hpp"
+#endif
 #include "helper/AndroidLogger.hpp"
 #include "helper/StringHelper.hpp"
 
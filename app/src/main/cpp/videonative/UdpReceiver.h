@@ -13,7 +13,14 @@
 #include <iostream>
 #include <thread>
 #include <atomic>
+#include <functional>
+#ifdef __ANDROID__
 #include <jni.h>
+#else
+// Only passed trough as an opaque pointer on host builds
+struct _JavaVM;
+typedef _JavaVM JavaVM;
+#endif
 //Starts a new thread that continuously checks for new data on UDP port
 
 class UDPReceiver {
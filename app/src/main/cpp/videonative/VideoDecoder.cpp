@@ -5,21 +5,57 @@
 
 #include "VideoDecoder.h"
 #include "AndroidThreadPrioValues.hpp"
-#include "helper/NDKThreadHelper.hpp"
 #include <unistd.h>
 #include <sstream>
-#include "helper/AndroidMediaFormatHelper.h"
+#include "NALU/ParameterSetCache.hpp"
+#include "codec/SyntheticCodecBackend.h"
 
 #include <vector>
 
-#include <android/native_window_jni.h>
-#include <media/NdkMediaCodec.h>
-#include <media/NdkMediaFormat.h>
+#ifdef __ANDROID__
+#include "helper/NDKThreadHelper.hpp"
+#include "codec/MediaCodecBackend.h"
+#endif
 
 using namespace std::chrono;
 
-VideoDecoder::VideoDecoder(NEW_FRAME_CALLBACK cb):onNewFrame(std::move(cb)) {
+std::atomic<float> DecodingInfo::avgDecodingTime_ms = 0.0f;
+std::atomic<float> DecodingInfo::p99DecodingTime_ms = 0.0f;
+std::atomic<float> DecodingInfo::currentKiloBitsPerSecond = 0.0f;
+
+static CODEC_BACKEND_FACTORY defaultCodecBackendFactory(){
+#ifdef __ANDROID__
+    return []{return std::make_unique<MediaCodecBackend>();};
+#else
+    return []{return std::make_unique<SyntheticCodecBackend>(SyntheticCodecBackend::Options{});};
+#endif
+}
+
+VideoDecoder::VideoDecoder(NEW_FRAME_CALLBACK cb,const Mode mode,CODEC_BACKEND_FACTORY codecBackendFactory):
+        onNewFrame(std::move(cb)),mMode(mode),
+        mCodecBackendFactory(codecBackendFactory ? std::move(codecBackendFactory) : defaultCodecBackendFactory()) {
     resetStatistics();
+    for(uint32_t slot=0;slot<mNALUSlots.size();slot++){
+        mFreeNALUSlots.push(slot);
+    }
+    mFeederThread=std::make_unique<std::thread>(&VideoDecoder::feederLoop,this);
+#ifdef __ANDROID__
+    NDKThreadHelper::setName(mFeederThread->native_handle(),"LLDFeeder");
+#endif
+}
+
+VideoDecoder::~VideoDecoder() {
+    mFeederRunning=false;
+    {
+        std::lock_guard<std::mutex> lock(mFeederMutex);
+    }
+    mFeederCondition.notify_all();
+    if(mFeederThread && mFeederThread->joinable()){
+        mFeederThread->join();
+    }
+    if(decoder.configured){
+        stopDecoder();
+    }
 }
 
 void VideoDecoder::initDecoder(){
@@ -30,18 +66,70 @@ void VideoDecoder::deinitDecoder() {
     std::lock_guard<std::mutex> lock(mMutexInputPipe);
     inputPipeClosed=true;
     if(decoder.configured){
-        AMediaCodec_stop(decoder.codec);
-        AMediaCodec_delete(decoder.codec);
+        stopDecoder();
         mKeyFrameFinder.reset();
-        decoder.configured=false;
-        if(mCheckOutputThread->joinable()){
-            mCheckOutputThread->join();
-            mCheckOutputThread.reset();
-        }
     }
+    mSkipUntilIRAP=false;
     resetStatistics();
 }
 
+void VideoDecoder::setStallTimeout(const std::chrono::milliseconds stallTimeout) {
+    mStallTimeout=stallTimeout;
+}
+
+void VideoDecoder::setFrameOwnership(const FrameOwnership frameOwnership) {
+    mFrameOwnership=frameOwnership;
+}
+
+void VideoDecoder::stopDecoder() {
+    // No output of this codec is handled from here on. Closing the gate waits for a callback that is running,
+    // the output thread exits within BUFFER_TIMEOUT_US
+    if(mCallbackGate){
+        std::lock_guard<std::mutex> lock(mCallbackGate->mutex);
+        mCallbackGate->open=false;
+    }
+    mCallbackGate.reset();
+    mCheckOutputRunning=false;
+    if(mCheckOutputThread && mCheckOutputThread->joinable()){
+        mCheckOutputThread->join();
+    }
+    mCheckOutputThread.reset();
+    // The consumer might still read from a buffer of this codec (TOKEN), then the releaser stops it later
+    mOutputBufferReleaser->detach(std::move(decoder.codec));
+    mOutputBufferReleaser.reset();
+    // Indices of the old codec are meaningless
+    mFreeInputBuffers.clear();
+    // The watchdog state belongs to the old codec
+    mCodecFailed=false;
+    mFirstUnansweredInputNs=0;
+    mLastSliceInputNs=0;
+    mInputUnavailableSince.reset();
+    decoder.configured=false;
+}
+
+void VideoDecoder::prewarmFromCache(const std::string& cacheFilePath) {
+    std::lock_guard<std::mutex> lock(mMutexInputPipe);
+    mParameterSetCachePath=cacheFilePath;
+    if(decoder.configured){
+        // The live stream was faster
+        return;
+    }
+    bool cachedIsH265=false;
+    if(!ParameterSetCache::load(cacheFilePath,mCachedKeyFrameFinder,cachedIsH265)){
+        MLOGD<<"No cached parameter sets in "<<cacheFilePath;
+        return;
+    }
+    const auto before=steady_clock::now();
+    IS_H265=cachedIsH265;
+    configureStartDecoder(mCachedKeyFrameFinder);
+    if(!decoder.configured){
+        return;
+    }
+    mConfiguredFromCache=true;
+    mLiveParameterSetsVerified=false;
+    MLOGD<<"Decoder configured from cache in "<<MyTimeHelper::R(steady_clock::now()-before);
+}
+
 void VideoDecoder::registerOnDecoderRatioChangedCallback(DECODER_RATIO_CHANGED decoderRatioChangedC) {
     onDecoderRatioChangedCallback=std::move(decoderRatioChangedC);
 }
@@ -52,17 +140,21 @@ void VideoDecoder::registerOnDecodingInfoChangedCallback(DECODING_INFO_CHANGED_C
 
 void VideoDecoder::interpretNALU(const NALU& nalu){
     //return;
-    // TODO: RN switching between h264 / h265 requires re-setting the surface
-    if(decoder.configured){
-        assert(nalu.IS_H265_PACKET==IS_H265);
-    }
-    IS_H265=nalu.IS_H265_PACKET;
     //MLOGD<<"NALU size "<<StringHelper::memorySizeReadable(nalu.getSize());
     //nalu.debug();
     //MLOGD<<"DATA:"<<nalu.dataAsString();
     //return;
     //we need this lock, since the receiving/parsing/feeding does not run on the same thread who sets the input surface
     std::lock_guard<std::mutex> lock(mMutexInputPipe);
+    // TODO: RN switching between h264 / h265 requires re-setting the surface
+    if(decoder.configured && mLiveParameterSetsVerified){
+        assert(nalu.IS_H265_PACKET==IS_H265);
+    }
+    if(!mLiveParameterSetsVerified){
+        verifyCachedParameterSets(nalu);
+        return;
+    }
+    IS_H265=nalu.IS_H265_PACKET;
     decodingInfo.nNALU++;
     if(nalu.getSize()<=4){
         //No data in NALU (e.g at the beginning of a stream)
@@ -81,6 +173,16 @@ void VideoDecoder::interpretNALU(const NALU& nalu){
     }
     if(decoder.configured){
         //MLOGD << "decoder configured.";
+        const auto stallReason=checkForStall(steady_clock::now());
+        if(stallReason!=StallReason::NONE){
+            recoverFromStall(stallReason);
+            if(!decoder.configured)return;
+        }
+        if(mSkipUntilIRAP){
+            // Parameter sets, SEI etc. are still fed, but slices referencing frames the new codec never saw are useless
+            if(nalu.is_vcl() && !nalu.is_irap())return;
+            if(nalu.is_irap())mSkipUntilIRAP=false;
+        }
         feedDecoder(nalu);
         decodingInfo.nNALUSFeeded++;
         // manually feeding AUDs doesn't seem to change anything for high latency streams
@@ -96,55 +198,153 @@ void VideoDecoder::interpretNALU(const NALU& nalu){
         mKeyFrameFinder.saveIfKeyFrame(nalu);
         if(mKeyFrameFinder.allKeyFramesAvailable(IS_H265)){
             MLOGD << "Configuring decoder...";
-            configureStartDecoder();
+            configureStartDecoder(mKeyFrameFinder);
+            if(decoder.configured){
+                ParameterSetCache::store(mParameterSetCachePath,mKeyFrameFinder,IS_H265);
+            }
         }
     }
 }
 
-void VideoDecoder::configureStartDecoder(){
-    const std::string MIME = IS_H265 ? "video/hevc" : "video/avc";
-    decoder.codec = AMediaCodec_createDecoderByType(MIME.c_str());
-        //decoder.codec = AMediaCodec_createDecoderByType("video/mjpeg");
-        //const std::string s=(decoder.codec== nullptr ? "No" : "YES");
-        //MDebug::log("Created decoder"+s);
-        //char* name;
-        //AMediaCodec_getName(decoder.codec,&name);
-        //MLOGD<<"Created decoder "<<std::string(name);
-        //AMediaCodec_releaseName(decoder.codec,name);
-
-    AMediaFormat* format=AMediaFormat_new();
-    // Only for android 31
-    AMediaFormat_setString(format,AMEDIAFORMAT_KEY_MIME,MIME.c_str());
-
-// AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_COLOR_FORMAT, 2130747392);
-
-   AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_LOW_LATENCY, 1);
-//    // MediaCodec supports two priorities: 0 - realtime, 1 - best effort
-   AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_PRIORITY, 0);
-
-    if(IS_H265){
-        h265_configureAMediaFormat(mKeyFrameFinder,format);
-    }else{
-        h264_configureAMediaFormat(mKeyFrameFinder,format);
+void VideoDecoder::enqueueNALU(const NALU& nalu) {
+    if(nalu.is_vcl()){
+        if(nalu.is_irap()){
+            mEnqueueSkipUntilIRAP=false;
+        }else if(mEnqueueSkipUntilIRAP){
+            nNALUQueueOverflows++;
+            return;
+        }
     }
+    // There are as many slots as the queue holds, no free slot means the queue is full
+    uint32_t slot;
+    if(!mFreeNALUSlots.pop(slot)){
+        // The feeder is way behind. It drops the stale slices at the head of the queue itself, and the newer ones
+        // cannot be decoded without this one
+        nNALUQueueOverflows++;
+        if(nalu.is_vcl())mEnqueueSkipUntilIRAP=true;
+        return;
+    }
+    mNALUSlots[slot].assign(nalu.getData(),nalu.getData()+nalu.getSize());
+    mNALUQueue.push({slot,nalu.IS_H265_PACKET,nalu.creationTime,nalu.lastPacketTime,steady_clock::now()});
+    // Taking the mutex guarantees the feeder is either waiting already or sees the new element
+    {
+        std::lock_guard<std::mutex> lock(mFeederMutex);
+    }
+    mFeederCondition.notify_one();
+}
 
-    MLOGD << "Configuring decoder:" << AMediaFormat_toString(format);
+void VideoDecoder::feederLoop() {
+    QueuedNALU queued;
+    while(mFeederRunning){
+        if(!mNALUQueue.pop(queued)){
+            std::unique_lock<std::mutex> lock(mFeederMutex);
+            mFeederCondition.wait(lock,[this]{return !mFeederRunning || !mNALUQueue.empty();});
+            continue;
+        }
+        const auto depth=mNALUQueue.size();
+        mNALUQueueDepthSum+=depth;
+        mNALUQueueDepthSamples++;
+        size_t currentMax=mNALUQueueDepthMax.load();
+        while(depth>currentMax && !mNALUQueueDepthMax.compare_exchange_weak(currentMax,depth)){}
+        const auto waitTime=steady_clock::now()-queued.enqueueTime;
+        mNALUQueueWait.add(waitTime);
+        const auto& data=mNALUSlots[queued.slot];
+        const NALU nalu(data.data(),data.size(),queued.isH265,queued.creationTime,queued.lastPacketTime);
+        // Drop the oldest slices first, the codec would only add to their latency. IRAPs are kept, decoding resumes there
+        if(nalu.is_vcl() && !nalu.is_irap() && (waitTime>MAX_NALU_QUEUE_LATENCY || depth>=NALU_QUEUE_HIGH_WATERMARK)){
+            nNALUQueueStaleDrops++;
+            {
+                std::lock_guard<std::mutex> lock(mMutexInputPipe);
+                mSkipUntilIRAP=true;
+            }
+            mFreeNALUSlots.push(queued.slot);
+            continue;
+        }
+        interpretNALU(nalu);
+        mFreeNALUSlots.push(queued.slot);
+    }
+    MLOGD<<"Exit feederLoop";
+}
 
-    AMediaCodec_configure(decoder.codec,format, nullptr, nullptr, 0);
-    AMediaFormat_delete(format);
-    format=AMediaCodec_getOutputFormat(decoder.codec);
-    //MLOGD<<"Output format"<<AMediaFormat_toString(format);
-    AMediaFormat_delete(format);
+void VideoDecoder::verifyCachedParameterSets(const NALU& nalu) {
+    decodingInfo.nNALU++;
+    if(nalu.getSize()<=4){
+        return;
+    }
+    nNALUBytesFed.add(nalu.getSize());
+    // Nothing is fed until we know the codec was configured with the right data. Frames before the first
+    // parameter sets cannot be decoded anyways, since they come in front of the key frame.
+    mKeyFrameFinder.saveIfKeyFrame(nalu);
+    if(!mKeyFrameFinder.allKeyFramesAvailable(nalu.IS_H265_PACKET)){
+        return;
+    }
+    mLiveParameterSetsVerified=true;
+    if(nalu.IS_H265_PACKET==IS_H265 && mKeyFrameFinder.sameParameterSets(mCachedKeyFrameFinder,IS_H265)){
+        MLOGD<<"Live parameter sets match the cached ones";
+        return;
+    }
+    MLOGD<<"Live parameter sets differ from the cached ones, reconfiguring decoder";
+    mConfiguredFromCache=false;
+    stopDecoder();
+    IS_H265=nalu.IS_H265_PACKET;
+    configureStartDecoder(mKeyFrameFinder);
+    if(decoder.configured){
+        ParameterSetCache::store(mParameterSetCachePath,mKeyFrameFinder,IS_H265);
+    }
+}
 
-    if (decoder.codec== nullptr) {
+void VideoDecoder::configureStartDecoder(const KeyFrameFinder& keyFrameFinder){
+    decoder.codec=mCodecBackendFactory();
+    CodecBackend::AsyncCallbacks callbacks;
+    if(mMode==Mode::ASYNCHRONOUS){
+        // The async callbacks are called on the codec's own thread, and only as long as stopDecoder() did not close the gate
+        const auto gate=std::make_shared<CallbackGate>();
+        mCallbackGate=gate;
+        const auto guarded=[gate](auto callback){
+            return [gate,callback](auto&&... args){
+                std::lock_guard<std::mutex> lock(gate->mutex);
+                if(gate->open)callback(std::forward<decltype(args)>(args)...);
+            };
+        };
+        callbacks.onInputAvailable=guarded([this](const int32_t index){
+            if(!mFreeInputBuffers.push(index)){
+                // Cannot happen as long as the codec has less input buffers than the queue capacity
+                MLOGE<<"Free input buffer queue full, dropping index "<<index;
+            }
+        });
+        callbacks.onOutputAvailable=guarded([this](const int32_t index,const CodecBufferInfo& info){
+            onOutputBuffer((size_t)index,info);
+            recalculateDecodingInfoIfNeeded();
+        });
+        callbacks.onFormatChanged=guarded([this](const CodecOutputFormat& format){
+            onOutputFormatChanged(format);
+        });
+        callbacks.onError=guarded([this](const int error,const std::string& detail){
+            MLOGE<<"Codec error "<<error<<" "<<detail;
+            mCodecFailed=true;
+        });
+    }
+    if(!decoder.codec->configure(IS_H265,keyFrameFinder,mMode==Mode::ASYNCHRONOUS ? &callbacks : nullptr)){
         MLOGD<<"Cannot configure decoder";
         //set csd-0 and csd-1 back to 0, maybe they were just faulty but we have better luck with the next ones
         //mKeyFrameFinder.reset();
+        decoder.codec.reset();
         return;
     }
-    AMediaCodec_start(decoder.codec);
-    mCheckOutputThread=std::make_unique<std::thread>(&VideoDecoder::checkOutputLoop,this);
-    NDKThreadHelper::setName(mCheckOutputThread->native_handle(),"LLDCheckOutput");
+    if(!decoder.codec->start()){
+        MLOGE<<"Cannot start decoder";
+        decoder.codec.reset();
+        return;
+    }
+    MLOGD<<"Started decoder "<<decoder.codec->getName();
+    mOutputBufferReleaser=std::make_shared<OutputBufferReleaser>(decoder.codec.get(),mOutputBufferHoldTime);
+    if(mMode==Mode::SYNCHRONOUS){
+        mCheckOutputRunning=true;
+        mCheckOutputThread=std::make_unique<std::thread>(&VideoDecoder::checkOutputLoop,this);
+#ifdef __ANDROID__
+        NDKThreadHelper::setName(mCheckOutputThread->native_handle(),"LLDCheckOutput");
+#endif
+    }
     decoder.configured=true;
 }
 
@@ -161,35 +361,37 @@ void VideoDecoder::feedDecoder(const NALU& nalu){
     //    return;
     //}
     const auto now=std::chrono::steady_clock::now();
-    const auto deltaParsing=now-nalu.creationTime;
+    if(mMode==Mode::ASYNCHRONOUS){
+        // Never wait for an input buffer on the receiving thread. If the codec has none available it is way behind anyways.
+        int32_t index;
+        if(!mFreeInputBuffers.pop(index)){
+            nInputBufferUnavailable++;
+            if(!mInputUnavailableSince)mInputUnavailableSince=now;
+            // The following slices would reference the dropped one
+            if(nalu.is_vcl())mSkipUntilIRAP=true;
+            return;
+        }
+        mInputUnavailableSince.reset();
+        queueInputBuffer(index,nalu,now);
+        return;
+    }
+    // Don't block longer than the watchdog would wait anyways
+    const auto maxWaitForBuffer=mStallTimeout.count()>0 ? std::min<std::chrono::nanoseconds>(mStallTimeout,std::chrono::seconds(1)) : std::chrono::seconds(1);
     while(true){
-        const auto index=AMediaCodec_dequeueInputBuffer(decoder.codec,BUFFER_TIMEOUT_US);
+        const auto index=decoder.codec->dequeueInputBuffer(BUFFER_TIMEOUT_US);
         if (index >=0) {
-            size_t inputBufferSize;
-            void* buf = AMediaCodec_getInputBuffer(decoder.codec,(size_t)index,&inputBufferSize);
-            // I have not seen any case where the input buffer returned by MediaCodec is too small to hold the NALU
-            // But better be safe than crashing with a memory exception
-            if(nalu.getSize()>inputBufferSize){
-                MLOGD<<"Nalu too big"<<nalu.getSize();
-                return;
-            }
-            std::memcpy(buf, nalu.getData(),(size_t)nalu.getSize());
-            //this timestamp will be later used to calculate the decoding latency
-            const uint64_t presentationTimeUS=(uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
-            //Doing so causes garbage bug TODO investigate
-            const auto flag=nalu.isPPS() || nalu.isSPS() ? AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG : 0;
-            //AMediaCodec_queueInputBuffer(decoder.codec, (size_t)index, 0, (size_t)nalu.data_length,presentationTimeUS, flag);
-            AMediaCodec_queueInputBuffer(decoder.codec, (size_t)index, 0, (size_t)nalu.getSize(),presentationTimeUS,0);
-            waitForInputB.add(steady_clock::now() - now);
-            parsingTime.add(deltaParsing);
+            mInputUnavailableSince.reset();
+            queueInputBuffer((size_t)index,nalu,now);
             return;
-        } else if(index==AMEDIACODEC_INFO_TRY_AGAIN_LATER){
-            //just try again. But if we had no success in the last 1 second,log a warning and return.
+        } else if(index==CodecBackend::INFO_TRY_AGAIN_LATER){
+            //just try again. But if we had no success in maxWaitForBuffer,log a warning and return.
             const auto elapsedTimeTryingForBuffer=std::chrono::steady_clock::now()-now;
-            if(elapsedTimeTryingForBuffer>std::chrono::seconds(1)){
+            if(elapsedTimeTryingForBuffer>maxWaitForBuffer){
                 // Since OpenHD provides a lossy link it is really unlikely, but possible that we somehow 'break' the codec by feeding corrupt data.
-                // It will probably recover itself as soon as we feed enough valid data though;
-                MLOGE<<"AMEDIACODEC_INFO_TRY_AGAIN_LATER for more than 1 second "<<MyTimeHelper::R(elapsedTimeTryingForBuffer)<<"return.";
+                // If it does not recover itself the stall watchdog re-creates it.
+                MLOGE<<"AMEDIACODEC_INFO_TRY_AGAIN_LATER for "<<MyTimeHelper::R(elapsedTimeTryingForBuffer)<<" return.";
+                if(!mInputUnavailableSince)mInputUnavailableSince=now;
+                if(nalu.is_vcl())mSkipUntilIRAP=true;
                 return;
             }
         } else{
@@ -200,85 +402,286 @@ void VideoDecoder::feedDecoder(const NALU& nalu){
     }
 }
 
+VideoDecoder::StallReason VideoDecoder::checkForStall(const std::chrono::steady_clock::time_point now) const {
+    if(mStallTimeout.count()==0){
+        return StallReason::NONE;
+    }
+    if(mCodecFailed){
+        return StallReason::CODEC_ERROR;
+    }
+    if(mInputUnavailableSince && now-*mInputUnavailableSince>mStallTimeout){
+        return StallReason::NO_INPUT_BUFFER;
+    }
+    // While the stream pauses nothing is queued behind the unanswered slice, which the codec may legitimately hold back
+    const bool paused=mLastSliceInputNs!=0 && now.time_since_epoch()-nanoseconds(mLastSliceInputNs)>MIN_INPUT_PAUSE;
+    const auto firstUnansweredInputNs=mFirstUnansweredInputNs.load();
+    if(!paused && firstUnansweredInputNs!=0 && now.time_since_epoch()-nanoseconds(firstUnansweredInputNs)>mStallTimeout){
+        return StallReason::NO_OUTPUT;
+    }
+    return StallReason::NONE;
+}
+
+void VideoDecoder::recoverFromStall(const StallReason reason) {
+    static constexpr const char* REASON_NAMES[]={"none","no input buffer","no output","codec error"};
+    const auto now=steady_clock::now();
+    MLOGE<<"Decoder stalled ("<<REASON_NAMES[(int)reason]<<"), re-creating codec";
+    // Flushing is not enough for a codec that stopped returning buffers
+    stopDecoder();
+    mRecoveryStartNs=(int64_t)duration_cast<nanoseconds>(now.time_since_epoch()).count();
+    nStallRecoveries++;
+    configureStartDecoder(mKeyFrameFinder);
+    mSkipUntilIRAP=true;
+    MLOGD<<"Re-created codec in "<<MyTimeHelper::R(steady_clock::now()-now)<<", waiting for the next IRAP frame";
+}
+
+void VideoDecoder::queueInputBuffer(const size_t index,const NALU& nalu,const std::chrono::steady_clock::time_point feedStart){
+    size_t inputBufferSize;
+    uint8_t* buf = decoder.codec->getInputBuffer(index,&inputBufferSize);
+    // I have not seen any case where the input buffer returned by MediaCodec is too small to hold the NALU
+    // But better be safe than crashing with a memory exception
+    if(nalu.getSize()>inputBufferSize){
+        MLOGD<<"Nalu too big"<<nalu.getSize();
+        // The buffer still has to be returned to the codec
+        decoder.codec->queueInputBuffer(index,0,0,0);
+        return;
+    }
+    std::memcpy(buf, nalu.getData(),(size_t)nalu.getSize());
+    //this timestamp will be later used to calculate the decoding latency
+    const uint64_t presentationTimeUS=(uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    //Doing so causes garbage bug TODO investigate
+    const auto flag=nalu.isPPS() || nalu.isSPS() ? CodecBackend::BUFFER_FLAG_CODEC_CONFIG : 0;
+    //decoder.codec->queueInputBuffer(index,(size_t)nalu.getSize(),presentationTimeUS,flag);
+    decoder.codec->queueInputBuffer(index,(size_t)nalu.getSize(),presentationTimeUS,0);
+    if(nalu.is_vcl()){
+        // If a frame is already waiting for its output it stays the reference for the watchdog. Unless the stream
+        // paused, then the codec only has to answer from this slice on
+        const auto nowNs=(int64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        const bool afterPause=mLastSliceInputNs!=0 && nanoseconds(nowNs-mLastSliceInputNs)>MIN_INPUT_PAUSE;
+        mLastSliceInputNs=nowNs;
+        if(afterPause){
+            mFirstUnansweredInputNs=nowNs;
+        }else{
+            int64_t expected=0;
+            mFirstUnansweredInputNs.compare_exchange_strong(expected,nowNs);
+        }
+        mFrameLatencyTracker.begin(presentationTimeUS,nalu.creationTime,nalu.lastPacketTime,feedStart,steady_clock::now());
+    }
+    waitForInputB.add(steady_clock::now() - feedStart);
+    parsingTime.add(feedStart-nalu.creationTime);
+}
+
 
 void VideoDecoder::checkOutputLoop() {
     //NDKThreadHelper::setProcessThreadPriorityAttachDetach(javaVm,FPV_VR_PRIORITY::CPU_PRIORITY_DECODER_OUTPUT,"DecoderCheckOutput");
-    AMediaCodecBufferInfo info;
+    CodecBufferInfo info;
     bool decoderSawEOS=false;
     bool decoderProducedUnknown=false;
-    uint8_t *buf;
-    size_t bufSize;
-    int status;
-    int32_t width=0,height=0;
-    while(!decoderSawEOS && !decoderProducedUnknown) {
-        const ssize_t index = AMediaCodec_dequeueOutputBuffer(decoder.codec,&info,BUFFER_TIMEOUT_US);
+    while(mCheckOutputRunning && !decoderSawEOS && !decoderProducedUnknown) {
+        const ssize_t index = decoder.codec->dequeueOutputBuffer(info,BUFFER_TIMEOUT_US);
         if (index >= 0) {
-            const auto now=steady_clock::now();
-            const int64_t nowNS=(int64_t)duration_cast<nanoseconds>(now.time_since_epoch()).count();
-            const int64_t nowUS=(int64_t)duration_cast<microseconds>(now.time_since_epoch()).count();
-
-            if (info.size > 0) {
-                /* dequeue samples from decoder */
-                buf = AMediaCodec_getOutputBuffer(decoder.codec, index, &bufSize);
-                if(buf) {
-                    onNewFrame(buf, bufSize, width, height);
-                }
-            }
-
-
-            //the timestamp for releasing the buffer is in NS, just release as fast as possible (e.g. now)
-            //https://android.googlesource.com/platform/frameworks/av/+/master/media/ndk/NdkMediaCodec.cpp
-            //-> renderOutputBufferAndRelease which is in https://android.googlesource.com/platform/frameworks/av/+/3fdb405/media/libstagefright/MediaCodec.cpp
-            //-> Message kWhatReleaseOutputBuffer -> onReleaseOutputBuffer
-            // also https://android.googlesource.com/platform/frameworks/native/+/5c1139f/libs/gui/SurfaceTexture.cpp
-            AMediaCodec_releaseOutputBufferAtTime(decoder.codec,(size_t)index,nowNS);
-            //but the presentationTime is in US
-            decodingTime.add(std::chrono::microseconds(nowUS - info.presentationTimeUs));
-            nDecodedFrames.add(1);
-            if (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) {
+            onOutputBuffer((size_t)index,info);
+            if (info.flags & CodecBackend::BUFFER_FLAG_END_OF_STREAM) {
                 MLOGD<<"Decoder saw EOS";
                 decoderSawEOS=true;
                 continue;
             }
-        } else if (index == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED ) {
-            auto format = AMediaCodec_getOutputFormat(decoder.codec);
-            AMediaFormat_getInt32(format,AMEDIAFORMAT_KEY_WIDTH,&width);
-            AMediaFormat_getInt32(format,AMEDIAFORMAT_KEY_HEIGHT,&height);
-            MLOGD<<"Actual Width and Height in output "<<width<<","<<height;
-            if(onDecoderRatioChangedCallback!= nullptr && width != 0 && height != 0){
-                onDecoderRatioChangedCallback({width, height});
-            }
-            MLOGD << "AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED " << width << " " << height << " " << AMediaFormat_toString(format);
-        } else if(index==AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED){
+        } else if (index == CodecBackend::INFO_OUTPUT_FORMAT_CHANGED ) {
+            onOutputFormatChanged(decoder.codec->getOutputFormat());
+        } else if(index==CodecBackend::INFO_OUTPUT_BUFFERS_CHANGED){
             MLOGD<<"AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED";
-        } else if(index==AMEDIACODEC_INFO_TRY_AGAIN_LATER) {
+        } else if(index==CodecBackend::INFO_TRY_AGAIN_LATER) {
             //MLOGD<<"AMEDIACODEC_INFO_TRY_AGAIN_LATER";
         } else {
-            // Most like AMediaCodec_stop() was called
+            // The codec failed, the stall watchdog re-creates it
             MLOGD<<"dequeueOutputBuffer idx: "<<(int)index<<" .Exit.";
             decoderProducedUnknown=true;
+            mCodecFailed=true;
             continue;
         }
-        //every 2 seconds recalculate the current fps and bitrate
-        const auto now=steady_clock::now();
-        const auto delta=now-decodingInfo.lastCalculation;
-        if(delta>DECODING_INFO_RECALCULATION_INTERVAL){
-            decodingInfo.lastCalculation=steady_clock::now();
-            decodingInfo.currentFPS=(float)nDecodedFrames.getDeltaSinceLastCall()/(float)duration_cast<seconds>(delta).count();
-            decodingInfo.currentKiloBitsPerSecond=((float)nNALUBytesFed.getDeltaSinceLastCall()/duration_cast<seconds>(delta).count())/1024.0f*8.0f/1000;
-            //and recalculate the avg latencies. If needed,also print the log.
-
-            decodingInfo.avgDecodingTime_ms=decodingTime.getAvg_ms();
-            decodingInfo.avgParsingTime_ms=parsingTime.getAvg_ms();
-            decodingInfo.avgWaitForInputBTime_ms=waitForInputB.getAvg_ms();
-            decodingInfo.nDecodedFrames=nDecodedFrames.getAbsolute();
-            printAvgLog();
-            if(onDecodingInfoChangedCallback!= nullptr){
-                onDecodingInfoChangedCallback(decodingInfo);
+        recalculateDecodingInfoIfNeeded();
+    }
+    MLOGD<<"Exit CheckOutputLoop";
+}
+
+class VideoDecoder::OutputBufferToken{
+public:
+    OutputBufferToken(std::shared_ptr<OutputBufferReleaser> releaser,const size_t index,const steady_clock::time_point availableSince):
+            mReleaser(std::move(releaser)),mIndex(index),mAvailableSince(availableSince){
+        mReleaser->acquireToken();
+    }
+    OutputBufferToken(const OutputBufferToken&)=delete;
+    ~OutputBufferToken(){
+        mReleaser->releaseToken(mIndex,mAvailableSince);
+    }
+private:
+    const std::shared_ptr<OutputBufferReleaser> mReleaser;
+    const size_t mIndex;
+    const steady_clock::time_point mAvailableSince;
+};
+
+VideoDecoder::OutputBufferReleaser::OutputBufferReleaser(CodecBackend* codec,LatencyHistogram& holdTime):mCodec(codec),mHoldTime(holdTime) {
+}
+
+void VideoDecoder::OutputBufferReleaser::release(const size_t index,const steady_clock::time_point availableSince) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mCodec==nullptr){
+        // Detached in the meantime, the codec is stopped anyways
+        return;
+    }
+    const auto now=steady_clock::now();
+    //the timestamp for releasing the buffer is in NS, just release as fast as possible (e.g. now)
+    //https://android.googlesource.com/platform/frameworks/av/+/master/media/ndk/NdkMediaCodec.cpp
+    //-> renderOutputBufferAndRelease which is in https://android.googlesource.com/platform/frameworks/av/+/3fdb405/media/libstagefright/MediaCodec.cpp
+    //-> Message kWhatReleaseOutputBuffer -> onReleaseOutputBuffer
+    // also https://android.googlesource.com/platform/frameworks/native/+/5c1139f/libs/gui/SurfaceTexture.cpp
+    mCodec->releaseOutputBuffer(index,(int64_t)duration_cast<nanoseconds>(now.time_since_epoch()).count());
+    mHoldTime.add(now-availableSince);
+}
+
+void VideoDecoder::OutputBufferReleaser::acquireToken() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    nOutstanding++;
+}
+
+void VideoDecoder::OutputBufferReleaser::releaseToken(const size_t index,const steady_clock::time_point availableSince) {
+    release(index,availableSince);
+    std::unique_ptr<CodecBackend> codec;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        nOutstanding--;
+        if(nOutstanding==0)codec=std::move(mDetachedCodec);
+    }
+    if(codec){
+        // The last frame of a detached codec is gone
+        codec->stop();
+    }
+}
+
+void VideoDecoder::OutputBufferReleaser::detach(std::unique_ptr<CodecBackend> codec) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCodec=nullptr;
+        if(nOutstanding>0){
+            MLOGD<<nOutstanding<<" output buffers still referenced, the codec is stopped once they are released";
+            mDetachedCodec=std::move(codec);
+            return;
+        }
+    }
+    codec->stop();
+}
+
+void VideoDecoder::onOutputBuffer(const size_t index,const CodecBufferInfo& info) {
+    const auto now=steady_clock::now();
+    const int64_t nowNS=(int64_t)duration_cast<nanoseconds>(now.time_since_epoch()).count();
+    const int64_t nowUS=(int64_t)duration_cast<microseconds>(now.time_since_epoch()).count();
+    // Keeps the releaser alive even if the decoder is stopped while the consumer runs
+    const auto releaser=mOutputBufferReleaser;
+    bool released=false;
+    if (info.size > 0) {
+        /* dequeue samples from decoder */
+        size_t bufSize;
+        uint8_t* buf = decoder.codec->getOutputBuffer(index, &bufSize);
+        mFrameLatencyTracker.mark(info.presentationTimeUs,FrameLatencyTracker::DECODED,now);
+        mFirstUnansweredInputNs=0;
+        const auto recoveryStartNs=mRecoveryStartNs.exchange(0);
+        if(recoveryStartNs!=0){
+            lastStallRecoveryTime_ms=(float)(nowNS-recoveryStartNs)/1000000.0f;
+            MLOGD<<"Recovered from stall in "<<lastStallRecoveryTime_ms<<"ms";
+        }
+        if(buf && (size_t)info.offset<bufSize) {
+            DecodedFrame frame;
+            frame.size=std::min((size_t)info.size,bufSize-(size_t)info.offset);
+            frame.width=mOutputWidth;
+            frame.height=mOutputHeight;
+            frame.colorFormat=mOutputFormat.colorFormat;
+            frame.stride=mOutputFormat.stride;
+            frame.sliceHeight=mOutputFormat.sliceHeight;
+            frame.cropLeft=mOutputFormat.cropLeft;
+            frame.cropTop=mOutputFormat.cropTop;
+            frame.cropRight=mOutputFormat.cropRight;
+            frame.cropBottom=mOutputFormat.cropBottom;
+            frame.pts=(uint64_t)info.presentationTimeUs;
+            if(mFrameOwnership==FrameOwnership::COPY){
+                auto copy=mFramePool->acquire(frame.size);
+                std::memcpy(copy->data(),buf+info.offset,frame.size);
+                releaser->release(index,now);
+                released=true;
+                frame.data=copy->data();
+                frame.owner=std::move(copy);
+            }else{
+                frame.data=buf+info.offset;
+                frame.owner=std::make_shared<OutputBufferToken>(releaser,index,now);
+                released=true;
             }
+            onNewFrame(frame);
+        }
+        if(decodingInfo.timeToFirstFrame_ms<0){
+            decodingInfo.timeToFirstFrame_ms=(float)duration_cast<microseconds>(now-mCreationTime).count()/1000.0f;
+            decodingInfo.configuredFromCache=mConfiguredFromCache;
+            MLOGD<<"Time to first frame: "<<decodingInfo.timeToFirstFrame_ms<<"ms (configured from cache: "<<mConfiguredFromCache<<")";
+        }
+    }
+    if(!released){
+        releaser->release(index,now);
+    }
+    //but the presentationTime is in US
+    decodingTime.add(std::chrono::microseconds(nowUS - info.presentationTimeUs));
+    nDecodedFrames.add(1);
+}
+
+void VideoDecoder::onOutputFormatChanged(const CodecOutputFormat& format) {
+    mOutputWidth=format.width;
+    mOutputHeight=format.height;
+    mOutputFormat=format;
+    MLOGD<<"Actual Width and Height in output "<<mOutputWidth<<","<<mOutputHeight<<" stride "<<format.stride<<" slice height "<<format.sliceHeight
+         <<" crop "<<format.cropLeft<<","<<format.cropTop<<","<<format.cropRight<<","<<format.cropBottom
+         <<" color format "<<format.colorFormat<<(format.colorFormat==CodecOutputFormat::COLOR_FORMAT_YUV_P010 ? " (P010, 10 bit)" : "");
+    if(onDecoderRatioChangedCallback!= nullptr && mOutputWidth != 0 && mOutputHeight != 0){
+        onDecoderRatioChangedCallback({mOutputWidth, mOutputHeight});
+    }
+    MLOGD << "AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED " << mOutputWidth << " " << mOutputHeight << " " << format.description;
+}
+
+void VideoDecoder::recalculateDecodingInfoIfNeeded() {
+    //every 2 seconds recalculate the current fps and bitrate
+    const auto now=steady_clock::now();
+    const auto delta=now-decodingInfo.lastCalculation;
+    if(delta>DECODING_INFO_RECALCULATION_INTERVAL){
+        decodingInfo.lastCalculation=steady_clock::now();
+        decodingInfo.currentFPS=(float)nDecodedFrames.getDeltaSinceLastCall()/(float)duration_cast<seconds>(delta).count();
+        decodingInfo.currentKiloBitsPerSecond=((float)nNALUBytesFed.getDeltaSinceLastCall()/duration_cast<seconds>(delta).count())/1024.0f*8.0f/1000;
+        //and recalculate the avg latencies. If needed,also print the log.
+
+        const auto decodingTimeInterval=decodingTime.takeIntervalSnapshot();
+        const auto parsingTimeInterval=parsingTime.takeIntervalSnapshot();
+        const auto waitForInputBInterval=waitForInputB.takeIntervalSnapshot();
+        decodingInfo.avgDecodingTime_ms=decodingTimeInterval.getAvg_ms();
+        decodingInfo.p99DecodingTime_ms=decodingTimeInterval.getPercentile_ms(99);
+        decodingInfo.avgParsingTime_ms=parsingTimeInterval.getAvg_ms();
+        decodingInfo.p99ParsingTime_ms=parsingTimeInterval.getPercentile_ms(99);
+        decodingInfo.avgWaitForInputBTime_ms=waitForInputBInterval.getAvg_ms();
+        decodingInfo.p99WaitForInputBTime_ms=waitForInputBInterval.getPercentile_ms(99);
+        decodingTimeSinceLog.merge(decodingTimeInterval);
+        parsingTimeSinceLog.merge(parsingTimeInterval);
+        waitForInputBSinceLog.merge(waitForInputBInterval);
+        decodingInfo.nDecodedFrames=nDecodedFrames.getAbsolute();
+        decodingInfo.nInputBufferUnavailable=nInputBufferUnavailable;
+        decodingInfo.nStallRecoveries=nStallRecoveries;
+        decodingInfo.lastStallRecoveryTime_ms=lastStallRecoveryTime_ms;
+        const auto queueWaitInterval=mNALUQueueWait.takeIntervalSnapshot();
+        const auto queueDepthSamples=mNALUQueueDepthSamples.exchange(0);
+        const auto queueDepthSum=mNALUQueueDepthSum.exchange(0);
+        decodingInfo.avgNALUQueueDepth=queueDepthSamples==0 ? 0 : (float)queueDepthSum/(float)queueDepthSamples;
+        decodingInfo.maxNALUQueueDepth=(long)mNALUQueueDepthMax.exchange(0);
+        decodingInfo.p99NALUQueueWait_ms=queueWaitInterval.getPercentile_ms(99);
+        decodingInfo.nNALUQueueOverflows=nNALUQueueOverflows;
+        decodingInfo.nNALUQueueStaleDrops=nNALUQueueStaleDrops;
+        decodingInfo.p99OutputBufferHold_ms=mOutputBufferHoldTime.takeIntervalSnapshot().getPercentile_ms(99);
+        printAvgLog();
+        if(onDecodingInfoChangedCallback!= nullptr){
+            onDecodingInfoChangedCallback(decodingInfo);
         }
     }
-    MLOGD<<"Exit CheckOutputLoop";
 }
 
 void VideoDecoder::printAvgLog() {
@@ -295,10 +698,25 @@ void VideoDecoder::printAvgLog() {
                     <<" | WaitInputBuffer:"<<decodingInfo.avgWaitForInputBTime_ms
                     <<" | Decoding:"<<decodingInfo.avgDecodingTime_ms
                     <<" | Decoding Latency Sum:"<<avgDecodingLatencySum<<
+                    "\nParsing "<<parsingTimeSinceLog.getPercentilesReadable()<<
+                    "\nWaitInputBuffer "<<waitForInputBSinceLog.getPercentilesReadable()<<
+                    "\nDecoding "<<decodingTimeSinceLog.getPercentilesReadable()<<
                     "\nN NALUS:"<<decodingInfo.nNALU
                     <<" | N NALUES feeded:" <<decodingInfo.nNALUSFeeded<<" | N Decoded Frames:"<<nDecodedFrames.getAbsolute()<<
-                    "\nFPS:"<<decodingInfo.currentFPS;
+                    "\nFPS:"<<decodingInfo.currentFPS
+                    <<" | Mode:"<<(mMode==Mode::ASYNCHRONOUS ? "async" : "sync")<<" | No input buffer:"<<decodingInfo.nInputBufferUnavailable
+                    <<" | Time to first frame:"<<decodingInfo.timeToFirstFrame_ms<<" | From cache:"<<decodingInfo.configuredFromCache<<
+                    "\nStall recoveries:"<<decodingInfo.nStallRecoveries<<" | Last recovery:"<<decodingInfo.lastStallRecoveryTime_ms<<"ms"<<
+                    "\nNALU queue depth avg:"<<decodingInfo.avgNALUQueueDepth<<" max:"<<decodingInfo.maxNALUQueueDepth
+                    <<" | p99 wait:"<<decodingInfo.p99NALUQueueWait_ms<<"ms | Overflows:"<<decodingInfo.nNALUQueueOverflows
+                    <<" | Stale drops:"<<decodingInfo.nNALUQueueStaleDrops<<
+                    "\nOutput buffer hold p99:"<<decodingInfo.p99OutputBufferHold_ms<<"ms | Ownership:"<<(mFrameOwnership==FrameOwnership::COPY ? "copy" : "token")
+                    <<" | Pool allocations:"<<mFramePool->getNAllocations()<<
+                    "\n"<<mFrameLatencyTracker.getStatisticsString();
             MLOGD<<frameLog.str();
+            parsingTimeSinceLog={};
+            waitForInputBSinceLog={};
+            decodingTimeSinceLog={};
         }
     }
 }
@@ -309,5 +727,13 @@ void VideoDecoder::resetStatistics() {
     parsingTime.reset();
     waitForInputB.reset();
     decodingTime.reset();
+    parsingTimeSinceLog={};
+    waitForInputBSinceLog={};
+    decodingTimeSinceLog={};
+    nInputBufferUnavailable=0;
+    nStallRecoveries=0;
+    lastStallRecoveryTime_ms=0;
+    nNALUQueueOverflows=0;
+    nNALUQueueStaleDrops=0;
     decodingInfo={};
 }
\ No newline at end of file
@@ -5,15 +5,18 @@
 #ifndef FPVUE_VIDEODECODER_H
 #define FPVUE_VIDEODECODER_H
 
-#include <media/NdkMediaCodec.h>
-#include <android/log.h>
-#include <jni.h>
 #include <iostream>
 #include <thread>
 #include <atomic>
+#include <optional>
+#include <condition_variable>
 #include "helper/TimeHelper.hpp"
+#include "helper/SPSCQueue.hpp"
+#include "helper/FrameLatencyTracker.hpp"
 #include "NALU/NALU.hpp"
 #include "NALU/KeyFrameFinder.hpp"
+#include "codec/CodecBackend.h"
+#include "codec/DecodedFrame.h"
 
 struct DecodingInfo{
     std::chrono::steady_clock::time_point lastCalculation=std::chrono::steady_clock::now();
@@ -21,10 +24,34 @@ struct DecodingInfo{
     long nNALUSFeeded=0;
     long nDecodedFrames=0;
     float currentFPS=0;
-    static float currentKiloBitsPerSecond;
+    // Read by the render thread while the decoder thread writes them
+    static std::atomic<float> currentKiloBitsPerSecond;
     float avgParsingTime_ms=0;
     float avgWaitForInputBTime_ms=0;
-    static float avgDecodingTime_ms;
+    static std::atomic<float> avgDecodingTime_ms;
+    static std::atomic<float> p99DecodingTime_ms;
+    // Tail latencies of the last recalculation interval
+    float p99ParsingTime_ms=0;
+    float p99WaitForInputBTime_ms=0;
+    // Time from creating the decoder until the first frame came out of it, -1 until then
+    float timeToFirstFrame_ms=-1;
+    // True if the codec was configured from the persisted parameter sets (and the live stream matched them)
+    bool configuredFromCache=false;
+    // Async mode only: NALUs dropped since the codec had no free input buffer
+    long nInputBufferUnavailable=0;
+    // Number of times the stall watchdog had to re-create the codec, and how long the last recovery took
+    // (from detecting the stall until the first frame of the new codec)
+    long nStallRecoveries=0;
+    float lastStallRecoveryTime_ms=0;
+    // NALU queue between the parser and the feeder thread, over the last recalculation interval
+    float avgNALUQueueDepth=0;
+    long maxNALUQueueDepth=0;
+    float p99NALUQueueWait_ms=0;
+    // NALUs dropped since the queue was full / since they waited too long
+    long nNALUQueueOverflows=0;
+    long nNALUQueueStaleDrops=0;
+    // Time from an output buffer becoming available until it was given back to the codec
+    float p99OutputBufferHold_ms=0;
     bool operator==(const DecodingInfo& d2)const{
         return nNALU==d2.nNALU && nNALUSFeeded==d2.nNALUSFeeded && currentFPS==d2.currentFPS &&
                currentKiloBitsPerSecond==d2.currentKiloBitsPerSecond && avgParsingTime_ms==d2.avgParsingTime_ms &&
@@ -45,16 +72,17 @@ struct VideoRatio{
     }
 };
 
-typedef std::function<void(const uint8_t* data,const std::size_t data_length, int32_t width, int32_t height)> NEW_FRAME_CALLBACK;
+// Keep a copy of the frame to use it after the callback returned
+typedef std::function<void(const DecodedFrame& frame)> NEW_FRAME_CALLBACK;
 
 
 // Handles decoding of .h264 and .h265 video
-// with low latency. Uses the AMediaCodec api
+// with low latency. Uses the AMediaCodec api (trough a CodecBackend, such that it can also run on a linux host)
 class VideoDecoder {
 private:
     struct Decoder{
         bool configured= false;
-        AMediaCodec *codec= nullptr;
+        std::unique_ptr<CodecBackend> codec= nullptr;
     };
 public:
     //Make sure to do no heavy lifting on this callback, since it is called from the low-latency mCheckOutputThread thread (best to copy values and leave processing to another thread)
@@ -62,17 +90,43 @@ public:
     typedef std::function<void(const DecodingInfo)> DECODING_INFO_CHANGED_CALLBACK;
     //The decoder ratio callback is called every time the output format changes
     typedef std::function<void(const VideoRatio)> DECODER_RATIO_CHANGED;
+    // SYNCHRONOUS: The feeding thread blocks in dequeueInputBuffer, output is polled on the mCheckOutputThread
+    // ASYNCHRONOUS: Free input buffers are announced by the codec and queued, the feeding thread never blocks.
+    // Output is handled directly in the codec's output callback (no mCheckOutputThread)
+    enum class Mode{SYNCHRONOUS,ASYNCHRONOUS};
+    // The codec is considered stalled if it has not returned an input buffer, or not produced a frame for a
+    // coded slice that was queued, within this window
+    static constexpr auto DEFAULT_STALL_TIMEOUT=std::chrono::milliseconds(500);
+    // A codec may hold back the last access unit until the next one arrives. After a gap in the coded slices this long
+    // (a live stream is faster than 10fps) the stream paused, and the watchdog waits for the output from the next slice on
+    static constexpr auto MIN_INPUT_PAUSE=std::chrono::milliseconds(100);
+    // Coded slices that waited longer than this in the NALU queue are dropped (and feeding resumes at the next IRAP)
+    static constexpr auto MAX_NALU_QUEUE_LATENCY=std::chrono::milliseconds(200);
+    static constexpr size_t NALU_QUEUE_CAPACITY=256;
+    // Above this depth the feeder drops the oldest coded slices as well
+    static constexpr size_t NALU_QUEUE_HIGH_WATERMARK=NALU_QUEUE_CAPACITY*3/4;
+    // COPY: The frame is copied into a pooled buffer and the codec's output buffer is released right away,
+    // such that the codec can continue decoding while the consumer converts / uploads the frame.
+    // TOKEN: Zero copy, the frame references the codec's output buffer which is released once the last copy of
+    // the frame is gone. Only use it if the consumer is fast, the codec stalls while it has no output buffers left.
+    enum class FrameOwnership{COPY,TOKEN};
 public:
     //We cannot initialize the Decoder until we have SPS and PPS data -
     //when streaming this data will be available at some point in future
     //Therefore we don't allocate the MediaCodec resources here
-    VideoDecoder(NEW_FRAME_CALLBACK onNewFrame);
+    // By default the MediaCodecBackend is used on android and the SyntheticCodecBackend everywhere else
+    VideoDecoder(NEW_FRAME_CALLBACK onNewFrame,Mode mode=Mode::SYNCHRONOUS,CODEC_BACKEND_FACTORY codecBackendFactory=nullptr);
+    ~VideoDecoder();
     // This call acquires or releases the output surface
     // After acquiring the surface, the decoder will be started as soon as enough configuration data was passed to it
     // When releasing the surface, the decoder will be stopped if running and any resources will be freed
     // After releasing the surface it is safe for the android os to delete it
     void initDecoder();
     void deinitDecoder();
+    // Create and configure the codec from the parameter sets persisted in cacheFilePath (if any),
+    // instead of waiting for them in the live stream. Meant to be called once at startup, from its own thread.
+    // The live parameter sets are persisted to the same file as soon as the decoder is configured with them.
+    void prewarmFromCache(const std::string& cacheFilePath);
     //register the specified callbacks. Only one can be registered at a time
     void registerOnDecoderRatioChangedCallback(DECODER_RATIO_CHANGED decoderRatioChangedC);
     void registerOnDecodingInfoChangedCallback(DECODING_INFO_CHANGED_CALLBACK decodingInfoChangedCallback);
@@ -80,20 +134,82 @@ public:
     //configure as soon as possible
     // If the input pipe was closed (surface has been removed or is not set yet), only buffer key frames
     void interpretNALU(const NALU& nalu);
+    // Copy the NALU into the queue and return immediately. interpretNALU() is then called on the feeder thread,
+    // such that the receiving thread is never blocked by the codec. May only be called from one thread.
+    void enqueueNALU(const NALU& nalu);
+    // A stalled codec is re-created with the known parameter sets, feeding resumes at the next IRAP frame.
+    // 0 disables the watchdog. Call before the decoder is configured.
+    void setStallTimeout(std::chrono::milliseconds stallTimeout);
+    // Call before the decoder is configured
+    void setFrameOwnership(FrameOwnership frameOwnership);
+    // Stages until the codec output are filled in by the decoder, the following ones by the consumer of the frames
+    FrameLatencyTracker& getFrameLatencyTracker(){
+        return mFrameLatencyTracker;
+    }
 private:
     //Initialize decoder with SPS / PPS data from KeyFrameFinder
     //Set Decoder.configured to true on success
-    void configureStartDecoder();
+    void configureStartDecoder(const KeyFrameFinder& keyFrameFinder);
+    //Detach from the codec (no output is handled anymore) and hand it to the OutputBufferReleaser, which stops and deletes
+    //it once no frame references its buffers. Set Decoder.configured to false
+    void stopDecoder();
+    //Called for every NALU as long as the codec is configured from the cache but the live parameter sets are not known yet
+    void verifyCachedParameterSets(const NALU& nalu);
     //Wait for input buffer to become available before feeding NALU
     void feedDecoder(const NALU& nalu);
-    //Runs until EOS arrives at output buffer or decoder is stopped
+    enum class StallReason{NONE,NO_INPUT_BUFFER,NO_OUTPUT,CODEC_ERROR};
+    StallReason checkForStall(std::chrono::steady_clock::time_point now)const;
+    // Re-create the codec with the parameter sets from mKeyFrameFinder and skip everything until the next IRAP
+    void recoverFromStall(StallReason reason);
+    //Copy the NALU into the input buffer with the given index and queue it
+    void queueInputBuffer(size_t index,const NALU& nalu,std::chrono::steady_clock::time_point feedStart);
+    //Runs until EOS arrives at output buffer, the codec fails or mCheckOutputRunning is cleared
     void checkOutputLoop();
+    //Shared by the synchronous and asynchronous output path
+    void onOutputBuffer(size_t index,const CodecBufferInfo& info);
+    void onOutputFormatChanged(const CodecOutputFormat& format);
+    // Gives output buffers back to the codec, for the current or any previous codec instance.
+    // A FrameOwnership::TOKEN frame points into the codec's output buffer, which is only valid until the codec is
+    // stopped. So on detach() the releaser takes the codec over and stops and deletes it once the last token is gone,
+    // on the thread that drops it. Outlives the decoder as long as a token is still referenced.
+    class OutputBufferReleaser{
+    public:
+        OutputBufferReleaser(CodecBackend* codec,LatencyHistogram& holdTime);
+        // COPY: the buffer is returned right away
+        void release(size_t index,std::chrono::steady_clock::time_point availableSince);
+        // TOKEN: the buffer is referenced until releaseToken()
+        void acquireToken();
+        void releaseToken(size_t index,std::chrono::steady_clock::time_point availableSince);
+        // No buffer is returned anymore. codec (no callbacks / dequeue calls may reach it anymore) is stopped and
+        // deleted right away if no token is outstanding, otherwise by the last releaseToken()
+        void detach(std::unique_ptr<CodecBackend> codec);
+    private:
+        std::mutex mMutex;
+        CodecBackend* mCodec;
+        std::unique_ptr<CodecBackend> mDetachedCodec;
+        int nOutstanding=0;
+        // The histogram is owned by the decoder, only used while attached
+        LatencyHistogram& mHoldTime;
+    };
+    // Async mode: The callbacks of a codec only run while its gate is open. stopDecoder() closes it (waiting for a
+    // callback that is running), such that the codec can outlive the decoder state the callbacks use
+    struct CallbackGate{
+        std::mutex mutex;
+        bool open=true;
+    };
+    // FrameOwnership::TOKEN - owner of the DecodedFrame, releases the output buffer when destroyed
+    class OutputBufferToken;
+    void recalculateDecodingInfoIfNeeded();
     //Debug log
     void printAvgLog();
     void resetStatistics();
+    // Pops the NALU queue and feeds the decoder until the VideoDecoder is destroyed
+    void feederLoop();
     std::unique_ptr<std::thread> mCheckOutputThread= nullptr;
+    std::atomic<bool> mCheckOutputRunning{false};
+    std::shared_ptr<CallbackGate> mCallbackGate;
     bool USE_SW_DECODER_INSTEAD=false;
-    //Holds the AMediaCodec instance, as well as the state (configured or not configured)
+    //Holds the codec instance, as well as the state (configured or not configured)
     Decoder decoder{};
     DecodingInfo decodingInfo;
     // The input pipe is closed until we set a valid surface
@@ -101,23 +217,89 @@ private:
     std::mutex mMutexInputPipe;
     DECODER_RATIO_CHANGED onDecoderRatioChangedCallback= nullptr;
     DECODING_INFO_CHANGED_CALLBACK onDecodingInfoChangedCallback= nullptr;
-    // So we can temporarily attach the output thread to the vm and make ndk calls
-    JavaVM* javaVm=nullptr;
     std::chrono::steady_clock::time_point lastLog=std::chrono::steady_clock::now();
     RelativeCalculator nDecodedFrames;
     RelativeCalculator nNALUBytesFed;
-    AvgCalculator parsingTime;
-    AvgCalculator waitForInputB;
-    AvgCalculator decodingTime;
+    // Written from the feeding and the output thread (async mode: codec callback thread)
+    LatencyHistogram parsingTime;
+    LatencyHistogram waitForInputB;
+    LatencyHistogram decodingTime;
+    // Merged interval snapshots since the last log
+    LatencyHistogram::Snapshot parsingTimeSinceLog;
+    LatencyHistogram::Snapshot waitForInputBSinceLog;
+    LatencyHistogram::Snapshot decodingTimeSinceLog;
+    FrameLatencyTracker mFrameLatencyTracker;
     //Every n ms re-calculate the Decoding info
     static const constexpr auto DECODING_INFO_RECALCULATION_INTERVAL=std::chrono::milliseconds(1000);
     static constexpr const bool PRINT_DEBUG_INFO=true;
     static constexpr auto TIME_BETWEEN_LOGS=std::chrono::seconds(5);
     static constexpr int64_t BUFFER_TIMEOUT_US=35*1000; //40ms (a little bit more than 32 ms (==30 fps))
     const NEW_FRAME_CALLBACK onNewFrame;
+    FrameOwnership mFrameOwnership=FrameOwnership::COPY;
+    // Enough for the frames in flight between decoder and renderer
+    const std::shared_ptr<FramePool> mFramePool=std::make_shared<FramePool>(4);
+    std::shared_ptr<OutputBufferReleaser> mOutputBufferReleaser;
+    LatencyHistogram mOutputBufferHoldTime;
+    const Mode mMode;
+    const CODEC_BACKEND_FACTORY mCodecBackendFactory;
+    // Async mode: Written by the codec's input callback, read by the feeding thread
+    SPSCQueue<int32_t,64> mFreeInputBuffers;
+    // Written by the feeding thread, read by the output thread / callback
+    std::atomic<long> nInputBufferUnavailable{0};
+    // Stall watchdog. The time stamps are in ns since the steady_clock epoch, 0 == not set
+    std::chrono::milliseconds mStallTimeout=DEFAULT_STALL_TIMEOUT;
+    // Feeding thread only: Since when the codec has no input buffer for us
+    std::optional<std::chrono::steady_clock::time_point> mInputUnavailableSince;
+    // Oldest coded slice that was queued after the last frame came out
+    std::atomic<int64_t> mFirstUnansweredInputNs{0};
+    // Feeding thread only: When the last coded slice was queued, 0 == none since the codec was started
+    int64_t mLastSliceInputNs=0;
+    // The output thread / the async error callback saw a codec error
+    std::atomic<bool> mCodecFailed{false};
+    // After a recovery all slices until the next IRAP are dropped
+    bool mSkipUntilIRAP=false;
+    std::atomic<int64_t> mRecoveryStartNs{0};
+    std::atomic<long> nStallRecoveries{0};
+    std::atomic<float> lastStallRecoveryTime_ms{0};
+    int32_t mOutputWidth=0;
+    int32_t mOutputHeight=0;
+    // Layout of the output buffers, written on format change by the same thread that produces the frames
+    CodecOutputFormat mOutputFormat;
 private:
     KeyFrameFinder mKeyFrameFinder;
     bool IS_H265= false;
+    // Parameter sets the codec was speculatively configured with at startup
+    KeyFrameFinder mCachedKeyFrameFinder;
+    std::string mParameterSetCachePath;
+    bool mConfiguredFromCache=false;
+    // False until the live parameter sets have been compared to the cached ones
+    bool mLiveParameterSetsVerified=true;
+    const std::chrono::steady_clock::time_point mCreationTime=std::chrono::steady_clock::now();
+    // NALU queue. Lock-free, the mutex / condition is only used to wake up the feeder thread.
+    // The data is copied into one of a fixed set of slots, which keep their capacity: once they have grown to the
+    // NALU sizes of the stream, enqueueing does not allocate. The feeder hands the slots back through mFreeNALUSlots
+    struct QueuedNALU{
+        uint32_t slot;
+        bool isH265;
+        std::chrono::steady_clock::time_point creationTime;
+        std::chrono::steady_clock::time_point lastPacketTime;
+        std::chrono::steady_clock::time_point enqueueTime;
+    };
+    SPSCQueue<QueuedNALU,NALU_QUEUE_CAPACITY> mNALUQueue;
+    std::vector<std::vector<uint8_t>> mNALUSlots{NALU_QUEUE_CAPACITY};
+    SPSCQueue<uint32_t,NALU_QUEUE_CAPACITY> mFreeNALUSlots;
+    std::mutex mFeederMutex;
+    std::condition_variable mFeederCondition;
+    std::atomic<bool> mFeederRunning{true};
+    std::unique_ptr<std::thread> mFeederThread;
+    // Producer thread only: After a coded slice was dropped on overflow, all slices until the next IRAP are dropped as well
+    bool mEnqueueSkipUntilIRAP=false;
+    LatencyHistogram mNALUQueueWait;
+    std::atomic<uint64_t> mNALUQueueDepthSum{0};
+    std::atomic<uint64_t> mNALUQueueDepthSamples{0};
+    std::atomic<size_t> mNALUQueueDepthMax{0};
+    std::atomic<long> nNALUQueueOverflows{0};
+    std::atomic<long> nNALUQueueStaleDrops{0};
 };
 
 
@@ -1,13 +1,16 @@
 #include "VideoPlayer.h"
 #include "AndroidThreadPrioValues.hpp"
+#ifdef __ANDROID__
 #include "helper/NDKThreadHelper.hpp"
 #include "helper/NDKHelper.hpp"
-#include <android/log.h>
+#endif
+#include "NALU/ParameterSetCache.hpp"
+#include "helper/AndroidLogger.hpp"
 #define MAX_NAL_SIZE 3 * 1024 * 1024  // Taille maximale du tampon NAL (1 Mo)
 
-VideoPlayer::VideoPlayer(NEW_FRAME_CALLBACK onNewFrame):
+VideoPlayer::VideoPlayer(NEW_FRAME_CALLBACK onNewFrame,const VideoDecoder::Mode decoderMode,CODEC_BACKEND_FACTORY codecBackendFactory):
         mParser{std::bind(&VideoPlayer::onNewNALU, this, std::placeholders::_1)},
-        videoDecoder(onNewFrame) {
+        videoDecoder(onNewFrame,decoderMode,std::move(codecBackendFactory)) {
     __android_log_print(ANDROID_LOG_ERROR, "com.geehe.fpvuexr", "VideoPlayer creating");
 //    videoDecoder.registerOnDecoderRatioChangedCallback([this](const VideoRatio ratio) {
 //        const bool changed=ratio!=this->latestVideoRatio;
@@ -22,6 +25,11 @@ VideoPlayer::VideoPlayer(NEW_FRAME_CALLBACK onNewFrame):
     videoDecoder.initDecoder();
 }
 
+VideoPlayer::~VideoPlayer(){
+    // The prewarm thread uses videoDecoder
+    stop();
+}
+
 //Not yet parsed bit stream (e.g. raw h264 or rtp data)
 void VideoPlayer::onNewVideoData(const uint8_t* data, const std::size_t data_length,const VIDEO_DATA_TYPE videoDataType){
     //MLOGD << "onNewVideoData " << data_length;
@@ -156,7 +164,11 @@ uint8_t* VideoPlayer::decodeRTPFrame(const uint8_t* rx_buffer, uint32_t rx_size,
 
 
 void VideoPlayer::onNewNALU(const NALU& nalu){
-    videoDecoder.interpretNALU(nalu);
+    // Feeding happens on the decoder's own thread, the udp receiver only parses
+    videoDecoder.enqueueNALU(nalu);
+    // Neither blocks, see GroundRecorder and PreRollBuffer
+    groundRecorder.onNewNALU(nalu);
+    preRollBuffer.onNewNALU(nalu);
 }
 
 void VideoPlayer::setVideoSurface() {
@@ -166,11 +178,22 @@ void VideoPlayer::setVideoSurface() {
     //videoDecoder.setOutputSurface(env, surface);
 }
 
+void VideoPlayer::prewarmDecoder(const std::string& cacheDirectory,const uint32_t linkId) {
+    const auto cacheFile=ParameterSetCache::fileName(cacheDirectory,linkId,VS_PORT);
+    if(mPrewarmThread.joinable()){
+        mPrewarmThread.join();
+    }
+    mPrewarmThread=std::thread([this,cacheFile]{
+        videoDecoder.prewarmFromCache(cacheFile);
+    });
+#ifdef __ANDROID__
+    NDKThreadHelper::setName(mPrewarmThread.native_handle(),"LLDPrewarm");
+#endif
+}
 
 void VideoPlayer::start() {
     //AAssetManager *assetManager=NDKHelper::getAssetManagerFromContext2(env,androidContext);
     //mParser.setLimitFPS(-1); //Default: Real time !
-    const int VS_PORT=5600;
     const int VS_PROTOCOL=RTP_H265;
     const auto videoDataType=static_cast<VIDEO_DATA_TYPE>(VS_PROTOCOL);
     mUDPReceiver=std::make_unique<UDPReceiver>(javaVm,VS_PORT, "V_UDP_R", FPV_VR_PRIORITY::CPU_PRIORITY_UDPRECEIVER_VIDEO, [this,videoDataType](const uint8_t* data, size_t data_length) {
@@ -184,6 +207,10 @@ void VideoPlayer::stop() {
         mUDPReceiver->stopReceiving();
         mUDPReceiver.reset();
     }
+    groundRecorder.stop();
+    if(mPrewarmThread.joinable()){
+        mPrewarmThread.join();
+    }
 }
 
 std::string VideoPlayer::getInfoString()const{
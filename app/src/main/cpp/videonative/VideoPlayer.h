@@ -8,11 +8,14 @@
 #include "VideoDecoder.h"
 #include "UdpReceiver.h"
 #include "parser/H26XParser.h"
+#include "recorder/GroundRecorder.h"
+#include "recorder/PreRollBuffer.h"
 
 
 class VideoPlayer{
 public:
-    VideoPlayer(NEW_FRAME_CALLBACK onNewFrame);
+    VideoPlayer(NEW_FRAME_CALLBACK onNewFrame,VideoDecoder::Mode decoderMode=VideoDecoder::Mode::SYNCHRONOUS,CODEC_BACKEND_FACTORY codecBackendFactory=nullptr);
+    ~VideoPlayer();
     enum VIDEO_DATA_TYPE{RTP_H264,RAW_H264,RTP_H265,RAW_H265};
     void onNewVideoData(const uint8_t* data,const std::size_t data_length,const VIDEO_DATA_TYPE videoDataType);
     /*
@@ -20,6 +23,11 @@ public:
      * It is guaranteed that the surface is not used by the decoder anymore when this call returns
      */
     void setVideoSurface();
+    /*
+     * Configure the decoder from the parameter sets persisted for this link and stream in cacheDirectory,
+     * on a new thread (joined by stop()). The live parameter sets are persisted there once they are known.
+     */
+    void prewarmDecoder(const std::string& cacheDirectory,uint32_t linkId);
     /*
      * Start the receiver and ground recorder if enabled
      */
@@ -40,13 +48,19 @@ private:
     //Assumptions: Max bitrate: 40 MBit/s, Max time to buffer: 100ms
     //5 MB should be plenty !
     static constexpr const size_t WANTED_UDP_RCVBUF_SIZE=1024*1024*5;
+    static constexpr const int VS_PORT=5600;
     // Retrieve settings from shared preferences
     enum SOURCE_TYPE_OPTIONS{UDP,FILE,ASSETS,VIA_FFMPEG_URL,EXTERNAL};
     const std::string GROUND_RECORDING_DIRECTORY;
     JavaVM* javaVm=nullptr;
     H26XParser mParser;
+    std::thread mPrewarmThread;
 public:
     VideoDecoder videoDecoder;
+    // Started / stopped by the app, records what the parser outputs
+    GroundRecorder groundRecorder;
+    // Always on, the last seconds of video for an instant replay
+    PreRollBuffer preRollBuffer;
     std::unique_ptr<UDPReceiver> mUDPReceiver;
     long nNALUsAtLastCall=0;
 public:
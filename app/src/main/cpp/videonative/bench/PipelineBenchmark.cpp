@@ -0,0 +1,200 @@
+// Host (linux) benchmark of the whole receive -> parse -> feed -> decode -> output path.
+// Sends a synthetic h265 rtp stream over loopback to the VideoPlayer, which decodes it with the SyntheticCodecBackend.
+// For every frame the time from sending its first rtp packet until it arrives in the frame callback is measured.
+//
+// The per stage breakdown of the FrameLatencyTracker is printed as well, and optionally exported as csv.
+// With stallAfterNFrames the first codec wedges after that many frames, which exercises the stall watchdog.
+// With recordPath the stream is recorded by the GroundRecorder at the same time, its counters are printed.
+// With replayPath the PreRollBuffer is exported there at the end, while the stream is still running.
+// First the self test of the FramePacer runs, which only the render loop of the app uses.
+//
+// Usage: PipelineBenchmark [seconds=10] [fps=60] [frameSizeBytes=20000] [decodeLatencyUs=5000] [sync|async] [csvPath] [stallAfterNFrames=0] [copy|token] [recordPath] [replayPath]
+
+#include "../VideoPlayer.h"
+#include "../codec/SyntheticCodecBackend.h"
+#include "../helper/FramePacer.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace{
+    constexpr int VIDEO_PORT=5600;
+    constexpr size_t MAX_RTP_PAYLOAD=1400;
+    // Frames that were never received
+    constexpr int64_t NOT_RECEIVED=-1;
+
+    int64_t nowNs(){
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    class RTPH265Sender{
+    public:
+        RTPH265Sender(){
+            mSocket=socket(AF_INET,SOCK_DGRAM,0);
+            memset(&mAddress,0,sizeof(mAddress));
+            mAddress.sin_family=AF_INET;
+            mAddress.sin_port=htons(VIDEO_PORT);
+            mAddress.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+        }
+        ~RTPH265Sender(){
+            close(mSocket);
+        }
+        // nalu without start code. Single NAL unit packet if it fits, FU packets otherwise
+        void sendNALU(const std::vector<uint8_t>& nalu,const uint32_t timestamp){
+            if(nalu.size()<=MAX_RTP_PAYLOAD){
+                sendPacket(timestamp,nalu.data(),nalu.size(),nullptr,0);
+                return;
+            }
+            const uint8_t type=(nalu[0]>>1) & 0x3F;
+            // FU payload header (type 49) + FU header
+            uint8_t header[3]={(uint8_t)((nalu[0] & 0x81) | (49<<1)),nalu[1],0};
+            size_t offset=2;
+            while(offset<nalu.size()){
+                const size_t size=std::min(MAX_RTP_PAYLOAD,nalu.size()-offset);
+                header[2]=type;
+                if(offset==2)header[2]|=0x80;
+                if(offset+size==nalu.size())header[2]|=0x40;
+                sendPacket(timestamp,header,sizeof(header),&nalu[offset],size);
+                offset+=size;
+            }
+        }
+    private:
+        void sendPacket(const uint32_t timestamp,const uint8_t* header,const size_t headerSize,const uint8_t* payload,const size_t payloadSize){
+            uint8_t packet[12+MAX_RTP_PAYLOAD+3];
+            packet[0]=0x80;
+            packet[1]=96;
+            packet[2]=(uint8_t)(mSequenceNumber>>8);
+            packet[3]=(uint8_t)mSequenceNumber;
+            const uint32_t timestampBe=htonl(timestamp);
+            memcpy(&packet[4],&timestampBe,4);
+            memset(&packet[8],0,4);
+            memcpy(&packet[12],header,headerSize);
+            if(payloadSize>0)memcpy(&packet[12+headerSize],payload,payloadSize);
+            sendto(mSocket,packet,12+headerSize+payloadSize,0,(const sockaddr*)&mAddress,sizeof(mAddress));
+            mSequenceNumber++;
+        }
+        int mSocket;
+        sockaddr_in mAddress{};
+        uint16_t mSequenceNumber=0;
+    };
+
+    std::vector<uint8_t> createNALU(const uint8_t type,const size_t size,const uint64_t tag){
+        std::vector<uint8_t> nalu(std::max(size,(size_t)(2+SyntheticCodecBackend::N_TAG_BYTES)),0xAA);
+        nalu[0]=(uint8_t)(type<<1);
+        nalu[1]=1;
+        memcpy(&nalu[2],&tag,SyntheticCodecBackend::N_TAG_BYTES);
+        return nalu;
+    }
+
+    double percentile(const std::vector<double>& sorted,const double p){
+        if(sorted.empty())return 0;
+        const auto index=std::min(sorted.size()-1,(size_t)(p/100.0*(double)sorted.size()));
+        return sorted[index];
+    }
+}
+
+int main(int argc,char** argv){
+    const int seconds=argc>1 ? atoi(argv[1]) : 10;
+    const int fps=argc>2 ? atoi(argv[2]) : 60;
+    const size_t frameSize=argc>3 ? (size_t)atoi(argv[3]) : 20000;
+    const int decodeLatencyUs=argc>4 ? atoi(argv[4]) : 5000;
+    const bool async=argc>5 && std::string(argv[5])=="async";
+    const std::string csvPath=argc>6 ? argv[6] : "";
+    const size_t stallAfterNFrames=argc>7 ? (size_t)atoi(argv[7]) : 0;
+    const bool tokenOwnership=argc>8 && std::string(argv[8])=="token";
+    const std::string recordPath=argc>9 ? argv[9] : "";
+    const std::string replayPath=argc>10 ? argv[10] : "";
+    const int nFrames=seconds*fps;
+    TEST_FRAME_PACER::test();
+
+    std::vector<int64_t> sendTimeNs(nFrames,0);
+    std::vector<int64_t> receiveTimeNs(nFrames,NOT_RECEIVED);
+    SyntheticCodecBackend::Options options;
+    options.decodeLatency=microseconds(decodeLatencyUs);
+    options.stallAfterNFrames=stallAfterNFrames;
+    VideoPlayer videoPlayer([&receiveTimeNs](const DecodedFrame& frame){
+        uint64_t frameNr;
+        memcpy(&frameNr,frame.data,sizeof(frameNr));
+        if(frameNr<receiveTimeNs.size() && receiveTimeNs[frameNr]==NOT_RECEIVED){
+            receiveTimeNs[frameNr]=nowNs();
+        }
+    },async ? VideoDecoder::Mode::ASYNCHRONOUS : VideoDecoder::Mode::SYNCHRONOUS,[options]()mutable{
+        auto ret=std::make_unique<SyntheticCodecBackend>(options);
+        // Only the first codec stalls, the one re-created by the watchdog has to work
+        options.stallAfterNFrames=0;
+        return ret;
+    });
+    videoPlayer.videoDecoder.setFrameOwnership(tokenOwnership ? VideoDecoder::FrameOwnership::TOKEN : VideoDecoder::FrameOwnership::COPY);
+    videoPlayer.start();
+    if(!recordPath.empty() && !videoPlayer.groundRecorder.start(recordPath)){
+        return 1;
+    }
+    std::this_thread::sleep_for(milliseconds(100));
+
+    RTPH265Sender sender;
+    const auto frameInterval=nanoseconds(1000000000/fps);
+    auto nextFrame=steady_clock::now();
+    for(int i=0;i<nFrames;i++){
+        std::this_thread::sleep_until(nextFrame);
+        nextFrame+=frameInterval;
+        const uint32_t timestamp=(uint32_t)(i*90000/fps);
+        sendTimeNs[i]=nowNs();
+        if(!replayPath.empty() && i==nFrames-fps/2){
+            videoPlayer.preRollBuffer.exportTo(replayPath);
+        }
+        if(i%fps==0){
+            // VPS,SPS,PPS + IDR once per second
+            sender.sendNALU(createNALU(32,24,0),timestamp);
+            sender.sendNALU(createNALU(33,40,0),timestamp);
+            sender.sendNALU(createNALU(34,12,0),timestamp);
+            sender.sendNALU(createNALU(19,frameSize*4,i),timestamp);
+        }else{
+            sender.sendNALU(createNALU(1,frameSize,i),timestamp);
+        }
+    }
+    std::this_thread::sleep_for(milliseconds(500));
+    const auto recorderStats=videoPlayer.groundRecorder.getStats();
+    const auto preRollStats=videoPlayer.preRollBuffer.getStats();
+    videoPlayer.stop();
+    videoPlayer.videoDecoder.deinitDecoder();
+    if(!csvPath.empty()){
+        videoPlayer.videoDecoder.getFrameLatencyTracker().exportCSV(csvPath);
+    }
+
+    std::vector<double> latenciesMs;
+    for(int i=0;i<nFrames;i++){
+        if(receiveTimeNs[i]!=NOT_RECEIVED){
+            latenciesMs.push_back((double)(receiveTimeNs[i]-sendTimeNs[i])/1000000.0);
+        }
+    }
+    std::sort(latenciesMs.begin(),latenciesMs.end());
+    double sum=0;
+    for(const auto latency:latenciesMs)sum+=latency;
+    printf("mode:%s ownership:%s fps:%d frameSize:%zu decodeLatency:%dus\n",async ? "async" : "sync",tokenOwnership ? "token" : "copy",fps,frameSize,decodeLatencyUs);
+    printf("frames sent:%d received:%zu\n",nFrames,latenciesMs.size());
+    if(stallAfterNFrames!=0){
+        printf("stall after %zu frames\n",stallAfterNFrames);
+    }
+    if(!latenciesMs.empty()){
+        printf("send->frame latency ms avg:%.3f p50:%.3f p90:%.3f p99:%.3f max:%.3f\n",sum/(double)latenciesMs.size(),
+               percentile(latenciesMs,50),percentile(latenciesMs,90),percentile(latenciesMs,99),latenciesMs.back());
+    }
+    if(!recordPath.empty()){
+        printf("recorded NALUs:%llu dropped:%llu write errors:%llu bytes written:%llu write throughput:%.1fMB/s\n",
+               (unsigned long long)recorderStats.nNALUsRecorded,(unsigned long long)recorderStats.nNALUsDropped,
+               (unsigned long long)recorderStats.nWriteErrors,(unsigned long long)recorderStats.nBytesWritten,recorderStats.writeMBytesPerSecond);
+    }
+    if(!replayPath.empty()){
+        printf("pre-roll buffered:%.1fMB %zu GOPs %lldms exports:%llu errors:%llu dropped NALUs:%llu\n",preRollStats.nBytes/(1024.0*1024.0),
+               preRollStats.nGOPs,(long long)preRollStats.duration.count(),(unsigned long long)preRollStats.nExports,
+               (unsigned long long)preRollStats.nExportErrors,(unsigned long long)preRollStats.nNALUsDropped);
+    }
+    printf("%s\n",videoPlayer.videoDecoder.getFrameLatencyTracker().getStatisticsString().c_str());
+    return latenciesMs.empty() ? 1 : 0;
+}
@@ -0,0 +1,203 @@
+// Host benchmark of the YUVConverter. For 1080p and 4K frames in the padded layout hardware decoders typically
+// report (stride aligned to 128 bytes, slice height aligned to 32 rows, 1080 / 2160 visible rows), every supported
+// path is first checked to be bit-identical to the scalar one, then timed per frame.
+// The fused downscale (4K / 2.7K to the texture size a ~74 degree wide screen needs) is checked and timed the same
+// way, reporting conversion time and the RGBA bytes that go through the texture upload per frame.
+// The 10 bit (P010) path has to match the 8 bit path on the same image narrowed by hand.
+//
+// Usage: YUVConverterBenchmark [nFrames=200] [nThreads=hardware concurrency]
+
+#include "../convert/YUVConverter.h"
+#include "../helper/TimeHelper.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace{
+    struct TestImage{
+        std::vector<uint8_t> data;
+        SemiPlanarImage image;
+    };
+    int32_t alignUp(const int32_t value,const int32_t alignment){
+        return (value+alignment-1)/alignment*alignment;
+    }
+    TestImage createTestImage(const int32_t width,const int32_t height,const int32_t cropLeft,const bool vuOrder,const bool p010=false){
+        TestImage ret;
+        ret.image.p010=p010;
+        ret.image.stride=alignUp(width*ret.image.getBytesPerSample(),128);
+        ret.image.sliceHeight=alignUp(height,32);
+        ret.data.resize((size_t)ret.image.stride*ret.image.sliceHeight*3/2);
+        // Random content hits the saturation in every channel
+        std::mt19937 random(width*height);
+        for(auto& value:ret.data)value=(uint8_t)random();
+        ret.image.data=ret.data.data();
+        ret.image.cropLeft=cropLeft;
+        ret.image.cropTop=0;
+        ret.image.cropRight=width-1;
+        ret.image.cropBottom=height-1;
+        ret.image.vuOrder=vuOrder;
+        return ret;
+    }
+    std::vector<uint8_t> convert(YUVConverter& converter,const SemiPlanarImage& image){
+        std::vector<uint8_t> ret((size_t)image.getWidth()*image.getHeight()*4);
+        converter.convert(image,ret.data(),(size_t)image.getWidth()*4);
+        return ret;
+    }
+    std::vector<uint8_t> convertScaled(YUVConverter& converter,const SemiPlanarImage& image,const int32_t width,const int32_t height){
+        std::vector<uint8_t> ret((size_t)width*height*4);
+        converter.convertScaled(image,ret.data(),(size_t)width*4,width,height);
+        return ret;
+    }
+    // A flat image has to stay flat (and the same colour) when resampled
+    bool checkFlatScaled(YUVConverter& converter){
+        auto test=createTestImage(640,360,0,false);
+        const size_t lumaSize=(size_t)test.image.stride*test.image.sliceHeight;
+        std::fill(test.data.begin(),test.data.begin()+lumaSize,(uint8_t)100);
+        for(size_t i=lumaSize;i<test.data.size();i+=2){
+            test.data[i]=90;
+            test.data[i+1]=170;
+        }
+        const auto reference=convert(converter,test.image);
+        const auto scaled=convertScaled(converter,test.image.zoomed(1.5f),301,177);
+        for(size_t i=0;i<scaled.size();i++){
+            if(scaled[i]!=reference[i%4])return false;
+        }
+        return true;
+    }
+    // The P010 image narrowed to 8 bit by hand, such that the converter's P010 path can be compared against its 8 bit one
+    TestImage narrowTo8Bit(const TestImage& p010){
+        TestImage ret=p010;
+        ret.image.p010=false;
+        ret.image.stride=p010.image.stride/2;
+        ret.data.resize(p010.data.size()/2);
+        for(size_t i=0;i<ret.data.size();i++){
+            const uint32_t value=p010.data[i*2] | (p010.data[i*2+1]<<8);
+            ret.data[i]=(uint8_t)(std::min<uint32_t>(value+128,0xFFFF)>>8);
+        }
+        ret.image.data=ret.data.data();
+        return ret;
+    }
+    double megaBytes(const size_t bytes){
+        return bytes/(1024.0*1024.0);
+    }
+}
+
+int main(int argc,char** argv){
+    const int nFrames=argc>1 ? atoi(argv[1]) : 200;
+    const size_t nThreads=argc>2 ? (size_t)atoi(argv[2]) : std::max(1u,std::thread::hardware_concurrency());
+    const std::vector<YUVConverter::Path> paths={YUVConverter::Path::SCALAR,YUVConverter::Path::SSE2,YUVConverter::Path::AVX2,YUVConverter::Path::NEON};
+    bool allBitExact=true;
+    for(const auto& size:std::vector<std::pair<int32_t,int32_t>>{{1920,1080},{3840,2160}}){
+        // Odd crop and both chroma orders only for the bit-exactness check
+        for(const int32_t cropLeft:{0,1}){
+            for(const bool vuOrder:{false,true}){
+                const auto test=createTestImage(size.first,size.second,cropLeft,vuOrder);
+                YUVConverter scalar(1,YUVConverter::Path::SCALAR);
+                const auto reference=convert(scalar,test.image);
+                for(const auto path:paths){
+                    if(!YUVConverter::isSupported(path))continue;
+                    YUVConverter converter(nThreads,path);
+                    if(convert(converter,test.image)!=reference){
+                        printf("%dx%d crop left %d %s: %s differs from scalar\n",size.first,size.second,cropLeft,vuOrder ? "NV21" : "NV12",YUVConverter::pathName(path));
+                        allBitExact=false;
+                    }
+                }
+            }
+        }
+        const auto test=createTestImage(size.first,size.second,0,false);
+        std::vector<uint8_t> rgba((size_t)size.first*size.second*4);
+        for(const auto path:paths){
+            if(!YUVConverter::isSupported(path))continue;
+            for(const size_t threads:{(size_t)1,nThreads}){
+                YUVConverter converter(threads,path);
+                LatencyHistogram conversionTime;
+                for(int i=0;i<nFrames;i++){
+                    const auto before=std::chrono::steady_clock::now();
+                    converter.convert(test.image,rgba.data(),(size_t)size.first*4);
+                    conversionTime.add(std::chrono::steady_clock::now()-before);
+                }
+                const auto snapshot=conversionTime.getSnapshot();
+                printf("%dx%d %-6s threads:%zu avg:%.3fms p50:%.3fms p99:%.3fms\n",size.first,size.second,YUVConverter::pathName(path),threads,
+                       snapshot.getAvg_ms(),snapshot.getPercentile_ms(50),snapshot.getPercentile_ms(99));
+                if(threads==nThreads)break;
+            }
+        }
+    }
+    // Fused crop and downscale
+    const std::vector<std::pair<int32_t,int32_t>> scaledSizes={{3840,2160},{2704,1520}};
+    const int32_t TARGET_WIDTH=1856;
+    for(const auto& size:scaledSizes){
+        const auto test=createTestImage(size.first,size.second,0,false);
+        const int32_t targetHeight=(int32_t)((int64_t)TARGET_WIDTH*size.second/size.first) & ~1;
+        for(const float zoom:{1.0f,2.0f}){
+            const auto zoomed=test.image.zoomed(zoom);
+            YUVConverter scalar(1,YUVConverter::Path::SCALAR);
+            const auto reference=convertScaled(scalar,zoomed,TARGET_WIDTH,targetHeight);
+            for(const auto path:paths){
+                if(!YUVConverter::isSupported(path))continue;
+                YUVConverter converter(nThreads,path);
+                if(convertScaled(converter,zoomed,TARGET_WIDTH,targetHeight)!=reference){
+                    printf("%dx%d zoom %.1f scaled: %s differs from scalar\n",size.first,size.second,zoom,YUVConverter::pathName(path));
+                    allBitExact=false;
+                }
+            }
+        }
+        YUVConverter converter(nThreads);
+        std::vector<uint8_t> rgba((size_t)size.first*size.second*4);
+        for(const bool scaled:{false,true}){
+            const int32_t width=scaled ? TARGET_WIDTH : size.first;
+            const int32_t height=scaled ? targetHeight : size.second;
+            LatencyHistogram conversionTime;
+            for(int i=0;i<nFrames;i++){
+                const auto before=std::chrono::steady_clock::now();
+                converter.convertScaled(test.image,rgba.data(),(size_t)width*4,width,height);
+                conversionTime.add(std::chrono::steady_clock::now()-before);
+            }
+            const auto snapshot=conversionTime.getSnapshot();
+            const size_t uploadBytes=(size_t)width*height*4;
+            printf("%dx%d -> %dx%d %-6s threads:%zu avg:%.3fms p99:%.3fms upload:%.1fMB/frame %.0fMB/s at 60fps\n",size.first,size.second,width,height,
+                   YUVConverter::pathName(converter.getPath()),converter.getNThreads(),snapshot.getAvg_ms(),snapshot.getPercentile_ms(99),
+                   megaBytes(uploadBytes),megaBytes(uploadBytes)*60);
+        }
+    }
+    // 10 bit (P010), 4K has to fit the 60fps frame budget
+    for(const auto& size:std::vector<std::pair<int32_t,int32_t>>{{1920,1080},{3840,2160}}){
+        for(const int32_t cropLeft:{0,1}){
+            const auto test=createTestImage(size.first,size.second,cropLeft,false,true);
+            YUVConverter scalar(1,YUVConverter::Path::SCALAR);
+            const auto reference=convert(scalar,narrowTo8Bit(test).image);
+            const int32_t targetHeight=(int32_t)((int64_t)TARGET_WIDTH*size.second/size.first) & ~1;
+            const auto scaledReference=convertScaled(scalar,narrowTo8Bit(test).image,TARGET_WIDTH,targetHeight);
+            for(const auto path:paths){
+                if(!YUVConverter::isSupported(path))continue;
+                YUVConverter converter(nThreads,path);
+                if(convert(converter,test.image)!=reference || convertScaled(converter,test.image,TARGET_WIDTH,targetHeight)!=scaledReference){
+                    printf("%dx%d crop left %d P010: %s differs from 8 bit\n",size.first,size.second,cropLeft,YUVConverter::pathName(path));
+                    allBitExact=false;
+                }
+            }
+        }
+        const auto test=createTestImage(size.first,size.second,0,false,true);
+        std::vector<uint8_t> rgba((size_t)size.first*size.second*4);
+        YUVConverter converter(nThreads);
+        LatencyHistogram conversionTime;
+        for(int i=0;i<nFrames;i++){
+            const auto before=std::chrono::steady_clock::now();
+            converter.convert(test.image,rgba.data(),(size_t)size.first*4);
+            conversionTime.add(std::chrono::steady_clock::now()-before);
+        }
+        const auto snapshot=conversionTime.getSnapshot();
+        printf("%dx%d P010 %-6s threads:%zu avg:%.3fms p99:%.3fms (60fps budget 16.7ms)\n",size.first,size.second,YUVConverter::pathName(converter.getPath()),
+               converter.getNThreads(),snapshot.getAvg_ms(),snapshot.getPercentile_ms(99));
+    }
+    YUVConverter flatConverter(1);
+    if(!checkFlatScaled(flatConverter)){
+        printf("flat image changed by scaling\n");
+        allBitExact=false;
+    }
+    printf("bit exact: %s\n",allBitExact ? "yes" : "NO");
+    return allBitExact ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#ifndef FPVUE_CODECBACKEND_H
+#define FPVUE_CODECBACKEND_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include "../NALU/KeyFrameFinder.hpp"
+
+// Subset of the AMediaCodec api used by the VideoDecoder. Decouples the decoder logic from android,
+// such that the whole receive -> parse -> feed -> output path can also run (and be benchmarked) on a linux host.
+// Return values and flags use the same values as their AMediaCodec counterparts.
+
+struct CodecBufferInfo{
+    int32_t offset=0;
+    int32_t size=0;
+    int64_t presentationTimeUs=0;
+    uint32_t flags=0;
+};
+
+struct CodecOutputFormat{
+    // MediaCodecInfo.CodecCapabilities.COLOR_FormatYUVP010, what decoders output for 10 bit (e.g. HEVC Main10) content
+    static constexpr int32_t COLOR_FORMAT_YUV_P010=54;
+    int32_t width=0;
+    int32_t height=0;
+    int32_t colorFormat=0;
+    // Memory layout of the (semi planar) output buffers. Bytes per row of the Y and the interleaved UV plane,
+    // and rows of the Y plane including padding (the UV plane starts at stride*sliceHeight)
+    int32_t stride=0;
+    int32_t sliceHeight=0;
+    // Visible rectangle, inclusive like the MediaFormat crop keys
+    int32_t cropLeft=0;
+    int32_t cropTop=0;
+    int32_t cropRight=-1;
+    int32_t cropBottom=-1;
+    // Fill in whatever the codec did not report: No padding, no crop
+    void applyDefaultLayout(){
+        if(stride<width)stride=width;
+        if(sliceHeight<height)sliceHeight=height;
+        if(cropRight<cropLeft || cropRight>=width)cropRight=width-1;
+        if(cropBottom<cropTop || cropBottom>=height)cropBottom=height-1;
+    }
+    // Human readable, for logging only
+    std::string description;
+};
+
+class CodecBackend{
+public:
+    // dequeueInputBuffer / dequeueOutputBuffer
+    static constexpr ssize_t INFO_TRY_AGAIN_LATER=-1;
+    static constexpr ssize_t INFO_OUTPUT_FORMAT_CHANGED=-2;
+    static constexpr ssize_t INFO_OUTPUT_BUFFERS_CHANGED=-3;
+    // Any other negative value means the codec is in a state where it cannot be used (e.g. stopped)
+    static constexpr ssize_t ERROR_UNKNOWN=-10000;
+    static constexpr uint32_t BUFFER_FLAG_CODEC_CONFIG=2;
+    static constexpr uint32_t BUFFER_FLAG_END_OF_STREAM=4;
+    // Asynchronous mode. The callbacks are invoked on a thread owned by the backend
+    struct AsyncCallbacks{
+        std::function<void(int32_t index)> onInputAvailable;
+        std::function<void(int32_t index,const CodecBufferInfo& info)> onOutputAvailable;
+        std::function<void(const CodecOutputFormat& format)> onFormatChanged;
+        std::function<void(int error,const std::string& detail)> onError;
+    };
+public:
+    virtual ~CodecBackend()=default;
+    // Human readable, for logging only
+    virtual std::string getName()const=0;
+    // Create and configure a h264 / h265 decoder with the parameter sets held by keyFrameFinder.
+    // If asyncCallbacks!=nullptr the codec runs in asynchronous mode and the dequeue methods must not be used.
+    virtual bool configure(bool IS_H265,const KeyFrameFinder& keyFrameFinder,const AsyncCallbacks* asyncCallbacks)=0;
+    virtual bool start()=0;
+    // Once this returns no async callbacks are invoked anymore and any blocked / following dequeueOutputBuffer()
+    // returns an error. Only the destructor may be called afterwards.
+    virtual void stop()=0;
+    virtual ssize_t dequeueInputBuffer(int64_t timeoutUs)=0;
+    virtual uint8_t* getInputBuffer(size_t index,size_t* outSize)=0;
+    virtual void queueInputBuffer(size_t index,size_t size,uint64_t presentationTimeUs,uint32_t flags)=0;
+    virtual ssize_t dequeueOutputBuffer(CodecBufferInfo& info,int64_t timeoutUs)=0;
+    virtual uint8_t* getOutputBuffer(size_t index,size_t* outSize)=0;
+    virtual CodecOutputFormat getOutputFormat()=0;
+    virtual void releaseOutputBuffer(size_t index,int64_t renderTimestampNs)=0;
+};
+
+// Creates a new (not yet configured) backend every time the decoder is (re-) configured
+typedef std::function<std::unique_ptr<CodecBackend>()> CODEC_BACKEND_FACTORY;
+
+#endif //FPVUE_CODECBACKEND_H
@@ -0,0 +1,80 @@
+#ifndef FPVUE_DECODEDFRAME_H
+#define FPVUE_DECODEDFRAME_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "CodecBackend.h"
+
+// A decoded frame as handed to the consumer (NEW_FRAME_CALLBACK). The data stays valid as long as a copy of
+// the frame (and therefore of owner) exists - copying the frame is cheap, the pixels are never copied by it.
+// Depending on the VideoDecoder::FrameOwnership the owner is either a pooled buffer or a token that returns the
+// codec's own output buffer once the last reference is gone.
+struct DecodedFrame{
+    const uint8_t* data=nullptr;
+    size_t size=0;
+    // Coded size and memory layout, see CodecOutputFormat
+    int32_t width=0;
+    int32_t height=0;
+    int32_t colorFormat=0;
+    int32_t stride=0;
+    int32_t sliceHeight=0;
+    int32_t cropLeft=0;
+    int32_t cropTop=0;
+    int32_t cropRight=-1;
+    int32_t cropBottom=-1;
+    // The presentation time stamp the frame was queued with, the key for the FrameLatencyTracker
+    uint64_t pts=0;
+    std::shared_ptr<const void> owner;
+};
+
+// Recycles the (large) buffers decoded frames are copied into, such that no allocation happens per frame.
+// Buffers are returned automatically once their last reference is gone, even if that happens on another thread.
+// Buffers of a different size (e.g. after a resolution change) are discarded instead of pooled.
+class FramePool: public std::enable_shared_from_this<FramePool>{
+public:
+    explicit FramePool(const size_t maxPooledBuffers):MAX_POOLED_BUFFERS(maxPooledBuffers){}
+    std::shared_ptr<std::vector<uint8_t>> acquire(const size_t size){
+        std::unique_ptr<std::vector<uint8_t>> buffer;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            while(!buffer && !mFreeBuffers.empty()){
+                auto candidate=std::move(mFreeBuffers.back());
+                mFreeBuffers.pop_back();
+                if(candidate->size()==size)buffer=std::move(candidate);
+            }
+            if(!buffer)nAllocations++;
+        }
+        if(!buffer){
+            buffer=std::make_unique<std::vector<uint8_t>>(size);
+        }
+        std::weak_ptr<FramePool> pool=weak_from_this();
+        return std::shared_ptr<std::vector<uint8_t>>(buffer.release(),[pool](std::vector<uint8_t>* released){
+            if(auto strongPool=pool.lock()){
+                strongPool->recycle(std::unique_ptr<std::vector<uint8_t>>(released));
+            }else{
+                delete released;
+            }
+        });
+    }
+    // Number of buffers allocated so far. Stays constant once the pool is warm
+    size_t getNAllocations(){
+        std::lock_guard<std::mutex> lock(mMutex);
+        return nAllocations;
+    }
+private:
+    void recycle(std::unique_ptr<std::vector<uint8_t>> buffer){
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(mFreeBuffers.size()<MAX_POOLED_BUFFERS){
+            mFreeBuffers.push_back(std::move(buffer));
+        }
+    }
+    const size_t MAX_POOLED_BUFFERS;
+    std::mutex mMutex;
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> mFreeBuffers;
+    size_t nAllocations=0;
+};
+
+#endif //FPVUE_DECODEDFRAME_H
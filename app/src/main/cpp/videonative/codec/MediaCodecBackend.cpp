@@ -0,0 +1,169 @@
+#include "MediaCodecBackend.h"
+#include "../helper/AndroidLogger.hpp"
+#include "../helper/AndroidMediaFormatHelper.h"
+#include <media/NdkMediaFormat.h>
+
+MediaCodecBackend::~MediaCodecBackend() {
+    if(mCodec!=nullptr){
+        AMediaCodec_delete(mCodec);
+    }
+}
+
+std::string MediaCodecBackend::getName() const {
+    if(mCodec==nullptr)return "MediaCodec";
+    char* name=nullptr;
+    if(AMediaCodec_getName(mCodec,&name)!=AMEDIA_OK){
+        return "MediaCodec";
+    }
+    std::string ret(name);
+    AMediaCodec_releaseName(mCodec,name);
+    return ret;
+}
+
+bool MediaCodecBackend::configure(const bool IS_H265,const KeyFrameFinder& keyFrameFinder,const AsyncCallbacks* asyncCallbacks) {
+    const std::string MIME = IS_H265 ? "video/hevc" : "video/avc";
+    mCodec = AMediaCodec_createDecoderByType(MIME.c_str());
+    if(mCodec==nullptr){
+        MLOGE<<"Cannot create decoder for "<<MIME;
+        return false;
+    }
+    AMediaFormat* format=AMediaFormat_new();
+    // Only for android 31
+    AMediaFormat_setString(format,AMEDIAFORMAT_KEY_MIME,MIME.c_str());
+
+// AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_COLOR_FORMAT, 2130747392);
+
+   AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_LOW_LATENCY, 1);
+//    // MediaCodec supports two priorities: 0 - realtime, 1 - best effort
+   AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_PRIORITY, 0);
+
+    if(IS_H265){
+        h265_configureAMediaFormat(keyFrameFinder,format);
+    }else{
+        h264_configureAMediaFormat(keyFrameFinder,format);
+    }
+
+    MLOGD << "Configuring decoder:" << AMediaFormat_toString(format);
+
+    if(asyncCallbacks!=nullptr){
+        mAsyncCallbacks=*asyncCallbacks;
+        // Has to be set before AMediaCodec_configure
+        const AMediaCodecOnAsyncNotifyCallback callback{
+                .onAsyncInputAvailable=&MediaCodecBackend::onAsyncInputAvailable,
+                .onAsyncOutputAvailable=&MediaCodecBackend::onAsyncOutputAvailable,
+                .onAsyncFormatChanged=&MediaCodecBackend::onAsyncFormatChanged,
+                .onAsyncError=&MediaCodecBackend::onAsyncError
+        };
+        if(AMediaCodec_setAsyncNotifyCallback(mCodec,callback,this)!=AMEDIA_OK){
+            MLOGE<<"Cannot set async callback";
+        }
+    }
+    const auto result=AMediaCodec_configure(mCodec,format, nullptr, nullptr, 0);
+    AMediaFormat_delete(format);
+    if(result!=AMEDIA_OK){
+        MLOGE<<"Cannot configure decoder "<<(int)result;
+        return false;
+    }
+    return true;
+}
+
+bool MediaCodecBackend::start() {
+    {
+        std::lock_guard<std::mutex> lock(mCallbackMutex);
+        mStopped=false;
+    }
+    return AMediaCodec_start(mCodec)==AMEDIA_OK;
+}
+
+void MediaCodecBackend::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mCallbackMutex);
+        mStopped=true;
+    }
+    AMediaCodec_stop(mCodec);
+}
+
+ssize_t MediaCodecBackend::dequeueInputBuffer(const int64_t timeoutUs) {
+    return AMediaCodec_dequeueInputBuffer(mCodec,timeoutUs);
+}
+
+uint8_t* MediaCodecBackend::getInputBuffer(const size_t index,size_t* outSize) {
+    return AMediaCodec_getInputBuffer(mCodec,index,outSize);
+}
+
+void MediaCodecBackend::queueInputBuffer(const size_t index,const size_t size,const uint64_t presentationTimeUs,const uint32_t flags) {
+    AMediaCodec_queueInputBuffer(mCodec,index,0,size,presentationTimeUs,flags);
+}
+
+ssize_t MediaCodecBackend::dequeueOutputBuffer(CodecBufferInfo& info,const int64_t timeoutUs) {
+    AMediaCodecBufferInfo bufferInfo;
+    const ssize_t index=AMediaCodec_dequeueOutputBuffer(mCodec,&bufferInfo,timeoutUs);
+    if(index>=0){
+        info={bufferInfo.offset,bufferInfo.size,bufferInfo.presentationTimeUs,bufferInfo.flags};
+    }
+    return index;
+}
+
+uint8_t* MediaCodecBackend::getOutputBuffer(const size_t index,size_t* outSize) {
+    return AMediaCodec_getOutputBuffer(mCodec,index,outSize);
+}
+
+CodecOutputFormat MediaCodecBackend::getOutputFormat() {
+    AMediaFormat* format=AMediaCodec_getOutputFormat(mCodec);
+    const auto ret=toCodecOutputFormat(format);
+    AMediaFormat_delete(format);
+    return ret;
+}
+
+void MediaCodecBackend::releaseOutputBuffer(const size_t index,const int64_t renderTimestampNs) {
+    AMediaCodec_releaseOutputBufferAtTime(mCodec,index,renderTimestampNs);
+}
+
+CodecOutputFormat MediaCodecBackend::toCodecOutputFormat(AMediaFormat* format) {
+    CodecOutputFormat ret;
+    AMediaFormat_getInt32(format,AMEDIAFORMAT_KEY_WIDTH,&ret.width);
+    AMediaFormat_getInt32(format,AMEDIAFORMAT_KEY_HEIGHT,&ret.height);
+    AMediaFormat_getInt32(format,AMEDIAFORMAT_KEY_COLOR_FORMAT,&ret.colorFormat);
+    AMediaFormat_getInt32(format,AMEDIAFORMAT_KEY_STRIDE,&ret.stride);
+    AMediaFormat_getInt32(format,AMEDIAFORMAT_KEY_SLICE_HEIGHT,&ret.sliceHeight);
+    if(!AMediaFormat_getRect(format,AMEDIAFORMAT_KEY_DISPLAY_CROP,&ret.cropLeft,&ret.cropTop,&ret.cropRight,&ret.cropBottom)){
+        // Older decoders only report the separate keys
+        AMediaFormat_getInt32(format,"crop-left",&ret.cropLeft);
+        AMediaFormat_getInt32(format,"crop-top",&ret.cropTop);
+        AMediaFormat_getInt32(format,"crop-right",&ret.cropRight);
+        AMediaFormat_getInt32(format,"crop-bottom",&ret.cropBottom);
+    }
+    ret.applyDefaultLayout();
+    ret.description=AMediaFormat_toString(format);
+    return ret;
+}
+
+// The async callbacks are called on the codec's own looper thread, and forwarded until stop()
+void MediaCodecBackend::onAsyncInputAvailable(AMediaCodec* codec,void* userdata,int32_t index) {
+    auto* self=static_cast<MediaCodecBackend*>(userdata);
+    std::lock_guard<std::mutex> lock(self->mCallbackMutex);
+    if(self->mStopped)return;
+    self->mAsyncCallbacks.onInputAvailable(index);
+}
+
+void MediaCodecBackend::onAsyncOutputAvailable(AMediaCodec* codec,void* userdata,int32_t index,AMediaCodecBufferInfo* bufferInfo) {
+    const CodecBufferInfo info{bufferInfo->offset,bufferInfo->size,bufferInfo->presentationTimeUs,bufferInfo->flags};
+    auto* self=static_cast<MediaCodecBackend*>(userdata);
+    std::lock_guard<std::mutex> lock(self->mCallbackMutex);
+    if(self->mStopped)return;
+    self->mAsyncCallbacks.onOutputAvailable(index,info);
+}
+
+void MediaCodecBackend::onAsyncFormatChanged(AMediaCodec* codec,void* userdata,AMediaFormat* format) {
+    auto* self=static_cast<MediaCodecBackend*>(userdata);
+    std::lock_guard<std::mutex> lock(self->mCallbackMutex);
+    if(self->mStopped)return;
+    self->mAsyncCallbacks.onFormatChanged(toCodecOutputFormat(format));
+}
+
+void MediaCodecBackend::onAsyncError(AMediaCodec* codec,void* userdata,media_status_t error,int32_t actionCode,const char* detail) {
+    auto* self=static_cast<MediaCodecBackend*>(userdata);
+    std::lock_guard<std::mutex> lock(self->mCallbackMutex);
+    if(self->mStopped)return;
+    self->mAsyncCallbacks.onError((int)error,detail!=nullptr ? detail : "");
+}
@@ -0,0 +1,39 @@
+#ifndef FPVUE_MEDIACODECBACKEND_H
+#define FPVUE_MEDIACODECBACKEND_H
+
+#include "CodecBackend.h"
+#include <media/NdkMediaCodec.h>
+#include <mutex>
+
+// The (hardware) android decoder. Thin wrapper around AMediaCodec
+class MediaCodecBackend: public CodecBackend{
+public:
+    MediaCodecBackend()=default;
+    ~MediaCodecBackend() override;
+    MediaCodecBackend(const MediaCodecBackend&)=delete;
+    std::string getName()const override;
+    bool configure(bool IS_H265,const KeyFrameFinder& keyFrameFinder,const AsyncCallbacks* asyncCallbacks) override;
+    bool start() override;
+    void stop() override;
+    ssize_t dequeueInputBuffer(int64_t timeoutUs) override;
+    uint8_t* getInputBuffer(size_t index,size_t* outSize) override;
+    void queueInputBuffer(size_t index,size_t size,uint64_t presentationTimeUs,uint32_t flags) override;
+    ssize_t dequeueOutputBuffer(CodecBufferInfo& info,int64_t timeoutUs) override;
+    uint8_t* getOutputBuffer(size_t index,size_t* outSize) override;
+    CodecOutputFormat getOutputFormat() override;
+    void releaseOutputBuffer(size_t index,int64_t renderTimestampNs) override;
+private:
+    static CodecOutputFormat toCodecOutputFormat(AMediaFormat* format);
+    static void onAsyncInputAvailable(AMediaCodec* codec,void* userdata,int32_t index);
+    static void onAsyncOutputAvailable(AMediaCodec* codec,void* userdata,int32_t index,AMediaCodecBufferInfo* bufferInfo);
+    static void onAsyncFormatChanged(AMediaCodec* codec,void* userdata,AMediaFormat* format);
+    static void onAsyncError(AMediaCodec* codec,void* userdata,media_status_t error,int32_t actionCode,const char* detail);
+    AMediaCodec* mCodec=nullptr;
+    AsyncCallbacks mAsyncCallbacks;
+    // AMediaCodec_stop() does not wait for a callback that is running on the looper thread. Held while forwarding one,
+    // no callback is forwarded once stop() returned
+    std::mutex mCallbackMutex;
+    bool mStopped=false;
+};
+
+#endif //FPVUE_MEDIACODECBACKEND_H
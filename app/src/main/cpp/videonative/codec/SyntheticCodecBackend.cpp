@@ -0,0 +1,214 @@
+#include "SyntheticCodecBackend.h"
+#include "../helper/AndroidLogger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+using namespace std::chrono;
+
+SyntheticCodecBackend::SyntheticCodecBackend(Options options):mOptions(options) {
+}
+
+SyntheticCodecBackend::~SyntheticCodecBackend() {
+    stop();
+}
+
+std::string SyntheticCodecBackend::getName() const {
+    std::stringstream ss;
+    ss<<"Synthetic(latency:"<<duration_cast<microseconds>(mOptions.decodeLatency).count()<<"us,in:"<<mOptions.nInputBuffers<<",out:"<<mOptions.nOutputBuffers<<")";
+    return ss.str();
+}
+
+bool SyntheticCodecBackend::configure(const bool IS_H265,const KeyFrameFinder& keyFrameFinder,const AsyncCallbacks* asyncCallbacks) {
+    if(!keyFrameFinder.allKeyFramesAvailable(IS_H265)){
+        return false;
+    }
+    this->IS_H265=IS_H265;
+    mAsync=asyncCallbacks!=nullptr;
+    if(mAsync){
+        mAsyncCallbacks=*asyncCallbacks;
+    }
+    mInputBuffers.assign(mOptions.nInputBuffers,std::vector<uint8_t>(mOptions.inputBufferSize));
+    const size_t frameSize=(size_t)mOptions.width*mOptions.height*3/2;
+    mOutputBuffers.assign(mOptions.nOutputBuffers,std::vector<uint8_t>(frameSize,128));
+    MLOGD<<"Configured "<<getName()<<" "<<(IS_H265 ? "h265" : "h264");
+    return true;
+}
+
+bool SyntheticCodecBackend::start() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mRunning)return false;
+    mFreeInputs.clear();
+    mPendingInputs.clear();
+    mFreeOutputs.clear();
+    mDecodedOutputs.clear();
+    // In async mode the inputs are announced via the callback instead
+    if(!mAsync){
+        for(size_t i=0;i<mInputBuffers.size();i++)mFreeInputs.push_back(i);
+    }
+    for(size_t i=0;i<mOutputBuffers.size();i++)mFreeOutputs.push_back(i);
+    mFormatChangePending=true;
+    mRunning=true;
+    mDecodeThread=std::make_unique<std::thread>(&SyntheticCodecBackend::decodeLoop,this);
+    return true;
+}
+
+void SyntheticCodecBackend::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning=false;
+    }
+    mCondition.notify_all();
+    if(mDecodeThread && mDecodeThread->joinable()){
+        mDecodeThread->join();
+    }
+    mDecodeThread.reset();
+}
+
+ssize_t SyntheticCodecBackend::dequeueInputBuffer(const int64_t timeoutUs) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait_for(lock,microseconds(timeoutUs),[this]{return !mRunning || !mFreeInputs.empty();});
+    if(!mRunning)return ERROR_UNKNOWN;
+    if(mFreeInputs.empty())return INFO_TRY_AGAIN_LATER;
+    const auto index=mFreeInputs.front();
+    mFreeInputs.pop_front();
+    return (ssize_t)index;
+}
+
+uint8_t* SyntheticCodecBackend::getInputBuffer(const size_t index,size_t* outSize) {
+    if(index>=mInputBuffers.size())return nullptr;
+    *outSize=mInputBuffers[index].size();
+    return mInputBuffers[index].data();
+}
+
+void SyntheticCodecBackend::queueInputBuffer(const size_t index,const size_t size,const uint64_t presentationTimeUs,const uint32_t flags) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPendingInputs.push_back({index,std::min(size,mInputBuffers[index].size()),presentationTimeUs,flags,steady_clock::now()});
+    }
+    mCondition.notify_all();
+}
+
+ssize_t SyntheticCodecBackend::dequeueOutputBuffer(CodecBufferInfo& info,const int64_t timeoutUs) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait_for(lock,microseconds(timeoutUs),[this]{return !mRunning || !mDecodedOutputs.empty();});
+    if(!mRunning)return ERROR_UNKNOWN;
+    if(mDecodedOutputs.empty())return INFO_TRY_AGAIN_LATER;
+    // Like MediaCodec, report the format before the first frame
+    if(mFormatChangePending){
+        mFormatChangePending=false;
+        return INFO_OUTPUT_FORMAT_CHANGED;
+    }
+    const auto decoded=mDecodedOutputs.front();
+    mDecodedOutputs.pop_front();
+    info=decoded.info;
+    return (ssize_t)decoded.index;
+}
+
+uint8_t* SyntheticCodecBackend::getOutputBuffer(const size_t index,size_t* outSize) {
+    if(index>=mOutputBuffers.size())return nullptr;
+    *outSize=mOutputBuffers[index].size();
+    return mOutputBuffers[index].data();
+}
+
+CodecOutputFormat SyntheticCodecBackend::getOutputFormat() {
+    CodecOutputFormat ret;
+    ret.width=mOptions.width;
+    ret.height=mOptions.height;
+    ret.colorFormat=COLOR_FORMAT_NV12;
+    ret.applyDefaultLayout();
+    ret.description=getName();
+    return ret;
+}
+
+void SyntheticCodecBackend::releaseOutputBuffer(const size_t index,[[maybe_unused]] const int64_t renderTimestampNs) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFreeOutputs.push_back(index);
+    }
+    mCondition.notify_all();
+}
+
+size_t SyntheticCodecBackend::slicePayloadOffset(const uint8_t* data,const size_t size) const {
+    size_t header;
+    if(size>4 && data[0]==0 && data[1]==0 && data[2]==1){
+        header=3;
+    }else if(size>5 && data[0]==0 && data[1]==0 && data[2]==0 && data[3]==1){
+        header=4;
+    }else{
+        return 0;
+    }
+    if(IS_H265){
+        // Types 0..31 are VCL NALUs, 2 byte header
+        const uint8_t type=(data[header]>>1) & 0x3F;
+        return (type<32 && size>header+2) ? header+2 : 0;
+    }
+    // 1 == non-IDR slice ... 5 == IDR slice, 1 byte header
+    const uint8_t type=data[header] & 0x1F;
+    return (type>=1 && type<=5) ? header+1 : 0;
+}
+
+void SyntheticCodecBackend::decodeLoop() {
+    if(mAsync){
+        for(size_t i=0;i<mInputBuffers.size();i++){
+            mAsyncCallbacks.onInputAvailable((int32_t)i);
+        }
+    }
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(true){
+        mCondition.wait(lock,[this]{return !mRunning || !mPendingInputs.empty();});
+        if(!mRunning)break;
+        if(mOptions.stallAfterNFrames!=0 && mNDecodedFrames>=mOptions.stallAfterNFrames){
+            MLOGD<<"Simulating stall after "<<mNDecodedFrames<<" frames";
+            mCondition.wait(lock,[this]{return !mRunning;});
+            break;
+        }
+        const PendingInput input=mPendingInputs.front();
+        mPendingInputs.pop_front();
+        const auto& data=mInputBuffers[input.index];
+        const size_t payloadOffset=slicePayloadOffset(data.data(),input.size);
+        size_t outputIndex=0;
+        if(payloadOffset!=0){
+            // Back pressure - like a real codec we cannot continue until the consumer released a frame
+            mCondition.wait(lock,[this]{return !mRunning || !mFreeOutputs.empty();});
+            if(!mRunning)break;
+            outputIndex=mFreeOutputs.front();
+            mFreeOutputs.pop_front();
+            auto& frame=mOutputBuffers[outputIndex];
+            std::memset(frame.data(),128,N_TAG_BYTES);
+            std::memcpy(frame.data(),data.data()+payloadOffset,std::min(N_TAG_BYTES,input.size-payloadOffset));
+        }
+        // The bitstream has been consumed, the input buffer can be reused
+        if(!mAsync){
+            mFreeInputs.push_back(input.index);
+            mCondition.notify_all();
+        }
+        if(payloadOffset!=0){
+            // Decoding of this slice starts once it was queued and the previous one is done
+            const auto decodeStart=std::max(input.queueTime,steady_clock::now());
+            mCondition.wait_until(lock,decodeStart+mOptions.decodeLatency,[this]{return !mRunning;});
+            if(!mRunning)break;
+            mNDecodedFrames++;
+        }
+        const CodecBufferInfo info{0,(int32_t)mOutputBuffers[outputIndex].size(),(int64_t)input.presentationTimeUs,0};
+        if(!mAsync){
+            if(payloadOffset!=0){
+                mDecodedOutputs.push_back({outputIndex,info});
+                mCondition.notify_all();
+            }
+            continue;
+        }
+        // Never invoke the callbacks with the lock held, they call back into the backend
+        const bool formatChanged=payloadOffset!=0 && mFormatChangePending;
+        if(formatChanged)mFormatChangePending=false;
+        lock.unlock();
+        mAsyncCallbacks.onInputAvailable((int32_t)input.index);
+        if(formatChanged){
+            mAsyncCallbacks.onFormatChanged(getOutputFormat());
+        }
+        if(payloadOffset!=0){
+            mAsyncCallbacks.onOutputAvailable((int32_t)outputIndex,info);
+        }
+        lock.lock();
+    }
+}
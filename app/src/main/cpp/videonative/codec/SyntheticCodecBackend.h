@@ -0,0 +1,82 @@
+#ifndef FPVUE_SYNTHETICCODECBACKEND_H
+#define FPVUE_SYNTHETICCODECBACKEND_H
+
+#include "CodecBackend.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Stand-in for MediaCodec on machines without a (hardware) decoder, e.g. linux CI.
+// Does not decode anything - every coded slice that is queued comes out as a grey NV12 frame after decodeLatency,
+// with the same limited number of input / output buffers a real codec has. Non-VCL NALUs (parameter sets, SEI, AUD)
+// only consume an input buffer. The first bytes of the slice payload (after the NALU header) are copied to the start
+// of the output frame, which lets a benchmark identify the frames it sent.
+class SyntheticCodecBackend: public CodecBackend{
+public:
+    struct Options{
+        // Time from queueing a slice until the frame is available. Slices are decoded one after another
+        std::chrono::microseconds decodeLatency{std::chrono::milliseconds(5)};
+        size_t nInputBuffers=8;
+        size_t nOutputBuffers=6;
+        size_t inputBufferSize=1024*1024;
+        int32_t width=1920;
+        int32_t height=1080;
+        // Simulates a wedged codec: After this many frames no input is consumed and no output produced anymore. 0 == never
+        size_t stallAfterNFrames=0;
+    };
+    // Number of payload bytes copied into each output frame
+    static constexpr size_t N_TAG_BYTES=8;
+    // COLOR_FormatYUV420SemiPlanar
+    static constexpr int32_t COLOR_FORMAT_NV12=21;
+public:
+    explicit SyntheticCodecBackend(Options options);
+    ~SyntheticCodecBackend() override;
+    SyntheticCodecBackend(const SyntheticCodecBackend&)=delete;
+    std::string getName()const override;
+    bool configure(bool IS_H265,const KeyFrameFinder& keyFrameFinder,const AsyncCallbacks* asyncCallbacks) override;
+    bool start() override;
+    void stop() override;
+    ssize_t dequeueInputBuffer(int64_t timeoutUs) override;
+    uint8_t* getInputBuffer(size_t index,size_t* outSize) override;
+    void queueInputBuffer(size_t index,size_t size,uint64_t presentationTimeUs,uint32_t flags) override;
+    ssize_t dequeueOutputBuffer(CodecBufferInfo& info,int64_t timeoutUs) override;
+    uint8_t* getOutputBuffer(size_t index,size_t* outSize) override;
+    CodecOutputFormat getOutputFormat() override;
+    void releaseOutputBuffer(size_t index,int64_t renderTimestampNs) override;
+private:
+    struct PendingInput{
+        size_t index;
+        size_t size;
+        uint64_t presentationTimeUs;
+        uint32_t flags;
+        std::chrono::steady_clock::time_point queueTime;
+    };
+    struct DecodedOutput{
+        size_t index;
+        CodecBufferInfo info;
+    };
+    // Returns the offset of the payload after the NALU header, or 0 if the data is not a coded slice
+    size_t slicePayloadOffset(const uint8_t* data,size_t size)const;
+    void decodeLoop();
+    const Options mOptions;
+    bool IS_H265=false;
+    bool mAsync=false;
+    AsyncCallbacks mAsyncCallbacks;
+    std::vector<std::vector<uint8_t>> mInputBuffers;
+    std::vector<std::vector<uint8_t>> mOutputBuffers;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mRunning=false;
+    std::deque<size_t> mFreeInputs;
+    std::deque<PendingInput> mPendingInputs;
+    std::deque<size_t> mFreeOutputs;
+    std::deque<DecodedOutput> mDecodedOutputs;
+    bool mFormatChangePending=true;
+    size_t mNDecodedFrames=0;
+    std::unique_ptr<std::thread> mDecodeThread;
+};
+
+#endif //FPVUE_SYNTHETICCODECBACKEND_H
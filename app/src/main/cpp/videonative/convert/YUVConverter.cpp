@@ -0,0 +1,518 @@
+#include "YUVConverter.h"
+#include "../helper/AndroidLogger.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define FPVUE_YUV_NEON
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FPVUE_YUV_X86
+#endif
+
+// BT.601 limited range, coefficients scaled by 64:
+// R = 1.164(Y-16) + 1.596(V-128)
+// G = 1.164(Y-16) - 0.391(U-128) - 0.813(V-128)
+// B = 1.164(Y-16) + 2.018(U-128)
+namespace{
+    constexpr int16_t C_Y=74;
+    constexpr int16_t C_RV=102;
+    constexpr int16_t C_GU=25;
+    constexpr int16_t C_GV=52;
+    constexpr int16_t C_BU=129;
+    constexpr int16_t ROUND=32;
+    constexpr int SHIFT=6;
+
+    // Same as the saturating 16 bit SIMD add / subtract
+    inline int16_t sat16(const int32_t value){
+        return (int16_t)std::clamp<int32_t>(value,INT16_MIN,INT16_MAX);
+    }
+    inline uint8_t clampU8(const int16_t value){
+        return (uint8_t)std::clamp<int16_t>(value,0,255);
+    }
+    inline void convertPixel(const uint8_t y,const uint8_t u,const uint8_t v,uint8_t* rgba){
+        const int16_t y74=(int16_t)((y-16)*C_Y);
+        const int16_t u0=(int16_t)(u-128);
+        const int16_t v0=(int16_t)(v-128);
+        const int16_t r=sat16(sat16(y74+C_RV*v0)+ROUND)>>SHIFT;
+        const int16_t g=sat16(sat16(sat16(y74-C_GU*u0)-C_GV*v0)+ROUND)>>SHIFT;
+        const int16_t b=sat16(sat16(y74+C_BU*u0)+ROUND)>>SHIFT;
+        rgba[0]=clampU8(r);
+        rgba[1]=clampU8(g);
+        rgba[2]=clampU8(b);
+        rgba[3]=255;
+    }
+
+    void convertRowScalar(const uint8_t* y,const uint8_t* uv,uint8_t* rgba,const int32_t width,const bool oddStart,const bool vuOrder){
+        const int uIndex=vuOrder ? 1 : 0;
+        const int vIndex=vuOrder ? 0 : 1;
+        const int32_t offset=oddStart ? 1 : 0;
+        for(int32_t x=0;x<width;x++){
+            const uint8_t* pair=uv+((x+offset)/2)*2;
+            convertPixel(y[x],pair[uIndex],pair[vIndex],rgba+x*4);
+        }
+    }
+
+    // P010 -> 8 bit: The 10 significant bits are in the MSBs of each little endian 16 bit sample, rounded to the upper byte.
+    // Limited range 10 bit (64..940) maps onto limited range 8 bit (16..235)
+    inline uint8_t narrowSample(const uint8_t* sample){
+        const uint32_t value=sample[0] | (sample[1]<<8);
+        return (uint8_t)(std::min<uint32_t>(value+128,0xFFFF)>>8);
+    }
+    void narrowRowScalar(const uint8_t* src,uint8_t* dst,const size_t n){
+        for(size_t i=0;i<n;i++){
+            dst[i]=narrowSample(src+i*2);
+        }
+    }
+
+#ifdef FPVUE_YUV_X86
+    // 16 pixels per iteration
+    void convertRowSSE2(const uint8_t* y,const uint8_t* uv,uint8_t* rgba,const int32_t width,const bool oddStart,const bool vuOrder){
+        if(oddStart){
+            convertRowScalar(y,uv,rgba,width,oddStart,vuOrder);
+            return;
+        }
+        const __m128i zero=_mm_setzero_si128();
+        const __m128i lowBytes=_mm_set1_epi16(0x00FF);
+        const __m128i c16=_mm_set1_epi16(16);
+        const __m128i c128=_mm_set1_epi16(128);
+        const __m128i round=_mm_set1_epi16(ROUND);
+        const __m128i alpha=_mm_set1_epi8((char)0xFF);
+        int32_t x=0;
+        for(;x+16<=width;x+=16){
+            const __m128i yv=_mm_loadu_si128((const __m128i*)(y+x));
+            const __m128i uvv=_mm_loadu_si128((const __m128i*)(uv+x));
+            __m128i u=_mm_sub_epi16(_mm_and_si128(uvv,lowBytes),c128);
+            __m128i v=_mm_sub_epi16(_mm_srli_epi16(uvv,8),c128);
+            if(vuOrder)std::swap(u,v);
+            const __m128i rv=_mm_mullo_epi16(v,_mm_set1_epi16(C_RV));
+            const __m128i gu=_mm_mullo_epi16(u,_mm_set1_epi16(C_GU));
+            const __m128i gv=_mm_mullo_epi16(v,_mm_set1_epi16(C_GV));
+            const __m128i bu=_mm_mullo_epi16(u,_mm_set1_epi16(C_BU));
+            __m128i r8[2],g8[2],b8[2];
+            for(int half=0;half<2;half++){
+                // Every chroma value is used by 2 neighbouring pixels
+                const __m128i rvd=half==0 ? _mm_unpacklo_epi16(rv,rv) : _mm_unpackhi_epi16(rv,rv);
+                const __m128i gud=half==0 ? _mm_unpacklo_epi16(gu,gu) : _mm_unpackhi_epi16(gu,gu);
+                const __m128i gvd=half==0 ? _mm_unpacklo_epi16(gv,gv) : _mm_unpackhi_epi16(gv,gv);
+                const __m128i bud=half==0 ? _mm_unpacklo_epi16(bu,bu) : _mm_unpackhi_epi16(bu,bu);
+                const __m128i y16=half==0 ? _mm_unpacklo_epi8(yv,zero) : _mm_unpackhi_epi8(yv,zero);
+                const __m128i y74=_mm_mullo_epi16(_mm_sub_epi16(y16,c16),_mm_set1_epi16(C_Y));
+                r8[half]=_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(y74,rvd),round),SHIFT);
+                g8[half]=_mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(_mm_subs_epi16(y74,gud),gvd),round),SHIFT);
+                b8[half]=_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(y74,bud),round),SHIFT);
+            }
+            const __m128i r=_mm_packus_epi16(r8[0],r8[1]);
+            const __m128i g=_mm_packus_epi16(g8[0],g8[1]);
+            const __m128i b=_mm_packus_epi16(b8[0],b8[1]);
+            const __m128i rgLow=_mm_unpacklo_epi8(r,g);
+            const __m128i rgHigh=_mm_unpackhi_epi8(r,g);
+            const __m128i baLow=_mm_unpacklo_epi8(b,alpha);
+            const __m128i baHigh=_mm_unpackhi_epi8(b,alpha);
+            __m128i* out=(__m128i*)(rgba+x*4);
+            _mm_storeu_si128(out,_mm_unpacklo_epi16(rgLow,baLow));
+            _mm_storeu_si128(out+1,_mm_unpackhi_epi16(rgLow,baLow));
+            _mm_storeu_si128(out+2,_mm_unpacklo_epi16(rgHigh,baHigh));
+            _mm_storeu_si128(out+3,_mm_unpackhi_epi16(rgHigh,baHigh));
+        }
+        convertRowScalar(y+x,uv+x,rgba+x*4,width-x,false,vuOrder);
+    }
+
+    // 32 pixels per iteration. Widening each 16 byte half keeps every chroma pair in the 128 bit lane of its pixels
+    __attribute__((target("avx2")))
+    void convertRowAVX2(const uint8_t* y,const uint8_t* uv,uint8_t* rgba,const int32_t width,const bool oddStart,const bool vuOrder){
+        if(oddStart){
+            convertRowScalar(y,uv,rgba,width,oddStart,vuOrder);
+            return;
+        }
+        const __m256i lowHalf=_mm256_set1_epi32(0x0000FFFF);
+        const __m256i highHalf=_mm256_set1_epi32((int)0xFFFF0000);
+        const __m256i c16=_mm256_set1_epi16(16);
+        const __m256i c128=_mm256_set1_epi16(128);
+        const __m256i round=_mm256_set1_epi16(ROUND);
+        const __m256i alpha=_mm256_set1_epi8((char)0xFF);
+        int32_t x=0;
+        for(;x+32<=width;x+=32){
+            __m256i r16[2],g16[2],b16[2];
+            for(int half=0;half<2;half++){
+                const __m256i y16=_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y+x+half*16)));
+                // u0 v0 u1 v1 ... -> u0 u0 u1 u1 ... and v0 v0 v1 v1 ...
+                const __m256i uv16=_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(uv+x+half*16))),c128);
+                __m256i u=_mm256_or_si256(_mm256_and_si256(uv16,lowHalf),_mm256_slli_epi32(uv16,16));
+                __m256i v=_mm256_or_si256(_mm256_srli_epi32(uv16,16),_mm256_and_si256(uv16,highHalf));
+                if(vuOrder)std::swap(u,v);
+                const __m256i y74=_mm256_mullo_epi16(_mm256_sub_epi16(y16,c16),_mm256_set1_epi16(C_Y));
+                const __m256i rv=_mm256_mullo_epi16(v,_mm256_set1_epi16(C_RV));
+                const __m256i gu=_mm256_mullo_epi16(u,_mm256_set1_epi16(C_GU));
+                const __m256i gv=_mm256_mullo_epi16(v,_mm256_set1_epi16(C_GV));
+                const __m256i bu=_mm256_mullo_epi16(u,_mm256_set1_epi16(C_BU));
+                r16[half]=_mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y74,rv),round),SHIFT);
+                g16[half]=_mm256_srai_epi16(_mm256_adds_epi16(_mm256_subs_epi16(_mm256_subs_epi16(y74,gu),gv),round),SHIFT);
+                b16[half]=_mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y74,bu),round),SHIFT);
+            }
+            // packus works per lane, 0xD8 restores the pixel order 0-7,8-15,16-23,24-31
+            const __m256i r=_mm256_permute4x64_epi64(_mm256_packus_epi16(r16[0],r16[1]),0xD8);
+            const __m256i g=_mm256_permute4x64_epi64(_mm256_packus_epi16(g16[0],g16[1]),0xD8);
+            const __m256i b=_mm256_permute4x64_epi64(_mm256_packus_epi16(b16[0],b16[1]),0xD8);
+            // Lane 0 holds pixels 0-7 / 8-15, lane 1 pixels 16-23 / 24-31
+            const __m256i rgLow=_mm256_unpacklo_epi8(r,g);
+            const __m256i rgHigh=_mm256_unpackhi_epi8(r,g);
+            const __m256i baLow=_mm256_unpacklo_epi8(b,alpha);
+            const __m256i baHigh=_mm256_unpackhi_epi8(b,alpha);
+            const __m256i p0=_mm256_unpacklo_epi16(rgLow,baLow);   // 0-3   | 16-19
+            const __m256i p1=_mm256_unpackhi_epi16(rgLow,baLow);   // 4-7   | 20-23
+            const __m256i p2=_mm256_unpacklo_epi16(rgHigh,baHigh); // 8-11  | 24-27
+            const __m256i p3=_mm256_unpackhi_epi16(rgHigh,baHigh); // 12-15 | 28-31
+            __m256i* out=(__m256i*)(rgba+x*4);
+            _mm256_storeu_si256(out,_mm256_permute2x128_si256(p0,p1,0x20));
+            _mm256_storeu_si256(out+1,_mm256_permute2x128_si256(p2,p3,0x20));
+            _mm256_storeu_si256(out+2,_mm256_permute2x128_si256(p0,p1,0x31));
+            _mm256_storeu_si256(out+3,_mm256_permute2x128_si256(p2,p3,0x31));
+        }
+        convertRowScalar(y+x,uv+x,rgba+x*4,width-x,false,vuOrder);
+    }
+
+    // Saturating add then upper byte == narrowSample. 16 samples per iteration
+    void narrowRowSSE2(const uint8_t* src,uint8_t* dst,const size_t n){
+        const __m128i round=_mm_set1_epi16(128);
+        size_t i=0;
+        for(;i+16<=n;i+=16){
+            const __m128i low=_mm_srli_epi16(_mm_adds_epu16(_mm_loadu_si128((const __m128i*)(src+i*2)),round),8);
+            const __m128i high=_mm_srli_epi16(_mm_adds_epu16(_mm_loadu_si128((const __m128i*)(src+i*2+16)),round),8);
+            _mm_storeu_si128((__m128i*)(dst+i),_mm_packus_epi16(low,high));
+        }
+        narrowRowScalar(src+i*2,dst+i,n-i);
+    }
+
+    // 32 samples per iteration
+    __attribute__((target("avx2")))
+    void narrowRowAVX2(const uint8_t* src,uint8_t* dst,const size_t n){
+        const __m256i round=_mm256_set1_epi16(128);
+        size_t i=0;
+        for(;i+32<=n;i+=32){
+            const __m256i low=_mm256_srli_epi16(_mm256_adds_epu16(_mm256_loadu_si256((const __m256i*)(src+i*2)),round),8);
+            const __m256i high=_mm256_srli_epi16(_mm256_adds_epu16(_mm256_loadu_si256((const __m256i*)(src+i*2+32)),round),8);
+            // packus works per 128 bit lane
+            _mm256_storeu_si256((__m256i*)(dst+i),_mm256_permute4x64_epi64(_mm256_packus_epi16(low,high),0xD8));
+        }
+        narrowRowScalar(src+i*2,dst+i,n-i);
+    }
+#endif
+
+#ifdef FPVUE_YUV_NEON
+    // 16 pixels per iteration
+    void convertRowNEON(const uint8_t* y,const uint8_t* uv,uint8_t* rgba,const int32_t width,const bool oddStart,const bool vuOrder){
+        if(oddStart){
+            convertRowScalar(y,uv,rgba,width,oddStart,vuOrder);
+            return;
+        }
+        const uint8x8_t c16=vdup_n_u8(16);
+        const uint8x8_t c128=vdup_n_u8(128);
+        const int16x8_t round=vdupq_n_s16(ROUND);
+        int32_t x=0;
+        for(;x+16<=width;x+=16){
+            const uint8x16_t yv=vld1q_u8(y+x);
+            const uint8x8x2_t uvv=vld2_u8(uv+x);
+            // The wrap around of the unsigned subtraction is the correct signed value
+            int16x8_t u=vreinterpretq_s16_u16(vsubl_u8(uvv.val[0],c128));
+            int16x8_t v=vreinterpretq_s16_u16(vsubl_u8(uvv.val[1],c128));
+            if(vuOrder)std::swap(u,v);
+            const int16x8_t rv=vmulq_n_s16(v,C_RV);
+            const int16x8_t gu=vmulq_n_s16(u,C_GU);
+            const int16x8_t gv=vmulq_n_s16(v,C_GV);
+            const int16x8_t bu=vmulq_n_s16(u,C_BU);
+            uint8x8_t r8[2],g8[2],b8[2];
+            for(int half=0;half<2;half++){
+                // Every chroma value is used by 2 neighbouring pixels
+                const int16x8_t rvd=half==0 ? vzip1q_s16(rv,rv) : vzip2q_s16(rv,rv);
+                const int16x8_t gud=half==0 ? vzip1q_s16(gu,gu) : vzip2q_s16(gu,gu);
+                const int16x8_t gvd=half==0 ? vzip1q_s16(gv,gv) : vzip2q_s16(gv,gv);
+                const int16x8_t bud=half==0 ? vzip1q_s16(bu,bu) : vzip2q_s16(bu,bu);
+                const uint8x8_t y8=half==0 ? vget_low_u8(yv) : vget_high_u8(yv);
+                const int16x8_t y74=vmulq_n_s16(vreinterpretq_s16_u16(vsubl_u8(y8,c16)),C_Y);
+                r8[half]=vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqaddq_s16(y74,rvd),round),SHIFT));
+                g8[half]=vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqsubq_s16(vqsubq_s16(y74,gud),gvd),round),SHIFT));
+                b8[half]=vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqaddq_s16(y74,bud),round),SHIFT));
+            }
+            uint8x16x4_t out;
+            out.val[0]=vcombine_u8(r8[0],r8[1]);
+            out.val[1]=vcombine_u8(g8[0],g8[1]);
+            out.val[2]=vcombine_u8(b8[0],b8[1]);
+            out.val[3]=vdupq_n_u8(255);
+            vst4q_u8(rgba+x*4,out);
+        }
+        convertRowScalar(y+x,uv+x,rgba+x*4,width-x,false,vuOrder);
+    }
+
+    // Rounding saturating narrow == narrowSample. 16 samples per iteration
+    void narrowRowNEON(const uint8_t* src,uint8_t* dst,const size_t n){
+        size_t i=0;
+        for(;i+16<=n;i+=16){
+            const uint16x8_t low=vreinterpretq_u16_u8(vld1q_u8(src+i*2));
+            const uint16x8_t high=vreinterpretq_u16_u8(vld1q_u8(src+i*2+16));
+            vst1q_u8(dst+i,vcombine_u8(vqrshrn_n_u16(low,8),vqrshrn_n_u16(high,8)));
+        }
+        narrowRowScalar(src+i*2,dst+i,n-i);
+    }
+#endif
+
+    bool isValidLayout(const SemiPlanarImage& src,const size_t dstStride,const int32_t dstWidth){
+        if(src.data==nullptr || src.getWidth()<=0 || src.getHeight()<=0 || src.cropLeft<0 || src.cropTop<0 ||
+           (src.cropRight+1)*src.getBytesPerSample()>src.stride || src.cropBottom>=src.sliceHeight || dstWidth<=0 || dstStride<(size_t)dstWidth*4){
+            MLOGE<<"Invalid layout stride:"<<src.stride<<" slice height:"<<src.sliceHeight<<" crop:"<<src.cropLeft<<","<<src.cropTop<<","<<src.cropRight<<","<<src.cropBottom;
+            return false;
+        }
+        return true;
+    }
+
+    // Source sample position (first..last, clamped) as the left / upper neighbour and the Q8 weight of the next one.
+    // The neighbour is at most last-1, such that both samples are always inside the crop rectangle
+    template<typename TAP>
+    TAP computeTap(const double position,const int32_t first,const int32_t last){
+        const double clamped=std::clamp(position,(double)first,(double)last);
+        const int32_t index=std::min((int32_t)clamped,last-1);
+        return {index,(uint16_t)std::lround((clamped-index)*256)};
+    }
+    // Pixel centers are aligned: destination sample i covers [i,i+1) * scale of the source
+    double samplePosition(const int32_t first,const int32_t i,const double scale){
+        return first+(i+0.5)*scale-0.5;
+    }
+    // The chroma sample of destination pixels 2*i and 2*i+1, in source chroma samples
+    double chromaSamplePosition(const int32_t firstLuma,const int32_t i,const double scale){
+        return (firstLuma+(2*i+1)*scale)/2.0-0.5;
+    }
+    inline uint8_t lerpQ8(const uint8_t value0,const uint8_t value1,const uint16_t weight){
+        return (uint8_t)((value0*256+(value1-value0)*weight+128)>>8);
+    }
+    // Vertical bilinear step over a whole source row (vectorized by the compiler)
+    void blendRows(const uint8_t* row0,const uint8_t* row1,const uint16_t weight,uint8_t* out,const size_t n){
+        const uint16_t weight0=256-weight;
+        for(size_t i=0;i<n;i++){
+            out[i]=(uint8_t)((row0[i]*weight0+row1[i]*weight+128)>>8);
+        }
+    }
+    // Horizontal bilinear step, one tap per destination sample. STRIDE==2 for the interleaved chroma pairs
+    template<typename TAP,int STRIDE>
+    void resampleRow(const uint8_t* src,const TAP* taps,const size_t nTaps,uint8_t* out){
+        for(size_t x=0;x<nTaps;x++){
+            const TAP tap=taps[x];
+            const uint8_t* sample=src+tap.index*STRIDE;
+            for(int c=0;c<STRIDE;c++){
+                out[x*STRIDE+c]=lerpQ8(sample[c],sample[STRIDE+c],tap.weight);
+            }
+        }
+    }
+
+    YUVConverter::ROW_FUNCTION rowFunction(const YUVConverter::Path path){
+        switch(path){
+#ifdef FPVUE_YUV_X86
+            case YUVConverter::Path::SSE2:return convertRowSSE2;
+            case YUVConverter::Path::AVX2:return convertRowAVX2;
+#endif
+#ifdef FPVUE_YUV_NEON
+            case YUVConverter::Path::NEON:return convertRowNEON;
+#endif
+            default:return convertRowScalar;
+        }
+    }
+    YUVConverter::NARROW_FUNCTION narrowFunction(const YUVConverter::Path path){
+        switch(path){
+#ifdef FPVUE_YUV_X86
+            case YUVConverter::Path::SSE2:return narrowRowSSE2;
+            case YUVConverter::Path::AVX2:return narrowRowAVX2;
+#endif
+#ifdef FPVUE_YUV_NEON
+            case YUVConverter::Path::NEON:return narrowRowNEON;
+#endif
+            default:return narrowRowScalar;
+        }
+    }
+}
+
+SemiPlanarImage SemiPlanarImage::fromDecodedFrame(const DecodedFrame& frame) {
+    SemiPlanarImage ret;
+    ret.data=frame.data;
+    ret.stride=frame.stride;
+    ret.sliceHeight=frame.sliceHeight;
+    ret.cropLeft=frame.cropLeft;
+    ret.cropTop=frame.cropTop;
+    ret.cropRight=frame.cropRight;
+    ret.cropBottom=frame.cropBottom;
+    ret.p010=frame.colorFormat==CodecOutputFormat::COLOR_FORMAT_YUV_P010;
+    return ret;
+}
+
+SemiPlanarImage SemiPlanarImage::zoomed(const float zoom,const float centerX,const float centerY) const {
+    if(zoom<=1.0f){
+        return *this;
+    }
+    const int32_t width=std::max(2,(int32_t)(getWidth()/zoom));
+    const int32_t height=std::max(2,(int32_t)(getHeight()/zoom));
+    const int32_t offsetX=std::clamp((int32_t)(centerX*getWidth())-width/2,0,getWidth()-width) & ~1;
+    const int32_t offsetY=std::clamp((int32_t)(centerY*getHeight())-height/2,0,getHeight()-height) & ~1;
+    SemiPlanarImage ret=*this;
+    ret.cropLeft=cropLeft+offsetX;
+    ret.cropTop=cropTop+offsetY;
+    ret.cropRight=ret.cropLeft+width-1;
+    ret.cropBottom=ret.cropTop+height-1;
+    return ret;
+}
+
+YUVConverter::YUVConverter(const size_t nThreads,const Path path) {
+    if(path==Path::AUTO){
+#if defined(FPVUE_YUV_NEON)
+        mPath=Path::NEON;
+#elif defined(FPVUE_YUV_X86)
+        mPath=isSupported(Path::AVX2) ? Path::AVX2 : Path::SSE2;
+#else
+        mPath=Path::SCALAR;
+#endif
+    }else if(isSupported(path)){
+        mPath=path;
+    }else{
+        MLOGE<<pathName(path)<<" not supported, using scalar path";
+        mPath=Path::SCALAR;
+    }
+    mRowFunction=rowFunction(mPath);
+    mNarrowFunction=narrowFunction(mPath);
+    if(nThreads>1){
+        mParallelFor=std::make_unique<ParallelFor>(nThreads,"YUVConvert");
+    }
+    mRowBuffers.resize(getNThreads());
+}
+
+bool YUVConverter::isSupported(const Path path) {
+    switch(path){
+        case Path::AUTO:
+        case Path::SCALAR:
+            return true;
+#ifdef FPVUE_YUV_X86
+        case Path::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case Path::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef FPVUE_YUV_NEON
+        case Path::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* YUVConverter::pathName(const Path path) {
+    static constexpr const char* NAMES[]={"auto","scalar","sse2","avx2","neon"};
+    return NAMES[(int)path];
+}
+
+bool YUVConverter::convert(const SemiPlanarImage& src,uint8_t* dst,const size_t dstStride) {
+    const int32_t width=src.getWidth();
+    const int32_t height=src.getHeight();
+    if(!isValidLayout(src,dstStride,width)){
+        return false;
+    }
+    const uint8_t* uvPlane=src.data+(size_t)src.stride*src.sliceHeight;
+    const bool oddStart=(src.cropLeft & 1)!=0;
+    const int32_t bytesPerSample=src.getBytesPerSample();
+    const size_t nChromaSamples=(size_t)((src.cropRight/2-src.cropLeft/2)+1)*2;
+    const auto convertRows=[&](const size_t chunk,const size_t begin,const size_t end){
+        // 8 bit copies of the current P010 rows
+        auto& yNarrow=mRowBuffers[chunk].narrow[0];
+        auto& uvNarrow=mRowBuffers[chunk].narrow[1];
+        if(src.p010){
+            yNarrow.resize(width);
+            uvNarrow.resize(nChromaSamples);
+        }
+        for(size_t row=begin;row<end;row++){
+            const int32_t srcRow=src.cropTop+(int32_t)row;
+            const uint8_t* yRow=src.data+(size_t)srcRow*src.stride+(size_t)src.cropLeft*bytesPerSample;
+            const uint8_t* uvRow=uvPlane+(size_t)(srcRow/2)*src.stride+(size_t)(src.cropLeft & ~1)*bytesPerSample;
+            if(src.p010){
+                mNarrowFunction(yRow,yNarrow.data(),width);
+                yRow=yNarrow.data();
+                // Both rows of a pair share the chroma row
+                if(row==begin || (srcRow & 1)==0){
+                    mNarrowFunction(uvRow,uvNarrow.data(),nChromaSamples);
+                }
+                uvRow=uvNarrow.data();
+            }
+            mRowFunction(yRow,uvRow,dst+row*dstStride,width,oddStart,src.vuOrder);
+        }
+    };
+    if(mParallelFor){
+        mParallelFor->run((size_t)height,convertRows);
+    }else{
+        convertRows(0,0,(size_t)height);
+    }
+    return true;
+}
+
+bool YUVConverter::convertScaled(const SemiPlanarImage& src,uint8_t* dst,const size_t dstStride,const int32_t dstWidth,const int32_t dstHeight) {
+    if(dstWidth==src.getWidth() && dstHeight==src.getHeight()){
+        return convert(src,dst,dstStride);
+    }
+    // Relative to the first source column (luma) / pair (chroma) of the crop rectangle
+    const int32_t firstPair=src.cropLeft/2;
+    const int32_t nLuma=src.getWidth();
+    const int32_t nPairs=src.cropRight/2-firstPair+1;
+    if(!isValidLayout(src,dstStride,dstWidth) || dstHeight<=0 || nPairs<2 || src.getHeight()<2){
+        return false;
+    }
+    const double scaleX=(double)nLuma/dstWidth;
+    const double scaleY=(double)src.getHeight()/dstHeight;
+    const int32_t nDstPairs=(dstWidth+1)/2;
+    mLumaTaps.resize(dstWidth);
+    for(int32_t x=0;x<dstWidth;x++){
+        mLumaTaps[x]=computeTap<Tap>(samplePosition(0,x,scaleX),0,nLuma-1);
+    }
+    mChromaTaps.resize(nDstPairs);
+    for(int32_t x=0;x<nDstPairs;x++){
+        mChromaTaps[x]=computeTap<Tap>(chromaSamplePosition(src.cropLeft,x,scaleX)-firstPair,0,nPairs-1);
+    }
+    const uint8_t* uvPlane=src.data+(size_t)src.stride*src.sliceHeight;
+    const int32_t bytesPerSample=src.getBytesPerSample();
+    const auto convertRows=[&](const size_t chunk,const size_t begin,const size_t end){
+        RowBuffers& buffers=mRowBuffers[chunk];
+        auto& lumaRow=buffers.luma;
+        auto& chromaRow=buffers.chroma;
+        auto& y=buffers.y;
+        auto& uv=buffers.uv;
+        auto& narrow=buffers.narrow;
+        lumaRow.resize(nLuma);
+        chromaRow.resize(nPairs*2);
+        y.resize(dstWidth);
+        uv.resize(nDstPairs*2);
+        const auto sourceRows=[&](const uint8_t* row0,const size_t n)->std::pair<const uint8_t*,const uint8_t*>{
+            if(!src.p010){
+                return {row0,row0+src.stride};
+            }
+            for(int i=0;i<2;i++){
+                narrow[i].resize(n);
+                mNarrowFunction(row0+(size_t)i*src.stride,narrow[i].data(),n);
+            }
+            return {narrow[0].data(),narrow[1].data()};
+        };
+        for(size_t row=begin;row<end;row++){
+            const auto lumaTap=computeTap<Tap>(samplePosition(src.cropTop,(int32_t)row,scaleY),src.cropTop,src.cropBottom);
+            const auto lumaSrc=sourceRows(src.data+(size_t)lumaTap.index*src.stride+(size_t)src.cropLeft*bytesPerSample,nLuma);
+            blendRows(lumaSrc.first,lumaSrc.second,lumaTap.weight,lumaRow.data(),nLuma);
+            resampleRow<Tap,1>(lumaRow.data(),mLumaTaps.data(),mLumaTaps.size(),y.data());
+            // Both rows of a pair share the chroma row
+            if(row==begin || (row & 1)==0){
+                const auto chromaTap=computeTap<Tap>(chromaSamplePosition(src.cropTop,(int32_t)row/2,scaleY),src.cropTop/2,src.cropBottom/2);
+                const auto chromaSrc=sourceRows(uvPlane+(size_t)chromaTap.index*src.stride+(size_t)firstPair*2*bytesPerSample,chromaRow.size());
+                blendRows(chromaSrc.first,chromaSrc.second,chromaTap.weight,chromaRow.data(),chromaRow.size());
+                resampleRow<Tap,2>(chromaRow.data(),mChromaTaps.data(),mChromaTaps.size(),uv.data());
+            }
+            mRowFunction(y.data(),uv.data(),dst+row*dstStride,dstWidth,false,src.vuOrder);
+        }
+    };
+    if(mParallelFor){
+        mParallelFor->run((size_t)dstHeight,convertRows);
+    }else{
+        convertRows(0,0,(size_t)dstHeight);
+    }
+    return true;
+}
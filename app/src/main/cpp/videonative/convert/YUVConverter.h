@@ -0,0 +1,100 @@
+#ifndef FPVUE_YUVCONVERTER_H
+#define FPVUE_YUVCONVERTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "../codec/DecodedFrame.h"
+#include "../helper/ParallelFor.hpp"
+
+// A 4:2:0 semi planar image (NV12 / NV21 or the 10 bit P010) in the layout the decoder reported.
+struct SemiPlanarImage{
+    const uint8_t* data=nullptr;
+    // Bytes (not samples) per row of the Y and the UV plane
+    int32_t stride=0;
+    // Rows of the Y plane including padding, the UV plane starts at data+stride*sliceHeight
+    int32_t sliceHeight=0;
+    // Visible rectangle, inclusive
+    int32_t cropLeft=0;
+    int32_t cropTop=0;
+    int32_t cropRight=-1;
+    int32_t cropBottom=-1;
+    // NV21 (V before U) instead of NV12
+    bool vuOrder=false;
+    // P010: 16 bit little endian samples with the 10 significant bits in the MSBs, otherwise 8 bit samples
+    bool p010=false;
+    int32_t getBytesPerSample()const{
+        return p010 ? 2 : 1;
+    }
+    int32_t getWidth()const{
+        return cropRight-cropLeft+1;
+    }
+    int32_t getHeight()const{
+        return cropBottom-cropTop+1;
+    }
+    // MediaCodec outputs NV12 for all the (flexible) semi planar 8 bit color formats, P010 for 10 bit content
+    static SemiPlanarImage fromDecodedFrame(const DecodedFrame& frame);
+    // Digital zoom: the crop rectangle shrunk by zoom (>=1) around center (normalized, 0.5==middle of the current crop).
+    // The center is clamped such that the result stays inside the current crop, offsets are rounded to even.
+    SemiPlanarImage zoomed(float zoom,float centerX=0.5f,float centerY=0.5f)const;
+};
+
+// Converts semi planar YUV to RGBA (byte order R,G,B,A as tex_format_rgba32 expects it), honouring the stride,
+// slice height and crop rectangle of the source. BT.601 limited range with 6 bit fixed point coefficients.
+// All paths produce bit-identical output: the SIMD paths use 16 bit saturating arithmetic and the scalar path
+// emulates exactly that.
+// P010 rows are first narrowed to 8 bit (rounded, limited range maps onto limited range) into a row buffer that stays
+// in cache, then converted by the same row kernel. No HDR (PQ / HLG) tone curve is applied.
+// Rows are split across nThreads cores (including the calling one).
+class YUVConverter{
+public:
+    enum class Path{AUTO,SCALAR,SSE2,AVX2,NEON};
+    explicit YUVConverter(size_t nThreads=1,Path path=Path::AUTO);
+    // False if the image layout is inconsistent. dst has to hold getHeight() rows of dstStride bytes
+    bool convert(const SemiPlanarImage& src,uint8_t* dst,size_t dstStride);
+    // Converts the crop rectangle of src resampled (bilinear) to dstWidth x dstHeight in the same pass, such that
+    // only the (smaller) destination is written. Only the source rows that are sampled are read.
+    // Falls back to convert() if the size matches.
+    bool convertScaled(const SemiPlanarImage& src,uint8_t* dst,size_t dstStride,int32_t dstWidth,int32_t dstHeight);
+    Path getPath()const{
+        return mPath;
+    }
+    size_t getNThreads()const{
+        return mParallelFor ? mParallelFor->getNThreads() : 1;
+    }
+    static bool isSupported(Path path);
+    static const char* pathName(Path path);
+    // Converts one row. uv points to the chroma pair of the first pixel, unless oddStart (then to the pair before it)
+    typedef void (*ROW_FUNCTION)(const uint8_t* y,const uint8_t* uv,uint8_t* rgba,int32_t width,bool oddStart,bool vuOrder);
+    // Converts n P010 samples to 8 bit
+    typedef void (*NARROW_FUNCTION)(const uint8_t* src,uint8_t* dst,size_t n);
+private:
+    Path mPath;
+    ROW_FUNCTION mRowFunction;
+    NARROW_FUNCTION mNarrowFunction;
+    std::unique_ptr<ParallelFor> mParallelFor;
+    // Horizontal resampling taps of convertScaled, for luma pixels and chroma pairs
+    struct Tap{
+        int32_t index;
+        // Q8 weight (0..256) of index+1
+        uint16_t weight;
+    };
+    std::vector<Tap> mLumaTaps;
+    std::vector<Tap> mChromaTaps;
+    // Scratch rows of one thread, sized on the first frame and reused afterwards
+    struct RowBuffers{
+        // Vertically blended source rows of convertScaled
+        std::vector<uint8_t> luma;
+        std::vector<uint8_t> chroma;
+        // Destination rows handed to the row kernel by convertScaled
+        std::vector<uint8_t> y;
+        std::vector<uint8_t> uv;
+        // 8 bit copies of P010 rows
+        std::vector<uint8_t> narrow[2];
+    };
+    // One per thread (ParallelFor chunk)
+    std::vector<RowBuffers> mRowBuffers;
+};
+
+#endif //FPVUE_YUVCONVERTER_H
@@ -5,7 +5,27 @@
 #ifndef FPV_VR_PRIVATE_MDEBUG_H
 #define FPV_VR_PRIVATE_MDEBUG_H
 
+#ifdef __ANDROID__
 #include "android/log.h"
+#else
+// Host (linux) builds, e.g. the pipeline benchmark - log to stderr instead of logcat
+#include <cstdarg>
+#include <cstdio>
+typedef enum android_LogPriority{
+    ANDROID_LOG_UNKNOWN=0,ANDROID_LOG_DEFAULT,ANDROID_LOG_VERBOSE,ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,ANDROID_LOG_WARN,ANDROID_LOG_ERROR,ANDROID_LOG_FATAL,ANDROID_LOG_SILENT
+}android_LogPriority;
+__attribute__((__format__(printf,3,4)))
+inline int __android_log_print(int prio,const char* tag,const char* fmt,...){
+    va_list argptr;
+    va_start(argptr,fmt);
+    fprintf(stderr,"%c/%s: ",prio>=ANDROID_LOG_ERROR ? 'E' : 'D',tag);
+    const int ret=vfprintf(stderr,fmt,argptr);
+    fputc('\n',stderr);
+    va_end(argptr);
+    return ret;
+}
+#endif
 #include <string.h>
 #include <sstream>
 #include <cassert>
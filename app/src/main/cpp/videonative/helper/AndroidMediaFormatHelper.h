@@ -26,7 +26,7 @@ void writeAndroidPerformanceParams(AMediaFormat* format){
     //AMediaFormat_setInt32(format,AMEDIAFORMAT_KEY_OPERATING_RATE,0);
 }
 
-static void h264_configureAMediaFormat(KeyFrameFinder& kff,AMediaFormat* format){
+static void h264_configureAMediaFormat(const KeyFrameFinder& kff,AMediaFormat* format){
     const auto sps=kff.getCSD0();
     const auto pps=kff.getCSD1();
     const auto videoWH= sps.getVideoWidthHeightSPS();
@@ -42,7 +42,7 @@ static void h264_configureAMediaFormat(KeyFrameFinder& kff,AMediaFormat* format)
     //AMediaFormat_setInt32(decoder.format,AMEDIAFORMAT_KEY_PRIORITY,0);
     //writeAndroidPerformanceParams(format);
 }
-static void h265_configureAMediaFormat(KeyFrameFinder& kff,AMediaFormat* format){
+static void h265_configureAMediaFormat(const KeyFrameFinder& kff,AMediaFormat* format){
     std::vector<uint8_t> buff={};
     const auto sps=kff.getCSD0();
     const auto pps=kff.getCSD1();
@@ -0,0 +1,296 @@
+#ifndef FPVUE_BATCHEDFILEWRITER_HPP
+#define FPVUE_BATCHEDFILEWRITER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "SPSCQueue.hpp"
+
+// Writes a file for a producer that must never block (the parser thread of GroundRecorder, the USB thread of
+// PcapngRecorder): the data is copied into N_BATCHES pooled batches of BATCH_SIZE bytes which a dedicated I/O thread
+// writes. If the I/O thread falls behind and no batch is free the producer finds out through hasSpaceFor() / reserve()
+// and drops what it wanted to write. Errors are only counted (getStats()), the writer does not log.
+// start() and stop() do not block either (they run on the render thread): the I/O thread opens, finalizes and closes
+// the file, in order with the batches. It is created by the first start() and lives until the destructor. What is
+// produced while the I/O thread still creates the file waits in the batches like anything else.
+// Everything but getStats() is the producer side and may only be called from one thread at a time, start() and stop()
+// included (the recorders serialize them with their own mutex).
+template<size_t BATCH_SIZE,size_t N_BATCHES>
+class BatchedFileWriter{
+public:
+    struct Stats{
+        uint64_t nBytesWritten=0;
+        // Batches lost because write() failed, and failed finalizations
+        uint64_t nWriteErrors=0;
+        // Throughput of the write() calls themselves
+        double writeMBytesPerSecond=0;
+        // errno if the file could not be created, nothing is written then
+        int openErrno=0;
+    };
+    // A partially filled batch is handed to the I/O thread by flushIfDue() once it is older than maxBatchAge.
+    // With preallocateStep>0 the file is preallocated in steps of that size, closing gives back what was not used
+    BatchedFileWriter(const char* threadName,const std::chrono::milliseconds maxBatchAge,const size_t preallocateStep=0):
+        mThreadName(threadName),mMaxBatchAge(maxBatchAge),mPreallocateStep(preallocateStep){}
+    // Waits until everything queued is written and the file is closed
+    ~BatchedFileWriter(){
+        stop();
+        if(!mIOThread)return;
+        {
+            std::lock_guard<std::mutex> lock(mIOMutex);
+            mExitIO=true;
+            mIOCondition.notify_one();
+        }
+        mIOThread->join();
+    }
+    BatchedFileWriter(const BatchedFileWriter&)=delete;
+    // Queues creating fileName, whatever is produced afterwards goes into it. If it cannot be created getStats() tells.
+    // False (errno EBUSY) only if the I/O thread is still busy with earlier files: too many of them are queued, or
+    // less than headerSize bytes (e.g. for a file header written right after) are free
+    bool start(const std::string& fileName,const size_t headerSize=0){
+        // Up to N_BATCHES batches, the rest of mFullBatches is for the commands: OPEN and CLOSE of this file, and
+        // the CLOSE of the previous one
+        if(mFullBatches.size()+3>N_BATCHES){
+            errno=EBUSY;
+            return false;
+        }
+        stop();
+        if(!mBatchesAllocated){
+            // Once, producing never allocates afterwards
+            for(size_t i=0;i<N_BATCHES;i++){
+                auto batch=std::make_unique<Batch>();
+                batch->data.resize(BATCH_SIZE);
+                mFreeBatches.push(std::move(batch));
+            }
+            mBatchesAllocated=true;
+        }
+        if(!hasSpaceFor(headerSize)){
+            errno=EBUSY;
+            return false;
+        }
+        if(!mIOThread){
+            mIOThread=std::make_unique<std::thread>(&BatchedFileWriter::ioLoop,this);
+            pthread_setname_np(mIOThread->native_handle(),mThreadName);
+        }
+        // Not the error of an earlier file
+        mOpenErrno=0;
+        auto open=std::make_unique<Batch>();
+        open->command=Command::OPEN;
+        open->fileName=fileName;
+        push(std::move(open));
+        mStarted=true;
+        return true;
+    }
+    // Queues closing the file after everything produced so far is written
+    void stop(){
+        if(!mStarted)return;
+        mStarted=false;
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mIOMutex);
+            mNCloses++;
+        }
+        auto close=std::make_unique<Batch>();
+        close->command=Command::CLOSE;
+        push(std::move(close));
+    }
+    // Blocks until the files of all stop() calls so far are closed, e.g. before reading them. Not for the render thread
+    void waitUntilClosed(){
+        std::unique_lock<std::mutex> lock(mIOMutex);
+        mClosedCondition.wait(lock,[this]{return mNClosed==mNCloses;});
+    }
+    // True if size bytes can be appended right now
+    bool hasSpaceFor(const size_t size)const{
+        const size_t remaining=mCurrentBatch ? BATCH_SIZE-mCurrentBatch->size : 0;
+        if(size<=remaining)return true;
+        const size_t nBatchesNeeded=(size-remaining+BATCH_SIZE-1)/BATCH_SIZE;
+        // The I/O thread only ever adds free batches
+        return mFreeBatches.size()>=nBatchesNeeded;
+    }
+    // Continues over as many batches as needed, checked by hasSpaceFor()
+    void append(const uint8_t* data,size_t size){
+        while(size>0){
+            if(!mCurrentBatch){
+                nextBatch();
+            }
+            const size_t n=std::min(size,BATCH_SIZE-mCurrentBatch->size);
+            memcpy(mCurrentBatch->data.data()+mCurrentBatch->size,data,n);
+            mCurrentBatch->size+=n;
+            data+=n;
+            size-=n;
+            if(mCurrentBatch->size==BATCH_SIZE){
+                flush();
+            }
+        }
+    }
+    // size contiguous bytes in one batch, for data that must not be split (e.g. a pcapng block).
+    // Nullptr if size>BATCH_SIZE or no batch is free
+    uint8_t* reserve(const size_t size){
+        if(size>BATCH_SIZE)return nullptr;
+        if(mCurrentBatch && BATCH_SIZE-mCurrentBatch->size<size){
+            flush();
+        }
+        if(!mCurrentBatch && !nextBatch())return nullptr;
+        uint8_t* ret=mCurrentBatch->data.data()+mCurrentBatch->size;
+        mCurrentBatch->size+=size;
+        return ret;
+    }
+    // Hands the current batch to the I/O thread if it is older than maxBatchAge
+    void flushIfDue(){
+        if(mCurrentBatch && mCurrentBatch->size>0 && std::chrono::steady_clock::now()-mCurrentBatch->firstWrite>mMaxBatchAge){
+            flush();
+        }
+    }
+    // Of the file opened last
+    Stats getStats()const{
+        Stats ret;
+        ret.nBytesWritten=nBytesWritten;
+        ret.nWriteErrors=nWriteErrors;
+        const auto writeTimeNs=mWriteTimeNs.load();
+        ret.writeMBytesPerSecond=writeTimeNs==0 ? 0 : (double)ret.nBytesWritten/(1024.0*1024.0)/((double)writeTimeNs/1e9);
+        ret.openErrno=mOpenErrno;
+        return ret;
+    }
+private:
+    enum class Command{WRITE,OPEN,CLOSE};
+    struct Batch{
+        Command command=Command::WRITE;
+        std::vector<uint8_t> data;
+        size_t size=0;
+        std::chrono::steady_clock::time_point firstWrite;
+        // OPEN
+        std::string fileName;
+    };
+    bool nextBatch(){
+        if(!mFreeBatches.pop(mCurrentBatch))return false;
+        mCurrentBatch->size=0;
+        mCurrentBatch->firstWrite=std::chrono::steady_clock::now();
+        return true;
+    }
+    void flush(){
+        // An empty batch is kept, the free queue only has the I/O thread as producer
+        if(!mCurrentBatch || mCurrentBatch->size==0)return;
+        push(std::move(mCurrentBatch));
+    }
+    void push(std::unique_ptr<Batch> batch){
+        // Cannot fail, the queue has room for all N_BATCHES batches and the commands checked by start()
+        mFullBatches.push(std::move(batch));
+        // Under the mutex, else the I/O thread could miss it between checking mFullBatches and waiting
+        std::lock_guard<std::mutex> lock(mIOMutex);
+        mIOCondition.notify_one();
+    }
+    void ioLoop(){
+        while(true){
+            std::unique_ptr<Batch> batch;
+            if(!mFullBatches.pop(batch)){
+                std::unique_lock<std::mutex> lock(mIOMutex);
+                if(mExitIO && mFullBatches.empty())return;
+                mIOCondition.wait(lock,[this]{return mExitIO || !mFullBatches.empty();});
+                continue;
+            }
+            switch(batch->command){
+                case Command::OPEN:
+                    openFile(batch->fileName);
+                    break;
+                case Command::CLOSE:
+                    closeFile();
+                    break;
+                case Command::WRITE:
+                    if(!writeBatch(*batch)){
+                        nWriteErrors++;
+                    }
+                    mFreeBatches.push(std::move(batch));
+                    break;
+            }
+        }
+    }
+    void openFile(const std::string& fileName){
+        mFileSize=0;
+        mPreallocatedUntil=0;
+        nBytesWritten=0;
+        nWriteErrors=0;
+        mWriteTimeNs=0;
+        mFd=open(fileName.c_str(),O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0644);
+        mOpenErrno=mFd<0 ? errno : 0;
+    }
+    void closeFile(){
+        if(mFd>=0){
+            // Give back what was preallocated but not used
+            if((mPreallocateStep>0 && ftruncate(mFd,(off_t)mFileSize)!=0) || fdatasync(mFd)!=0){
+                nWriteErrors++;
+            }
+            close(mFd);
+            mFd=-1;
+        }
+        std::lock_guard<std::mutex> lock(mIOMutex);
+        mNClosed++;
+        mClosedCondition.notify_all();
+    }
+    bool writeBatch(const Batch& batch){
+        if(mFd<0)return false;
+        const auto before=std::chrono::steady_clock::now();
+        if(mPreallocateStep>0 && mFileSize+batch.size>mPreallocatedUntil){
+            // Keeps the file size, such that the file is valid up to the last batch if the app dies. Only an
+            // optimization, writing still works if it fails
+            fallocate(mFd,FALLOC_FL_KEEP_SIZE,(off_t)mPreallocatedUntil,(off_t)mPreallocateStep);
+            mPreallocatedUntil+=mPreallocateStep;
+        }
+        size_t offset=0;
+        while(offset<batch.size){
+            const ssize_t n=write(mFd,batch.data.data()+offset,batch.size-offset);
+            if(n<0){
+                if(errno==EINTR)continue;
+                // Only whole batches, the file stays consistent with what was written before
+                if(offset>0){
+                    lseek(mFd,(off_t)mFileSize,SEEK_SET);
+                }
+                return false;
+            }
+            offset+=(size_t)n;
+        }
+        mFileSize+=batch.size;
+        nBytesWritten+=batch.size;
+        mWriteTimeNs+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-before).count();
+        return true;
+    }
+    const char* const mThreadName;
+    const std::chrono::milliseconds mMaxBatchAge;
+    const size_t mPreallocateStep;
+    // Producer
+    bool mStarted=false;
+    std::unique_ptr<Batch> mCurrentBatch;
+    // Batches cycle producer -> mFullBatches -> I/O thread -> mFreeBatches -> producer. mFullBatches also has the
+    // OPEN / CLOSE commands, in order with the batches
+    SPSCQueue<std::unique_ptr<Batch>,N_BATCHES> mFreeBatches;
+    SPSCQueue<std::unique_ptr<Batch>,2*N_BATCHES> mFullBatches;
+    bool mBatchesAllocated=false;
+    // I/O thread
+    int mFd=-1;
+    std::unique_ptr<std::thread> mIOThread;
+    std::mutex mIOMutex;
+    std::condition_variable mIOCondition;
+    bool mExitIO=false;
+    // Guarded by mIOMutex
+    uint64_t mNCloses=0;
+    uint64_t mNClosed=0;
+    std::condition_variable mClosedCondition;
+    uint64_t mFileSize=0;
+    uint64_t mPreallocatedUntil=0;
+    std::atomic<uint64_t> nBytesWritten{0};
+    std::atomic<uint64_t> nWriteErrors{0};
+    std::atomic<uint64_t> mWriteTimeNs{0};
+    std::atomic<int> mOpenErrno{0};
+};
+
+#endif //FPVUE_BATCHEDFILEWRITER_HPP
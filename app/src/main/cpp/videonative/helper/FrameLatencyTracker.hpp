@@ -0,0 +1,182 @@
+#ifndef FPVUE_FRAMELATENCYTRACKER_HPP
+#define FPVUE_FRAMELATENCYTRACKER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "AndroidLogger.hpp"
+
+// Per-frame latency breakdown, keyed by the presentation time stamp a frame was queued into the codec with.
+// Every stage a frame passes, from receiving its first rtp packet until the texture upload, is time stamped and the
+// last CAPACITY frames are kept in a fixed ring. Unlike the decoder histograms nothing is blended or reset, which gives
+// us the tail latency of each stage.
+// begin() may only be called from one thread (the one feeding the codec), mark() from any thread.
+class FrameLatencyTracker{
+public:
+    using Clock=std::chrono::steady_clock;
+    enum Stage{FIRST_PACKET,LAST_PACKET,PARSED,QUEUED,DECODED,CONVERTED,UPLOADED,N_STAGES};
+    static constexpr const char* STAGE_NAMES[N_STAGES]={"first_packet","last_packet","parsed","queued","decoded","converted","uploaded"};
+    static constexpr size_t CAPACITY=1024;
+    struct StageStatistics{
+        std::string name;
+        size_t count=0;
+        float p50_ms=0;
+        float p90_ms=0;
+        float p99_ms=0;
+        float max_ms=0;
+    };
+public:
+    // Start a new record. The ring slot of the oldest frame is re-used
+    void begin(const uint64_t pts,const Clock::time_point firstPacket,const Clock::time_point lastPacket,const Clock::time_point parsed,const Clock::time_point queued){
+        const auto next=mNext.load(std::memory_order_relaxed);
+        Record& record=mRecords[next % CAPACITY];
+        record.pts.store(INVALID_PTS,std::memory_order_relaxed);
+        for(auto& stage:record.stageNs){
+            stage.store(0,std::memory_order_relaxed);
+        }
+        record.stageNs[FIRST_PACKET].store(toNs(firstPacket),std::memory_order_relaxed);
+        record.stageNs[LAST_PACKET].store(toNs(lastPacket),std::memory_order_relaxed);
+        record.stageNs[PARSED].store(toNs(parsed),std::memory_order_relaxed);
+        record.stageNs[QUEUED].store(toNs(queued),std::memory_order_relaxed);
+        record.pts.store(pts,std::memory_order_release);
+        mNext.store(next+1,std::memory_order_release);
+    }
+    // Time stamp the given stage of the frame with this pts. Only the first call per stage counts
+    // (e.g. the same frame being uploaded twice). Returns false if the frame is not in the ring (anymore).
+    bool mark(const uint64_t pts,const Stage stage,const Clock::time_point timePoint=Clock::now()){
+        Record* record=find(pts);
+        if(record==nullptr)return false;
+        int64_t expected=0;
+        record->stageNs[stage].compare_exchange_strong(expected,toNs(timePoint),std::memory_order_relaxed);
+        return true;
+    }
+    // Latency of each stage relative to the previous stage the frame reached, as well as the whole pipeline
+    // (first packet until decoded / uploaded). Only frames that reached a stage count for it.
+    std::vector<StageStatistics> getStatistics()const{
+        std::vector<std::vector<float>> stageDeltas(N_STAGES);
+        std::vector<float> untilDecoded,untilUploaded;
+        for(const auto& record:snapshot()){
+            for(int stage=LAST_PACKET;stage<N_STAGES;stage++){
+                if(record.stageNs[stage]==0)continue;
+                for(int previous=stage-1;previous>=FIRST_PACKET;previous--){
+                    if(record.stageNs[previous]!=0){
+                        stageDeltas[stage].push_back(nsToMs(record.stageNs[stage]-record.stageNs[previous]));
+                        break;
+                    }
+                }
+            }
+            if(record.stageNs[DECODED]!=0){
+                untilDecoded.push_back(nsToMs(record.stageNs[DECODED]-record.stageNs[FIRST_PACKET]));
+            }
+            if(record.stageNs[UPLOADED]!=0){
+                untilUploaded.push_back(nsToMs(record.stageNs[UPLOADED]-record.stageNs[FIRST_PACKET]));
+            }
+        }
+        std::vector<StageStatistics> ret;
+        for(int stage=LAST_PACKET;stage<N_STAGES;stage++){
+            ret.push_back(calculateStatistics(STAGE_NAMES[stage],stageDeltas[stage]));
+        }
+        ret.push_back(calculateStatistics("total_decoded",untilDecoded));
+        ret.push_back(calculateStatistics("total_uploaded",untilUploaded));
+        return ret;
+    }
+    std::string getStatisticsString()const{
+        std::stringstream ss;
+        ss<<"Stage latency ms (n p50 p90 p99 max)";
+        for(const auto& statistics:getStatistics()){
+            if(statistics.count==0)continue;
+            ss<<"\n"<<statistics.name<<": "<<statistics.count<<" "<<statistics.p50_ms<<" "<<statistics.p90_ms<<" "<<statistics.p99_ms<<" "<<statistics.max_ms;
+        }
+        return ss.str();
+    }
+    // One line per frame (oldest first), time stamps in us relative to the first packet. Stages not reached are left empty
+    bool exportCSV(const std::string& path)const{
+        std::ofstream file(path,std::ios::trunc);
+        if(!file.is_open()){
+            MLOGE<<"Cannot open "<<path;
+            return false;
+        }
+        file<<"pts_us";
+        for(const auto name:STAGE_NAMES)file<<","<<name<<"_us";
+        file<<"\n";
+        for(const auto& record:snapshot()){
+            file<<record.pts;
+            for(const auto stageNs:record.stageNs){
+                file<<",";
+                if(stageNs!=0)file<<(stageNs-record.stageNs[FIRST_PACKET])/1000;
+            }
+            file<<"\n";
+        }
+        file.close();
+        MLOGD<<"Exported frame latencies to "<<path;
+        return !file.fail();
+    }
+private:
+    static constexpr uint64_t INVALID_PTS=UINT64_MAX;
+    // Output and upload happen in order and only a few frames after queueing. Limits the cost of a lookup
+    static constexpr size_t SEARCH_DEPTH=64;
+    struct Record{
+        std::atomic<uint64_t> pts{INVALID_PTS};
+        std::array<std::atomic<int64_t>,N_STAGES> stageNs{};
+    };
+    struct RecordCopy{
+        uint64_t pts;
+        std::array<int64_t,N_STAGES> stageNs;
+    };
+    Record* find(const uint64_t pts){
+        const uint64_t next=mNext.load(std::memory_order_acquire);
+        const uint64_t depth=std::min<uint64_t>(next,SEARCH_DEPTH);
+        for(uint64_t i=1;i<=depth;i++){
+            Record& record=mRecords[(next-i) % CAPACITY];
+            if(record.pts.load(std::memory_order_acquire)==pts)return &record;
+        }
+        return nullptr;
+    }
+    std::vector<RecordCopy> snapshot()const{
+        const uint64_t next=mNext.load(std::memory_order_acquire);
+        const uint64_t count=std::min<uint64_t>(next,CAPACITY);
+        std::vector<RecordCopy> ret;
+        ret.reserve(count);
+        for(uint64_t i=next-count;i<next;i++){
+            const Record& record=mRecords[i % CAPACITY];
+            RecordCopy copy{record.pts.load(std::memory_order_acquire),{}};
+            if(copy.pts==INVALID_PTS)continue;
+            for(int stage=0;stage<N_STAGES;stage++){
+                copy.stageNs[stage]=record.stageNs[stage].load(std::memory_order_relaxed);
+            }
+            ret.push_back(copy);
+        }
+        return ret;
+    }
+    static StageStatistics calculateStatistics(const std::string& name,std::vector<float>& values){
+        StageStatistics ret;
+        ret.name=name;
+        ret.count=values.size();
+        if(values.empty())return ret;
+        std::sort(values.begin(),values.end());
+        const auto percentile=[&values](const float p){
+            return values[std::min(values.size()-1,(size_t)(p*(float)values.size()))];
+        };
+        ret.p50_ms=percentile(0.5f);
+        ret.p90_ms=percentile(0.9f);
+        ret.p99_ms=percentile(0.99f);
+        ret.max_ms=values.back();
+        return ret;
+    }
+    static int64_t toNs(const Clock::time_point timePoint){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(timePoint.time_since_epoch()).count();
+    }
+    static float nsToMs(const int64_t ns){
+        return (float)ns/1000000.0f;
+    }
+    std::array<Record,CAPACITY> mRecords;
+    std::atomic<uint64_t> mNext{0};
+};
+
+#endif //FPVUE_FRAMELATENCYTRACKER_HPP
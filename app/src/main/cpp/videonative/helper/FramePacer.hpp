@@ -0,0 +1,209 @@
+#ifndef FPVUE_FRAMEPACER_HPP
+#define FPVUE_FRAMEPACER_HPP
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include "SPSCQueue.hpp"
+#include "TimeHelper.hpp"
+
+// Hands decoded frames from the decoder output thread to the render loop (lock-free, SPSCQueue) and decides, once per
+// display frame, which one to upload.
+// The render loop calls select() with the predicted display time of the frame it is about to render. The newest frame
+// that was decoded early enough to be converted and uploaded before that (decodedAt<=predictedDisplay-uploadBudget)
+// is chosen, older ones are skipped without ever being converted. Frames that arrived too late stay queued for the
+// next display frame. If there is no new frame the current one is shown again (duplicated).
+// A chosen frame is late if it waited for more than 1.5 display periods, which only happens if the render loop
+// missed display frames. The display period is measured from the predicted display times.
+// Skipped frames are destroyed on the render loop. Only if it did not select for CAPACITY frames the decoder thread
+// drops the new ones instead.
+// Measures decode-to-upload and upload-to-display (predicted) latency per frame.
+// The clock is injected such that the selection can be tested deterministically.
+template<typename T>
+class FramePacer{
+public:
+    typedef std::chrono::steady_clock::time_point TIME_POINT;
+    typedef std::function<TIME_POINT()> CLOCK;
+    struct Options{
+        // Conversion + upload have to fit in between the decision and the display
+        std::chrono::nanoseconds uploadBudget=std::chrono::milliseconds(4);
+        // Without a new frame for this long the stream is considered paused, nothing is counted as duplicated
+        std::chrono::nanoseconds streamTimeout=std::chrono::milliseconds(100);
+    };
+    struct Frame{
+        T payload;
+        uint64_t pts=0;
+        TIME_POINT decodedAt;
+    };
+    // Counters since creation
+    struct Stats{
+        uint64_t nDisplayed=0;
+        uint64_t nSkipped=0;
+        uint64_t nDuplicated=0;
+        uint64_t nLate=0;
+    };
+    static constexpr size_t CAPACITY=8;
+public:
+    explicit FramePacer(Options options={},CLOCK clock=std::chrono::steady_clock::now):
+        mOptions(options),mClock(std::move(clock)){}
+    // Decoder thread. Skipped if CAPACITY frames are pending already
+    void onFrameDecoded(T payload,const uint64_t pts){
+        const auto now=mClock();
+        mLastDecodedAt.store(now,std::memory_order_relaxed);
+        if(!mPending.push(Frame{std::move(payload),pts,now})){
+            nSkipped++;
+        }
+    }
+    // Render loop, once per display frame. Returns the frame to upload, nullopt == keep showing the current one
+    std::optional<Frame> select(const TIME_POINT predictedDisplay){
+        const auto now=mClock();
+        updateDisplayPeriod(predictedDisplay);
+        std::optional<Frame> ret;
+        const auto deadline=predictedDisplay-mOptions.uploadBudget;
+        while(true){
+            // The oldest pending frame, the first one that was too late stays in mNext until the next display frame
+            if(!mNext.has_value()){
+                Frame frame;
+                if(!mPending.pop(frame))break;
+                mNext=std::move(frame);
+            }
+            if(mNext->decodedAt>deadline)break;
+            if(ret.has_value()){
+                nSkipped++;
+            }
+            ret=std::move(mNext);
+            mNext.reset();
+        }
+        const auto lastDecodedAt=mLastDecodedAt.load(std::memory_order_relaxed);
+        const bool streamActive=lastDecodedAt!=NEVER && now-lastDecodedAt<mOptions.streamTimeout;
+        if(ret.has_value()){
+            nDisplayed++;
+            if(mDisplayPeriod.count()>0 && now-ret->decodedAt>mDisplayPeriod*3/2){
+                nLate++;
+            }
+            mPendingUploadPts=ret->pts;
+            mPendingUploadDecodedAt=ret->decodedAt;
+            mPendingUploadDisplay=predictedDisplay;
+        }else if(streamActive){
+            nDuplicated++;
+        }
+        return ret;
+    }
+    // Render loop, after the frame returned by select() has been uploaded
+    void onUploaded(const uint64_t pts){
+        if(!mPendingUploadPts.has_value() || *mPendingUploadPts!=pts){
+            return;
+        }
+        const auto now=mClock();
+        decodeToUpload.add(now-mPendingUploadDecodedAt);
+        // 0 if the upload itself missed the predicted display time
+        uploadToDisplay.add(std::max(mPendingUploadDisplay-now,TIME_POINT::duration(0)));
+        mPendingUploadPts.reset();
+    }
+    Stats getStats()const{
+        return {nDisplayed.load(),nSkipped.load(),nDuplicated.load(),nLate.load()};
+    }
+    std::chrono::nanoseconds getDisplayPeriod()const{
+        return mDisplayPeriod;
+    }
+    LatencyHistogram decodeToUpload;
+    LatencyHistogram uploadToDisplay;
+private:
+    // Smoothed, deltas that are off by more than 50% (missed display frames, unusual predictions) are ignored
+    void updateDisplayPeriod(const TIME_POINT predictedDisplay){
+        if(mPreviousPredictedDisplay.has_value()){
+            const std::chrono::nanoseconds delta=predictedDisplay-*mPreviousPredictedDisplay;
+            if(mDisplayPeriod.count()==0){
+                if(delta.count()>0)mDisplayPeriod=delta;
+            }else if(delta>mDisplayPeriod/2 && delta<mDisplayPeriod*3/2){
+                mDisplayPeriod=(mDisplayPeriod*7+delta)/8;
+            }
+        }
+        mPreviousPredictedDisplay=predictedDisplay;
+    }
+    static constexpr TIME_POINT NEVER=TIME_POINT::min();
+    const Options mOptions;
+    const CLOCK mClock;
+    // Frames not selected yet, oldest first
+    SPSCQueue<Frame,CAPACITY> mPending;
+    std::atomic<TIME_POINT> mLastDecodedAt{NEVER};
+    // Render loop only
+    std::optional<Frame> mNext;
+    std::optional<TIME_POINT> mPreviousPredictedDisplay;
+    std::chrono::nanoseconds mDisplayPeriod{0};
+    std::optional<uint64_t> mPendingUploadPts;
+    TIME_POINT mPendingUploadDecodedAt;
+    TIME_POINT mPendingUploadDisplay;
+    std::atomic<uint64_t> nDisplayed{0};
+    std::atomic<uint64_t> nSkipped{0};
+    std::atomic<uint64_t> nDuplicated{0};
+    std::atomic<uint64_t> nLate{0};
+};
+
+namespace TEST_FRAME_PACER{
+    static void test(){
+        using namespace std::chrono;
+        typedef FramePacer<int>::TIME_POINT TIME_POINT;
+        TIME_POINT now{};
+        FramePacer<int> pacer({milliseconds(4),milliseconds(100)},[&now]{return now;});
+        // 72Hz, the frame rendered at display frame i is displayed two display frames later
+        const auto vsync=[](const int i){return TIME_POINT{}+microseconds(13889)*i;};
+        const auto tick=[&](const int i){
+            now=vsync(i);
+            return pacer.select(vsync(i+2));
+        };
+        // Nothing decoded yet: not a duplicate
+        assert(!tick(0).has_value());
+        assert(pacer.getStats().nDuplicated==0);
+        // Two frames in between two display frames: the newer one is chosen, the older one skipped
+        now=vsync(0)+milliseconds(2);
+        pacer.onFrameDecoded(1,1000);
+        now=vsync(0)+milliseconds(10);
+        pacer.onFrameDecoded(2,9000);
+        auto frame=tick(1);
+        assert(frame.has_value() && frame->payload==2);
+        now+=milliseconds(2);
+        pacer.onUploaded(frame->pts);
+        const auto decodeToUpload=pacer.decodeToUpload.getSnapshot();
+        assert(decodeToUpload.count==1 && decodeToUpload.getMax()>microseconds(5800) && decodeToUpload.getMax()<microseconds(6000));
+        assert(pacer.uploadToDisplay.getSnapshot().count==1);
+        // No new frame: the current one is duplicated
+        assert(!tick(2).has_value());
+        // A frame decoded after the upload deadline waits for the next display frame
+        now=vsync(3)-microseconds(100);
+        pacer.onFrameDecoded(3,17000);
+        now=vsync(3);
+        assert(!pacer.select(vsync(3)+milliseconds(3)).has_value());
+        frame=tick(3);
+        assert(frame.has_value() && frame->payload==3);
+        now=vsync(5);
+        pacer.onFrameDecoded(4,25000);
+        frame=tick(5);
+        assert(frame.has_value() && frame->payload==4);
+        auto stats=pacer.getStats();
+        assert(stats.nDisplayed==3 && stats.nSkipped==1 && stats.nDuplicated==2 && stats.nLate==0);
+        assert(pacer.getDisplayPeriod()>microseconds(13800) && pacer.getDisplayPeriod()<microseconds(14000));
+        // The render loop misses two display frames: the frame decoded in between is late
+        now=vsync(5)+milliseconds(1);
+        pacer.onFrameDecoded(5,33000);
+        frame=tick(8);
+        assert(frame.has_value() && frame->payload==5);
+        assert(pacer.getStats().nLate==1);
+        // More frames than the capacity without a display frame: the ones that do not fit are skipped, then all but
+        // the newest pending one
+        for(int i=0;i<10;i++){
+            pacer.onFrameDecoded(6+i,41000+i*8000);
+        }
+        frame=tick(9);
+        assert(frame.has_value() && frame->payload==13);
+        // The stream stopped: no duplicates counted
+        tick(30);
+        stats=pacer.getStats();
+        assert(stats.nDisplayed==5 && stats.nSkipped==1+2+7 && stats.nDuplicated==2);
+        MLOGD<<"FramePacer test passed";
+    }
+}
+
+#endif //FPVUE_FRAMEPACER_HPP
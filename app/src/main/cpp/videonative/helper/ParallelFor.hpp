@@ -0,0 +1,107 @@
+#ifndef FPVUE_PARALLELFOR_HPP
+#define FPVUE_PARALLELFOR_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __ANDROID__
+#include "NDKThreadHelper.hpp"
+#endif
+
+// Minimal fork-join pool for splitting per-frame work (e.g. rows of an image) across cores.
+// The worker threads are created once and sleep between frames. run() splits [0,n) into one contiguous chunk per
+// thread, the calling thread works on the first chunk itself and returns once all chunks are done.
+// run() may only be called from one thread at a time.
+class ParallelFor{
+public:
+    typedef std::function<void(size_t begin,size_t end)> RANGE_FUNCTION;
+    // chunk: 0..getNThreads()-1, no two chunks of one run() share it (e.g. to index per thread scratch buffers)
+    typedef std::function<void(size_t chunk,size_t begin,size_t end)> CHUNK_FUNCTION;
+    // nThreads includes the calling thread, 1 == run everything on the calling thread
+    explicit ParallelFor(const size_t nThreads,[[maybe_unused]] const std::string& name="ParallelFor"){
+        for(size_t i=1;i<nThreads;i++){
+            mWorkers.emplace_back(&ParallelFor::workerLoop,this,i);
+#ifdef __ANDROID__
+            NDKThreadHelper::setName(mWorkers.back().native_handle(),name.c_str());
+#endif
+        }
+    }
+    ~ParallelFor(){
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop=true;
+        }
+        mStartCondition.notify_all();
+        for(auto& worker:mWorkers){
+            worker.join();
+        }
+    }
+    ParallelFor(const ParallelFor&)=delete;
+    void run(const size_t n,const RANGE_FUNCTION& function){
+        run(n,CHUNK_FUNCTION([&function](size_t,const size_t begin,const size_t end){
+            function(begin,end);
+        }));
+    }
+    void run(const size_t n,const CHUNK_FUNCTION& function){
+        if(mWorkers.empty() || n<2){
+            function(0,0,n);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFunction=&function;
+            mN=n;
+            mPending=mWorkers.size();
+            mGeneration++;
+        }
+        mStartCondition.notify_all();
+        const auto range=chunk(0,n);
+        function(0,range.first,range.second);
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCondition.wait(lock,[this]{return mPending==0;});
+        mFunction=nullptr;
+    }
+    size_t getNThreads()const{
+        return mWorkers.size()+1;
+    }
+private:
+    std::pair<size_t,size_t> chunk(const size_t index,const size_t n)const{
+        const size_t nChunks=mWorkers.size()+1;
+        return {n*index/nChunks,n*(index+1)/nChunks};
+    }
+    void workerLoop(const size_t index){
+        uint64_t generation=0;
+        std::unique_lock<std::mutex> lock(mMutex);
+        while(true){
+            mStartCondition.wait(lock,[this,generation]{return mStop || mGeneration!=generation;});
+            if(mStop)return;
+            generation=mGeneration;
+            const CHUNK_FUNCTION* function=mFunction;
+            const auto range=chunk(index,mN);
+            lock.unlock();
+            if(range.first<range.second){
+                (*function)(index,range.first,range.second);
+            }
+            lock.lock();
+            if(--mPending==0){
+                mDoneCondition.notify_one();
+            }
+        }
+    }
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mStartCondition;
+    std::condition_variable mDoneCondition;
+    bool mStop=false;
+    uint64_t mGeneration=0;
+    const CHUNK_FUNCTION* mFunction=nullptr;
+    size_t mN=0;
+    size_t mPending=0;
+};
+
+#endif //FPVUE_PARALLELFOR_HPP
@@ -0,0 +1,57 @@
+#ifndef FPVUE_SPSCQUEUE_HPP
+#define FPVUE_SPSCQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded, lock-free single producer / single consumer queue.
+// push() may only be called from one thread and pop() from one (other) thread at a time.
+// Neither call blocks - they return false if the queue is full / empty.
+template<typename T,std::size_t CAPACITY>
+class SPSCQueue{
+    static_assert(CAPACITY>=2 && (CAPACITY & (CAPACITY-1))==0,"CAPACITY has to be a power of 2");
+public:
+    bool push(T value){
+        const auto tail=mTail.load(std::memory_order_relaxed);
+        if(tail-mHead.load(std::memory_order_acquire)==CAPACITY){
+            return false;
+        }
+        mData[tail & MASK]=std::move(value);
+        mTail.store(tail+1,std::memory_order_release);
+        return true;
+    }
+    bool pop(T& out){
+        const auto head=mHead.load(std::memory_order_relaxed);
+        if(head==mTail.load(std::memory_order_acquire)){
+            return false;
+        }
+        out=std::move(mData[head & MASK]);
+        mHead.store(head+1,std::memory_order_release);
+        return true;
+    }
+    // Only approximate if called while the other side is running
+    std::size_t size()const{
+        return mTail.load(std::memory_order_acquire)-mHead.load(std::memory_order_acquire);
+    }
+    bool empty()const{
+        return size()==0;
+    }
+    static constexpr std::size_t capacity(){
+        return CAPACITY;
+    }
+    // Consumer side - drop everything that is currently queued
+    void clear(){
+        T unused;
+        while(pop(unused)){}
+    }
+private:
+    static constexpr std::size_t MASK=CAPACITY-1;
+    // Producer and consumer index on their own cache line to avoid false sharing
+    alignas(64) std::atomic<std::size_t> mHead{0};
+    alignas(64) std::atomic<std::size_t> mTail{0};
+    alignas(64) std::array<T,CAPACITY> mData{};
+};
+
+#endif //FPVUE_SPSCQUEUE_HPP
@@ -8,6 +8,11 @@
 #include "AndroidLogger.hpp"
 #include <chrono>
 #include <deque>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <vector>
 #include "StringHelper.hpp"
 
 namespace MyTimeHelper{
@@ -296,7 +301,161 @@ public:
     }
 };
 
+
+// Log-linear (HDR style) histogram of durations with ns resolution.
+// Every power of 2 range is split into SUB_BUCKET_COUNT linear buckets, which bounds the relative error of
+// the reported percentiles to 1/SUB_BUCKET_COUNT (~3%) independent of the magnitude of the value.
+// Recording is constant time and lock-free (safe for any number of concurrent writers), reading is done trough snapshots.
+class LatencyHistogram{
+public:
+    static constexpr int SUB_BUCKET_BITS=5;
+    static constexpr uint64_t SUB_BUCKET_COUNT=1<<SUB_BUCKET_BITS;
+    // Covers the whole uint64_t range
+    static constexpr size_t N_BUCKETS=SUB_BUCKET_COUNT+(64-SUB_BUCKET_BITS)*SUB_BUCKET_COUNT;
+    static size_t bucketIndex(const uint64_t value){
+        if(value<SUB_BUCKET_COUNT)return (size_t)value;
+        const int shift=std::bit_width(value)-1-SUB_BUCKET_BITS;
+        return (size_t)(SUB_BUCKET_COUNT+(uint64_t)shift*SUB_BUCKET_COUNT+((value>>shift)-SUB_BUCKET_COUNT));
+    }
+    // Smallest value that falls into this bucket
+    static uint64_t bucketLowerBound(const size_t index){
+        if(index<SUB_BUCKET_COUNT)return index;
+        const uint64_t shift=(index-SUB_BUCKET_COUNT)/SUB_BUCKET_COUNT;
+        const uint64_t sub=(index-SUB_BUCKET_COUNT)%SUB_BUCKET_COUNT;
+        return (SUB_BUCKET_COUNT+sub)<<shift;
+    }
+    // Width of the value range of this bucket
+    static uint64_t bucketWidth(const size_t index){
+        if(index<SUB_BUCKET_COUNT)return 1;
+        return (uint64_t)1<<((index-SUB_BUCKET_COUNT)/SUB_BUCKET_COUNT);
+    }
+    // Plain copy of the histogram at one point in time. Can be merged with other snapshots
+    class Snapshot{
+    public:
+        Snapshot():counts(N_BUCKETS,0){}
+        std::vector<uint64_t> counts;
+        uint64_t count=0;
+        uint64_t sumNs=0;
+        uint64_t maxNs=0;
+        void merge(const Snapshot& other){
+            for(size_t i=0;i<N_BUCKETS;i++){
+                counts[i]+=other.counts[i];
+            }
+            count+=other.count;
+            sumNs+=other.sumNs;
+            maxNs=std::max(maxNs,other.maxNs);
+        }
+        // percentile in [0,100]. Returns the middle of the bucket the value falls into (but never more than the max)
+        std::chrono::nanoseconds getPercentile(const double percentile)const{
+            if(count==0)return std::chrono::nanoseconds(0);
+            const auto wanted=std::max<uint64_t>(1,(uint64_t)std::ceil(percentile/100.0*(double)count));
+            uint64_t seen=0;
+            for(size_t i=0;i<N_BUCKETS;i++){
+                seen+=counts[i];
+                if(seen>=wanted){
+                    const uint64_t value=bucketLowerBound(i)+(bucketWidth(i)-1)/2;
+                    return std::chrono::nanoseconds(std::min(value,maxNs));
+                }
+            }
+            return std::chrono::nanoseconds(maxNs);
+        }
+        std::chrono::nanoseconds getAvg()const{
+            if(count==0)return std::chrono::nanoseconds(0);
+            return std::chrono::nanoseconds(sumNs/count);
+        }
+        std::chrono::nanoseconds getMax()const{
+            return std::chrono::nanoseconds(maxNs);
+        }
+        float getPercentile_ms(const double percentile)const{
+            return toMs(getPercentile(percentile));
+        }
+        float getAvg_ms()const{
+            return toMs(getAvg());
+        }
+        float getMax_ms()const{
+            return toMs(getMax());
+        }
+        std::string getPercentilesReadable()const{
+            std::stringstream ss;
+            ss<<"p50="<<MyTimeHelper::R(getPercentile(50))<<" p90="<<MyTimeHelper::R(getPercentile(90))<<" p99="<<MyTimeHelper::R(getPercentile(99))
+              <<" p99.9="<<MyTimeHelper::R(getPercentile(99.9))<<" max="<<MyTimeHelper::R(getMax())<<" N samples="<<count;
+            return ss.str();
+        }
+    private:
+        static float toMs(const std::chrono::nanoseconds& value){
+            return (float)std::chrono::duration_cast<std::chrono::microseconds>(value).count()/1000.0f;
+        }
+    };
+public:
+    LatencyHistogram():mCounts(N_BUCKETS){}
+    void add(const std::chrono::nanoseconds& value){
+        if(value<std::chrono::nanoseconds(0)){
+            MLOGE<<"Cannot add negative value";
+            return;
+        }
+        const auto ns=(uint64_t)value.count();
+        mCounts[bucketIndex(ns)].fetch_add(1,std::memory_order_relaxed);
+        mSumNs.fetch_add(ns,std::memory_order_relaxed);
+        uint64_t currentMax=mMaxNs.load(std::memory_order_relaxed);
+        while(ns>currentMax && !mMaxNs.compare_exchange_weak(currentMax,ns,std::memory_order_relaxed)){}
+    }
+    // Everything recorded since creation / the last takeIntervalSnapshot() / reset(). Does not modify the histogram
+    Snapshot getSnapshot()const{
+        Snapshot ret;
+        for(size_t i=0;i<N_BUCKETS;i++){
+            ret.counts[i]=mCounts[i].load(std::memory_order_relaxed);
+            ret.count+=ret.counts[i];
+        }
+        ret.sumNs=mSumNs.load(std::memory_order_relaxed);
+        ret.maxNs=mMaxNs.load(std::memory_order_relaxed);
+        return ret;
+    }
+    // Like getSnapshot(), but atomically moves the recorded samples into the snapshot. Samples recorded concurrently
+    // end up either in this or in the next interval, none is lost.
+    Snapshot takeIntervalSnapshot(){
+        Snapshot ret;
+        for(size_t i=0;i<N_BUCKETS;i++){
+            ret.counts[i]=mCounts[i].exchange(0,std::memory_order_relaxed);
+            ret.count+=ret.counts[i];
+        }
+        ret.sumNs=mSumNs.exchange(0,std::memory_order_relaxed);
+        ret.maxNs=mMaxNs.exchange(0,std::memory_order_relaxed);
+        return ret;
+    }
+    void reset(){
+        takeIntervalSnapshot();
+    }
+private:
+    std::vector<std::atomic<uint64_t>> mCounts;
+    std::atomic<uint64_t> mSumNs{0};
+    std::atomic<uint64_t> mMaxNs{0};
+};
+
 namespace TEST_TIME_HELPER{
+    static void testLatencyHistogram(){
+        // The buckets are continuous and every value maps to the bucket that contains it
+        for(const uint64_t value:std::vector<uint64_t>{0,1,31,32,63,64,1000,123456789,UINT64_MAX}){
+            const auto index=LatencyHistogram::bucketIndex(value);
+            assert(index<LatencyHistogram::N_BUCKETS);
+            const auto lower=LatencyHistogram::bucketLowerBound(index);
+            assert(lower<=value && value-lower<LatencyHistogram::bucketWidth(index));
+        }
+        LatencyHistogram histogram;
+        for(int i=1;i<=1000;i++){
+            histogram.add(std::chrono::microseconds(i));
+        }
+        auto snapshot=histogram.getSnapshot();
+        assert(snapshot.count==1000);
+        assert(snapshot.getMax()==std::chrono::microseconds(1000));
+        // Within the relative error of the histogram
+        const auto p99=snapshot.getPercentile(99);
+        assert(p99>std::chrono::microseconds(990)*97/100 && p99<std::chrono::microseconds(990)*103/100);
+        const auto interval=histogram.takeIntervalSnapshot();
+        assert(interval.count==1000 && histogram.getSnapshot().count==0);
+        snapshot.merge(interval);
+        assert(snapshot.count==2000 && snapshot.getPercentile(50)==interval.getPercentile(50));
+        MLOGD<<"LatencyHistogram "<<snapshot.getPercentilesReadable();
+    }
     static void test(){
         std::vector<std::chrono::nanoseconds> testData={
             std::chrono::nanoseconds(1),
@@ -311,6 +470,7 @@ namespace TEST_TIME_HELPER{
         }
         assert(avgCalculator.getMin()==std::chrono::nanoseconds(1));
         assert(avgCalculator.getMax()==std::chrono::nanoseconds(100));
+        testLatencyHistogram();
     }
 };
 
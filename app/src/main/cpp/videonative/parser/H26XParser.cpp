@@ -3,14 +3,16 @@
 //
 #include "H26XParser.h"
 #include <cstring>
+#ifdef __ANDROID__
 #include <android/log.h>
+#endif
 #include <endian.h>
 #include <chrono>
 #include <thread>
 
 H26XParser::H26XParser(NALU_DATA_CALLBACK onNewNALU):
         onNewNALU(std::move(onNewNALU)),
-        mDecodeRTP(std::bind(&H26XParser::onNewNaluDataExtracted, this, std::placeholders::_1,std::placeholders::_2,std::placeholders::_3)){
+        mDecodeRTP(std::bind(&H26XParser::onNewNaluDataExtracted, this, std::placeholders::_1,std::placeholders::_2,std::placeholders::_3,std::placeholders::_4)){
 }
 
 void H26XParser::reset(){
@@ -35,9 +37,9 @@ void H26XParser::parse_rtp_h265_stream(const uint8_t *rtp_data, const size_t dat
     mDecodeRTP.parseRTPH265toNALU(rtp_data, data_length);
 }
 
-void H26XParser::onNewNaluDataExtracted(const std::chrono::steady_clock::time_point creation_time,
+void H26XParser::onNewNaluDataExtracted(const std::chrono::steady_clock::time_point creation_time,const std::chrono::steady_clock::time_point last_packet_time,
                                         const uint8_t *nalu_data, const int nalu_data_size) {
-    NALU nalu(nalu_data, nalu_data_size, true, creation_time); // true for h265
+    NALU nalu(nalu_data, nalu_data_size, true, creation_time, last_packet_time); // true for h265
     newNaluExtracted(nalu);
 }
 
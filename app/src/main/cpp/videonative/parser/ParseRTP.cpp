@@ -107,6 +107,7 @@ void RTPDecoder::h264_reconstruct_and_forward_one_nalu(const uint8_t *data,const
 }
 
 void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_length){
+    timePointLastPacket=std::chrono::steady_clock::now();
     //12 rtp header bytes and 1 nalu_header_t type byte
     if(data_length <= sizeof(rtp_header_t)+sizeof(nalu_header_t)){
         MLOGD<<"Not enough rtp data";
@@ -213,6 +214,7 @@ void RTPDecoder::h265_forward_one_nalu(const uint8_t *data, int data_size,bool w
 }
 
 void RTPDecoder::parseRTPH265toNALU(const uint8_t* rtp_data, const size_t data_length){
+    timePointLastPacket=std::chrono::steady_clock::now();
     // 12 rtp header bytes and 1 nalu_header_t type byte
     if(data_length <= sizeof(rtp_header_t)+sizeof(nal_unit_header_h265_t)){
         MLOGD<<"Not enough rtp data";
@@ -319,7 +321,7 @@ void RTPDecoder::forwardNALU(const bool isH265) {
         char str[10000];
         sprintf(str, "%hhu", nal_type_hevc);
         //MLOGD << "nal header="  << str;
-        m_cb(timePointStartOfReceivingNALU,p,m_nalu_data_length);
+        m_cb(timePointStartOfReceivingNALU,timePointLastPacket,p,m_nalu_data_length);
     }
     m_nalu_data_length=0;
 }
@@ -24,7 +24,8 @@
 // Enough for pretty much any resolution/framerate we handle in OpenHD
 static constexpr const auto NALU_MAXLEN=1024*1024;
 
-typedef std::function<void(const std::chrono::steady_clock::time_point creation_time,const uint8_t* nalu_data,const int nalu_data_size)> RTP_FRAME_DATA_CALLBACK;
+// creation_time: first rtp packet of the NALU received, last_packet_time: last rtp packet of the NALU received
+typedef std::function<void(const std::chrono::steady_clock::time_point creation_time,const std::chrono::steady_clock::time_point last_packet_time,const uint8_t* nalu_data,const int nalu_data_size)> RTP_FRAME_DATA_CALLBACK;
 
 class RTPDecoder{
 public:
@@ -73,6 +74,8 @@ public:
     // This time point is as 'early as possible' to debug the parsing time as accurately as possible.
     // E.g for a fu-a NALU the time point when the start fu-a was received, not when its end is received
     std::chrono::steady_clock::time_point timePointStartOfReceivingNALU;
+    // Time point the last (so far) rtp packet was received. When a NALU is forwarded this is the time its last fragment arrived
+    std::chrono::steady_clock::time_point timePointLastPacket;
 private:
     // reconstruct and forward a single nalu, either from a "single" or "aggregated" rtp packet (not from a fragmented packet)
     // data should point to the nalu_header_t, size includes the nalu_header_t size and the following bytes that make up the nalu
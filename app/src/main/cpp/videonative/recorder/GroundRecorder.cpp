@@ -0,0 +1,86 @@
+#include "GroundRecorder.h"
+#include "../helper/AndroidLogger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+GroundRecorder::~GroundRecorder() {
+    stop();
+}
+
+bool GroundRecorder::start(const std::string& fileName) {
+    stop();
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    if(!mWriter.start(fileName)){
+        MLOGE<<"Cannot start recording "<<fileName<<" "<<strerror(errno);
+        return false;
+    }
+    nNALUsRecorded=0;
+    nNALUsDropped=0;
+    mWaitForIRAP=true;
+    mRecording=true;
+    MLOGD<<"Recording to "<<fileName;
+    return true;
+}
+
+void GroundRecorder::stop() {
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    if(!mRecording)return;
+    mRecording=false;
+    mWriter.stop();
+    MLOGD<<"Recording stopped, NALUs:"<<nNALUsRecorded<<" dropped NALUs:"<<nNALUsDropped;
+}
+
+void GroundRecorder::onNewNALU(const NALU& nalu) {
+    if(!mRecording)return;
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    if(!mRecording)return;
+    // Keep the latest parameter sets, such that recording can (re-)start with a decodable IRAP
+    if(nalu.IS_H265_PACKET && nalu.isVPS())mVPS.assign(nalu.getData(),nalu.getData()+nalu.getSize());
+    if(nalu.isSPS())mSPS.assign(nalu.getData(),nalu.getData()+nalu.getSize());
+    if(nalu.isPPS())mPPS.assign(nalu.getData(),nalu.getData()+nalu.getSize());
+    size_t size=nalu.getSize();
+    const bool resume=mWaitForIRAP;
+    if(resume){
+        if(!nalu.is_irap() || mSPS.empty() || mPPS.empty() || (nalu.IS_H265_PACKET && mVPS.empty())){
+            return;
+        }
+        size+=(nalu.IS_H265_PACKET ? mVPS.size() : 0)+mSPS.size()+mPPS.size();
+    }
+    if(!mWriter.hasSpaceFor(size)){
+        // Everything already queued stays decodable, continue at the next IRAP
+        nNALUsDropped++;
+        mWaitForIRAP=true;
+        return;
+    }
+    if(resume){
+        if(nalu.IS_H265_PACKET)mWriter.append(mVPS.data(),mVPS.size());
+        mWriter.append(mSPS.data(),mSPS.size());
+        mWriter.append(mPPS.data(),mPPS.size());
+        mWaitForIRAP=false;
+    }
+    mWriter.append(nalu.getData(),nalu.getSize());
+    nNALUsRecorded++;
+    mWriter.flushIfDue();
+}
+
+GroundRecorder::Stats GroundRecorder::getStats() const {
+    const auto writerStats=mWriter.getStats();
+    Stats ret;
+    ret.nBytesWritten=writerStats.nBytesWritten;
+    ret.nNALUsRecorded=nNALUsRecorded;
+    ret.nNALUsDropped=nNALUsDropped;
+    ret.nWriteErrors=writerStats.nWriteErrors;
+    ret.writeMBytesPerSecond=writerStats.writeMBytesPerSecond;
+    ret.openErrno=writerStats.openErrno;
+    return ret;
+}
+
+std::string GroundRecorder::createFileName(const std::string& directory,const bool IS_H265,const std::string& prefix) {
+    const time_t now=time(nullptr);
+    tm local{};
+    localtime_r(&now,&local);
+    char name[64];
+    strftime(name,sizeof(name),"_%Y%m%d_%H%M%S",&local);
+    return directory+"/"+prefix+name+(IS_H265 ? ".h265" : ".h264");
+}
@@ -0,0 +1,71 @@
+#ifndef FPVUE_GROUNDRECORDER_H
+#define FPVUE_GROUNDRECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../NALU/NALU.hpp"
+#include "../helper/BatchedFileWriter.hpp"
+
+// Records the received (still compressed) video as an Annex-B elementary stream (.h264 / .h265), which any player
+// can open and which stays playable if the app dies mid recording (there is no index to finalize).
+// onNewNALU() runs on the parser thread and never blocks: NALUs are copied into the batches of a BatchedFileWriter,
+// which writes them into a file preallocated in large steps. If the I/O thread falls behind and no batch is free
+// the NALU is dropped and recording resumes at the next IRAP, such that the file always stays decodable.
+// start() and stop() do not block, the I/O thread creates and finalizes the file.
+class GroundRecorder{
+public:
+    // Since the last start()
+    struct Stats{
+        uint64_t nBytesWritten=0;
+        uint64_t nNALUsRecorded=0;
+        // No free batch (the I/O thread fell behind)
+        uint64_t nNALUsDropped=0;
+        // Batches lost because write() failed
+        uint64_t nWriteErrors=0;
+        // Throughput of the write() calls themselves
+        double writeMBytesPerSecond=0;
+        // errno if the file could not be created, nothing is recorded then
+        int openErrno=0;
+    };
+    // 16 batches of 512KB buffer ~1.6s of a 40MBit/s stream
+    static constexpr size_t BATCH_SIZE=512*1024;
+    static constexpr size_t N_BATCHES=16;
+    // A partially filled batch is handed to the I/O thread after this time at the latest
+    static constexpr std::chrono::milliseconds MAX_BATCH_AGE{250};
+    static constexpr size_t PREALLOCATE_STEP=32*1024*1024;
+public:
+    GroundRecorder()=default;
+    ~GroundRecorder();
+    GroundRecorder(const GroundRecorder&)=delete;
+    // Records into fileName from the next IRAP on. False if the I/O thread is still busy with earlier recordings
+    bool start(const std::string& fileName);
+    // The I/O thread writes everything that is queued, then closes the file
+    void stop();
+    // Blocks until the files of all stop() calls so far are closed
+    void waitUntilClosed(){
+        mWriter.waitUntilClosed();
+    }
+    bool isRecording()const{
+        return mRecording;
+    }
+    // Parser thread
+    void onNewNALU(const NALU& nalu);
+    Stats getStats()const;
+    // e.g. "fpv_20240131_235959.h265" in directory
+    static std::string createFileName(const std::string& directory,bool IS_H265,const std::string& prefix="fpv");
+private:
+    std::atomic<bool> mRecording=false;
+    // Only contended by start() / stop()
+    std::mutex mProducerMutex;
+    BatchedFileWriter<BATCH_SIZE,N_BATCHES> mWriter{"GroundRecorder",MAX_BATCH_AGE,PREALLOCATE_STEP};
+    bool mWaitForIRAP=true;
+    // The latest parameter sets, written in front of the first IRAP
+    std::vector<uint8_t> mVPS,mSPS,mPPS;
+    std::atomic<uint64_t> nNALUsRecorded{0};
+    std::atomic<uint64_t> nNALUsDropped{0};
+};
+
+#endif //FPVUE_GROUNDRECORDER_H
@@ -0,0 +1,209 @@
+#include "PreRollBuffer.h"
+#include "../helper/AndroidLogger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __ANDROID__
+#include "../helper/NDKThreadHelper.hpp"
+#endif
+
+using namespace std::chrono;
+
+namespace{
+    // Parameter sets are tiny, reserved once such that caching them never allocates
+    constexpr size_t MAX_PARAMETER_SET_SIZE=1024;
+    void assignParameterSet(std::vector<uint8_t>& dst,const NALU& nalu){
+        if(nalu.getSize()>MAX_PARAMETER_SET_SIZE)return;
+        dst.assign(nalu.getData(),nalu.getData()+nalu.getSize());
+    }
+    bool writeFully(const int fd,const uint8_t* data,size_t size){
+        while(size>0){
+            const ssize_t n=write(fd,data,size);
+            if(n<0){
+                if(errno==EINTR)continue;
+                return false;
+            }
+            data+=n;
+            size-=(size_t)n;
+        }
+        return true;
+    }
+}
+
+PreRollBuffer::PreRollBuffer(const size_t maxBytes,const std::chrono::nanoseconds duration):
+        mDuration(duration),mData(maxBytes){
+    mVPS.reserve(MAX_PARAMETER_SET_SIZE);
+    mSPS.reserve(MAX_PARAMETER_SET_SIZE);
+    mPPS.reserve(MAX_PARAMETER_SET_SIZE);
+}
+
+PreRollBuffer::~PreRollBuffer() {
+    if(mExportThread){
+        mExportThread->join();
+    }
+}
+
+void PreRollBuffer::onNewNALU(const NALU& nalu) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    // Parameter sets are only cached, every GOP gets the latest ones in front of its IRAP
+    if(nalu.IS_H265_PACKET && nalu.isVPS()){
+        assignParameterSet(mVPS,nalu);
+        return;
+    }
+    if(nalu.isSPS()){
+        assignParameterSet(mSPS,nalu);
+        return;
+    }
+    if(nalu.isPPS()){
+        assignParameterSet(mPPS,nalu);
+        return;
+    }
+    const bool irap=nalu.is_irap();
+    // The slices of one IRAP picture belong to the same GOP
+    const bool newGOP=irap && !mLastWasIRAP;
+    mLastWasIRAP=irap;
+    if(newGOP){
+        if(mSPS.empty() || mPPS.empty() || (nalu.IS_H265_PACKET && mVPS.empty())){
+            mWaitForIRAP=true;
+            return;
+        }
+        const size_t size=mVPS.size()+mSPS.size()+mPPS.size()+nalu.getSize();
+        if(!makeSpace(size,true)){
+            nNALUsDropped++;
+            mWaitForIRAP=true;
+            return;
+        }
+        beginGOP(nalu);
+        mWaitForIRAP=false;
+        return;
+    }
+    if(mWaitForIRAP)return;
+    if(!makeSpace(nalu.getSize(),false)){
+        nNALUsDropped++;
+        mWaitForIRAP=true;
+        return;
+    }
+    append(nalu.getData(),nalu.getSize());
+}
+
+bool PreRollBuffer::makeSpace(const size_t size,const bool newGOP) {
+    const auto now=steady_clock::now();
+    // Keep at least mDuration: the oldest GOP can go once the next one is old enough to cover it
+    while(mNGOPs>1 && now-mGOPs[(mOldestGOP+1)%MAX_GOPS].time>=mDuration){
+        evictOldestGOP();
+    }
+    while(mNGOPs>0){
+        const uint64_t oldest=mGOPs[mOldestGOP].start;
+        if(mWritePosition+size-oldest<=mData.size())break;
+        if(mNGOPs==1 && !newGOP){
+            // A single GOP larger than the ring cannot be replayed
+            clear();
+            return false;
+        }
+        evictOldestGOP();
+    }
+    if(mPinnedFrom.has_value() && mWritePosition+size-*mPinnedFrom>mData.size()){
+        return false;
+    }
+    return size<=mData.size();
+}
+
+void PreRollBuffer::beginGOP(const NALU& irap) {
+    if(mNGOPs==MAX_GOPS){
+        evictOldestGOP();
+    }
+    mGOPs[(mOldestGOP+mNGOPs)%MAX_GOPS]=GOP{mWritePosition,steady_clock::now()};
+    mNGOPs++;
+    if(irap.IS_H265_PACKET)append(mVPS.data(),mVPS.size());
+    append(mSPS.data(),mSPS.size());
+    append(mPPS.data(),mPPS.size());
+    append(irap.getData(),irap.getSize());
+}
+
+void PreRollBuffer::append(const uint8_t* data,const size_t size) {
+    const size_t offset=mWritePosition%mData.size();
+    const size_t first=std::min(size,mData.size()-offset);
+    memcpy(&mData[offset],data,first);
+    memcpy(mData.data(),data+first,size-first);
+    mWritePosition+=size;
+}
+
+void PreRollBuffer::evictOldestGOP() {
+    mOldestGOP=(mOldestGOP+1)%MAX_GOPS;
+    mNGOPs--;
+}
+
+void PreRollBuffer::clear() {
+    mNGOPs=0;
+    mOldestGOP=0;
+    mWaitForIRAP=true;
+}
+
+bool PreRollBuffer::exportTo(const std::string& fileName) {
+    if(mExporting)return false;
+    if(mExportThread){
+        mExportThread->join();
+        mExportThread.reset();
+    }
+    uint64_t start,end;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(mNGOPs==0)return false;
+        start=mGOPs[mOldestGOP].start;
+        // The current GOP is usually incomplete, playback simply ends with its last frame
+        end=mWritePosition;
+        mPinnedFrom=start;
+    }
+    mExporting=true;
+    mExportThread=std::make_unique<std::thread>(&PreRollBuffer::writeExport,this,fileName,start,end);
+#ifdef __ANDROID__
+    NDKThreadHelper::setName(mExportThread->native_handle(),"PreRollExport");
+#endif
+    return true;
+}
+
+void PreRollBuffer::writeExport(std::string fileName,const uint64_t start,const uint64_t end) {
+    const auto before=steady_clock::now();
+    bool ok=false;
+    int error=0;
+    const int fd=open(fileName.c_str(),O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0644);
+    if(fd>=0){
+        // The pinned range is not written by the parser thread, no lock needed. Two parts if it wraps around
+        const size_t offset=start%mData.size();
+        const size_t size=end-start;
+        const size_t first=std::min(size,mData.size()-offset);
+        ok=writeFully(fd,&mData[offset],first) && writeFully(fd,mData.data(),size-first) && fdatasync(fd)==0;
+        error=errno;
+        close(fd);
+    }else{
+        error=errno;
+    }
+    if(ok){
+        nExports++;
+        MLOGD<<"Exported "<<(end-start)<<" bytes to "<<fileName<<" in "<<duration_cast<milliseconds>(steady_clock::now()-before).count()<<"ms";
+    }else{
+        nExportErrors++;
+        MLOGE<<"Cannot export to "<<fileName<<" "<<strerror(error);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPinnedFrom.reset();
+    }
+    mExporting=false;
+}
+
+PreRollBuffer::Stats PreRollBuffer::getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats ret;
+    if(mNGOPs>0){
+        const GOP& oldest=mGOPs[mOldestGOP];
+        ret.nBytes=mWritePosition-oldest.start;
+        ret.duration=duration_cast<milliseconds>(steady_clock::now()-oldest.time);
+    }
+    ret.nGOPs=mNGOPs;
+    ret.nNALUsDropped=nNALUsDropped;
+    ret.nExports=nExports;
+    ret.nExportErrors=nExportErrors;
+    return ret;
+}
@@ -0,0 +1,86 @@
+#ifndef FPVUE_PREROLLBUFFER_H
+#define FPVUE_PREROLLBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../NALU/NALU.hpp"
+
+// Keeps the last seconds of the received (still compressed) video in memory, such that what happened before anyone
+// pressed record can be saved as an instant replay.
+// The NALUs the parser outputs are copied into a byte ring allocated once (hard memory cap, nothing is allocated
+// afterwards). The ring is made of whole GOPs: each one starts with the parameter sets and an IRAP, and the oldest GOP
+// is evicted as a whole once the remaining ones still cover the wanted duration or the memory is needed.
+// exportTo() writes the ring as an Annex-B file on a background thread. While it runs the exported bytes are pinned:
+// if the ring would have to overwrite them new NALUs are not buffered (counted) until the next IRAP after the export.
+class PreRollBuffer{
+public:
+    struct Stats{
+        // Currently buffered
+        size_t nBytes=0;
+        size_t nGOPs=0;
+        std::chrono::milliseconds duration{0};
+        // Not buffered because the ring was pinned by an export, or a single GOP does not fit
+        uint64_t nNALUsDropped=0;
+        uint64_t nExports=0;
+        uint64_t nExportErrors=0;
+    };
+    // ~10s of a 40MBit/s stream
+    static constexpr size_t DEFAULT_MAX_BYTES=48*1024*1024;
+    static constexpr std::chrono::seconds DEFAULT_DURATION{10};
+    static constexpr size_t MAX_GOPS=256;
+public:
+    explicit PreRollBuffer(size_t maxBytes=DEFAULT_MAX_BYTES,std::chrono::nanoseconds duration=DEFAULT_DURATION);
+    ~PreRollBuffer();
+    PreRollBuffer(const PreRollBuffer&)=delete;
+    // Parser thread
+    void onNewNALU(const NALU& nalu);
+    // Writes what is currently buffered to fileName on a background thread.
+    // False if the ring is empty or the previous export is still running
+    bool exportTo(const std::string& fileName);
+    bool isExporting()const{
+        return mExporting;
+    }
+    Stats getStats()const;
+private:
+    struct GOP{
+        // Absolute position in the ring (never wraps), the data is at position % mData.size()
+        uint64_t start;
+        std::chrono::steady_clock::time_point time;
+    };
+    // mMutex has to be held
+    // False if size cannot be buffered (pinned by an export, a GOP larger than the ring)
+    bool makeSpace(size_t size,bool newGOP);
+    void beginGOP(const NALU& irap);
+    void append(const uint8_t* data,size_t size);
+    void evictOldestGOP();
+    void clear();
+    void writeExport(std::string fileName,uint64_t start,uint64_t end);
+    const std::chrono::nanoseconds mDuration;
+    std::vector<uint8_t> mData;
+    mutable std::mutex mMutex;
+    // [mGOPs[mOldestGOP].start,mWritePosition) is buffered
+    std::array<GOP,MAX_GOPS> mGOPs{};
+    size_t mOldestGOP=0;
+    size_t mNGOPs=0;
+    uint64_t mWritePosition=0;
+    bool mWaitForIRAP=true;
+    bool mLastWasIRAP=false;
+    // The latest parameter sets, written in front of each IRAP
+    std::vector<uint8_t> mVPS,mSPS,mPPS;
+    // Everything from here on is being written by the export thread
+    std::optional<uint64_t> mPinnedFrom;
+    std::unique_ptr<std::thread> mExportThread;
+    std::atomic<bool> mExporting=false;
+    uint64_t nNALUsDropped=0;
+    std::atomic<uint64_t> nExports{0};
+    std::atomic<uint64_t> nExportErrors{0};
+};
+
+#endif //FPVUE_PREROLLBUFFER_H
@@ -0,0 +1,65 @@
+#include "BlockDecryptor.h"
+#include <algorithm>
+#include <cstring>
+
+BlockDecryptor::BlockDecryptor(const size_t nThreads, DecryptFunction decrypt, Sink sink)
+    : mDecrypt(std::move(decrypt)), mSink(std::move(sink)), mPool(nThreads, "WfbDecrypt"),
+      mFullBatch(std::clamp(mPool.getNThreads(), MIN_PARALLEL_BATCH, MAX_BATCH)), mSlots(mFullBatch) {}
+
+void BlockDecryptor::push(const uint8_t *packet, const size_t size, const RxInfo &info) {
+    if (size > MAX_PACKET_SIZE || !WfbPacket::hasNonce(size) || packet[0] != WfbPacket::TYPE_DATA) {
+        flush();
+        mSink(packet, size, info, false);
+        return;
+    }
+    // (block index << 8) | fragment index
+    const uint64_t block = WfbPacket::nonce(packet) >> 8;
+    if (mBatchSize > 0 && block != mBlock) {
+        flush();
+    }
+    mBlock = block;
+    Slot &slot = mSlots[mBatchSize++];
+    slot.size = size;
+    slot.info = info;
+    memcpy(slot.packet.data(), packet, size);
+    if (mBatchSize == mFullBatch) {
+        flush();
+    }
+}
+
+void BlockDecryptor::flush() {
+    if (mBatchSize == 0) return;
+    if (mBatchSize >= MIN_PARALLEL_BATCH && mPool.getNThreads() > 1) {
+        mPool.run(mBatchSize, [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) decrypt(mSlots[i]);
+        });
+        nParallelBatches++;
+    } else {
+        for (size_t i = 0; i < mBatchSize; i++) decrypt(mSlots[i]);
+    }
+    nBatches++;
+    for (size_t i = 0; i < mBatchSize; i++) {
+        const Slot &slot = mSlots[i];
+        if (!slot.ok) {
+            nAuthFailed++;
+            continue;
+        }
+        nDecrypted++;
+        mSink(slot.plaintext.data(), slot.plaintextSize, slot.info, true);
+    }
+    mBatchSize = 0;
+}
+
+void BlockDecryptor::decrypt(Slot &slot) const {
+    slot.plaintextSize = 0;
+    slot.ok = mDecrypt(slot.packet.data(), slot.size, slot.plaintext.data(), slot.plaintextSize);
+}
+
+BlockDecryptor::Stats BlockDecryptor::getStats() const {
+    Stats ret;
+    ret.nDecrypted = nDecrypted;
+    ret.nAuthFailed = nAuthFailed;
+    ret.nBatches = nBatches;
+    ret.nParallelBatches = nParallelBatches;
+    return ret;
+}
@@ -0,0 +1,78 @@
+#ifndef FPV_VR_BLOCK_DECRYPTOR_H
+#define FPV_VR_BLOCK_DECRYPTOR_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "../videonative/helper/ParallelFor.hpp"
+#include "RxFrame.h"
+
+// Batched decryption stage in front of an aggregator: the data packets of a FEC block are gathered and decrypted
+// together, split across a small pool (ParallelFor, the calling thread included), then handed to the sink one by one
+// in arrival order. The sink (FEC) sees exactly the sequence the per packet path would produce, packets that fail
+// authentication are left out.
+// Anything else (session packets, which change the key) is a barrier: the batch before it is decrypted and delivered
+// first, then it goes to the sink undecrypted, such that decrypt never races with a key change.
+// A batch is decrypted as soon as it has one packet per thread (at least MIN_PARALLEL_BATCH), when the next FEC block
+// starts, or on flush(), so a packet waits for at most that many later ones. Call flush() when the input pauses.
+// Not in the receive path yet: the Aggregator of wfb-ng decrypts and runs FEC in one call (process_packet), so this
+// is only built for the host benchmark until the submodule splits the two.
+// Single threaded like the aggregator: push() and flush() come from one thread, the sink is called on it.
+class BlockDecryptor {
+  public:
+    // Called on the pool threads, has to be thread-safe. Writes the plaintext, false if authentication failed
+    using DecryptFunction = std::function<bool(const uint8_t *packet, size_t size, uint8_t *plaintext, size_t &plaintextSize)>;
+    // decrypted: plaintext of a data packet, otherwise the packet as pushed
+    using Sink = std::function<void(const uint8_t *data, size_t size, const RxInfo &info, bool decrypted)>;
+    // Upper bound of the batch size, however many threads there are
+    static constexpr size_t MAX_BATCH = 32;
+    static constexpr size_t MAX_PACKET_SIZE = 4096;
+    // Smaller batches are decrypted on the calling thread, waking the pool would cost more
+    static constexpr size_t MIN_PARALLEL_BATCH = 4;
+    struct Stats {
+        uint64_t nDecrypted = 0;
+        uint64_t nAuthFailed = 0;
+        uint64_t nBatches = 0;
+        // Decrypted by the pool (the rest on the calling thread)
+        uint64_t nParallelBatches = 0;
+        float getAvgBatchSize() const { return nBatches == 0 ? 0 : (float)(nDecrypted + nAuthFailed) / (float)nBatches; }
+    };
+
+  public:
+    // nThreads includes the calling thread
+    BlockDecryptor(size_t nThreads, DecryptFunction decrypt, Sink sink);
+    BlockDecryptor(const BlockDecryptor &) = delete;
+    // A wfb-ng packet (type, nonce, ...). Larger than MAX_PACKET_SIZE: delivered like a barrier, undecrypted
+    void push(const uint8_t *packet, size_t size, const RxInfo &info);
+    // Decrypts and delivers what is batched
+    void flush();
+    Stats getStats() const;
+
+  private:
+    struct Slot {
+        size_t size;
+        RxInfo info;
+        std::array<uint8_t, MAX_PACKET_SIZE> packet;
+        size_t plaintextSize;
+        std::array<uint8_t, MAX_PACKET_SIZE> plaintext;
+        bool ok;
+    };
+    void decrypt(Slot &slot) const;
+    const DecryptFunction mDecrypt;
+    const Sink mSink;
+    ParallelFor mPool;
+    // Decrypted once that many are batched
+    const size_t mFullBatch;
+    std::vector<Slot> mSlots;
+    size_t mBatchSize = 0;
+    uint64_t mBlock = 0;
+    std::atomic<uint64_t> nDecrypted{0};
+    std::atomic<uint64_t> nAuthFailed{0};
+    std::atomic<uint64_t> nBatches{0};
+    std::atomic<uint64_t> nParallelBatches{0};
+};
+
+#endif // FPV_VR_BLOCK_DECRYPTOR_H
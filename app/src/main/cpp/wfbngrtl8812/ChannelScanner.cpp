@@ -0,0 +1,133 @@
+#include "ChannelScanner.h"
+#include <algorithm>
+#include <climits>
+
+using namespace std::chrono;
+
+ChannelScanner::ChannelScanner(std::vector<uint8_t> channels, RETUNE retune, const uint8_t channel, const Options options)
+    : mChannels(std::move(channels)), mRetune(std::move(retune)), mOptions(options) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.channel = channel;
+    resetCounters(steady_clock::now());
+}
+
+ChannelScanner::~ChannelScanner() { stop(); }
+
+void ChannelScanner::onFrame(const RxInfo &info, const TIME_POINT now) {
+    if (now.time_since_epoch().count() < mCountFrom) return;
+    // The strongest path
+    int8_t rssi = SCHAR_MIN;
+    for (size_t i = 0; i < RxInfo::MAX_ANTENNAS && info.antenna[i] != 0xff; i++) {
+        rssi = std::max(rssi, info.rssi[i]);
+    }
+    mRssiSum += rssi;
+    mNFrames++;
+    mLastFrame = now.time_since_epoch().count();
+}
+
+void ChannelScanner::scan(const TIME_POINT now) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mChannels.empty()) return;
+    mStats.state = State::SCANNING;
+    mStats.nScans++;
+    mScanStart = now;
+    mResults.clear();
+    hop(0, now);
+}
+
+void ChannelScanner::onManualRetune(const uint8_t channel, const TIME_POINT now) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.state = State::LOCKED;
+    mStats.channel = channel;
+    resetCounters(now);
+}
+
+void ChannelScanner::update(const TIME_POINT now) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mStats.state == State::LOCKED) {
+        const TIME_POINT lastFrame{TIME_POINT::duration(mLastFrame.load())};
+        if (now - std::max(lastFrame, mDwellStart) > mOptions.lostTimeout) {
+            lock.unlock();
+            scan(now);
+        }
+        return;
+    }
+    if (now - mDwellStart < mOptions.dwell) {
+        return;
+    }
+    mResults.push_back(currentResult());
+    if (mIndex + 1 < mChannels.size()) {
+        hop(mIndex + 1, now);
+        return;
+    }
+    mStats.lastScan = mResults;
+    std::optional<ChannelResult> best;
+    for (const auto &result : mResults) {
+        if (result.nFrames < mOptions.minFrames) continue;
+        if (!best.has_value() || result.rssiAvg > best->rssiAvg) best = result;
+    }
+    if (best.has_value()) {
+        lockOnto(best->channel, now);
+        mStats.lastTimeToLock = duration_cast<milliseconds>(now - mScanStart);
+        return;
+    }
+    // Nothing found, again. The time to lock counts from the first scan
+    mStats.nEmptyScans++;
+    mStats.nScans++;
+    mResults.clear();
+    hop(0, now);
+}
+
+void ChannelScanner::start() {
+    stop();
+    mStop = false;
+    mThread = std::make_unique<std::thread>([this] {
+        while (!mStop) {
+            update();
+            std::this_thread::sleep_for(milliseconds(10));
+        }
+    });
+}
+
+void ChannelScanner::stop() {
+    mStop = true;
+    if (mThread) {
+        mThread->join();
+        mThread.reset();
+    }
+}
+
+ChannelScanner::Stats ChannelScanner::getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void ChannelScanner::hop(const size_t index, const TIME_POINT now) {
+    mIndex = index;
+    mStats.channel = mChannels[index];
+    mRetune(mChannels[index]);
+    resetCounters(now);
+}
+
+void ChannelScanner::lockOnto(const uint8_t channel, const TIME_POINT now) {
+    mStats.state = State::LOCKED;
+    mStats.channel = channel;
+    mRetune(channel);
+    resetCounters(now);
+}
+
+void ChannelScanner::resetCounters(const TIME_POINT now) {
+    // Before the counters are cleared, such that no frame of the previous channel is counted after
+    mCountFrom = (now + mOptions.settle).time_since_epoch().count();
+    mDwellStart = now;
+    mNFrames = 0;
+    mRssiSum = 0;
+}
+
+ChannelScanner::ChannelResult ChannelScanner::currentResult() const {
+    ChannelResult ret;
+    ret.channel = mChannels[mIndex];
+    ret.nFrames = mNFrames;
+    ret.rssiAvg = ret.nFrames == 0 ? 0 : (float)mRssiSum.load() / (float)ret.nFrames;
+    return ret;
+}
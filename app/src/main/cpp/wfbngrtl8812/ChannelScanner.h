@@ -0,0 +1,90 @@
+#ifndef FPV_VR_CHANNEL_SCANNER_H
+#define FPV_VR_CHANNEL_SCANNER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "RxFrame.h"
+
+// Finds the channel our link is on: dwells on each channel for Options::dwell, counting the frames that were dispatched
+// (valid wfb-ng frames with our link id) and their RSSI, then locks onto the channel with the strongest signal among
+// the ones that had at least Options::minFrames. Once locked the link is monitored, without frames for
+// Options::lostTimeout it scans again.
+// Hopping only retunes the RF channel (RETUNE, usually RadioReceiver::retune()). Frames during Options::settle after a
+// retune are not counted, they may still have been received on the previous channel (USB transfers in flight).
+// onFrame() is called by the receiving thread. update() drives the scan, either by the thread start() creates or,
+// for deterministic tests, by the caller with its own clock.
+class ChannelScanner {
+  public:
+    using TIME_POINT = std::chrono::steady_clock::time_point;
+    using RETUNE = std::function<bool(uint8_t channel)>;
+    struct Options {
+        std::chrono::milliseconds dwell{150};
+        uint32_t minFrames = 3;
+        std::chrono::milliseconds lostTimeout{1000};
+        std::chrono::milliseconds settle{10};
+    };
+    enum class State { SCANNING, LOCKED };
+    struct ChannelResult {
+        uint8_t channel = 0;
+        uint32_t nFrames = 0;
+        float rssiAvg = 0;
+    };
+    struct Stats {
+        State state = State::LOCKED;
+        uint8_t channel = 0;
+        uint64_t nScans = 0;
+        // Scans that did not find the link, the next one starts right away
+        uint64_t nEmptyScans = 0;
+        // From the start of the last scan until it locked
+        std::chrono::milliseconds lastTimeToLock{0};
+        // Of the last completed scan
+        std::vector<ChannelResult> lastScan;
+    };
+
+  public:
+    // Starts locked on channel, a scan begins if there are no frames there
+    ChannelScanner(std::vector<uint8_t> channels, RETUNE retune, uint8_t channel, Options options);
+    ~ChannelScanner();
+    // Receiving thread, for every dispatched frame
+    void onFrame(const RxInfo &info, TIME_POINT now = std::chrono::steady_clock::now());
+    void scan(TIME_POINT now = std::chrono::steady_clock::now());
+    // Someone else tuned to channel (e.g. the user), monitored like a locked channel
+    void onManualRetune(uint8_t channel, TIME_POINT now = std::chrono::steady_clock::now());
+    void update(TIME_POINT now = std::chrono::steady_clock::now());
+    // Calls update() every 10ms on a new thread, until stop()
+    void start();
+    void stop();
+    Stats getStats() const;
+
+  private:
+    // mMutex has to be held
+    void hop(size_t index, TIME_POINT now);
+    void lockOnto(uint8_t channel, TIME_POINT now);
+    void resetCounters(TIME_POINT now);
+    ChannelResult currentResult() const;
+    const std::vector<uint8_t> mChannels;
+    const RETUNE mRetune;
+    const Options mOptions;
+    mutable std::mutex mMutex;
+    Stats mStats;
+    size_t mIndex = 0;
+    TIME_POINT mDwellStart;
+    TIME_POINT mScanStart;
+    std::vector<ChannelResult> mResults;
+    // Written by the receiving thread
+    std::atomic<uint32_t> mNFrames{0};
+    std::atomic<int64_t> mRssiSum{0};
+    std::atomic<TIME_POINT::rep> mLastFrame{0};
+    // End of the settle time of the last retune, earlier frames are ignored
+    std::atomic<TIME_POINT::rep> mCountFrom{0};
+    std::unique_ptr<std::thread> mThread;
+    std::atomic<bool> mStop = false;
+};
+
+#endif // FPV_VR_CHANNEL_SCANNER_H
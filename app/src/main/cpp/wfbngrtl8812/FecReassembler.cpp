@@ -0,0 +1,178 @@
+#include "FecReassembler.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std::chrono;
+
+FecReassembler::FecReassembler(Options options, Sink sink)
+    : mOptions(options), mSink(std::move(sink)), mCode(options.k, options.n), mRing(options.ringSize), mBlocks(options.k),
+      mIndex(options.k), mRecovered(options.k), mMissing(options.k) {
+    for (Block &block : mRing) {
+        block.received.resize(mOptions.n);
+        block.recovered.resize(mOptions.n);
+        block.sizes.resize(mOptions.n);
+        block.arrivals.resize(mOptions.n);
+        block.data.resize(mOptions.n * mOptions.maxFragmentSize);
+    }
+}
+
+void FecReassembler::onFragment(const uint64_t nonce, const uint8_t *data, const size_t size, const TIME_POINT now) {
+    mStats.nFragments++;
+    const uint64_t index = nonce >> 8;
+    const unsigned fragment = nonce & 0xff;
+    if (fragment >= mOptions.n || size == 0 || size > mOptions.maxFragmentSize) {
+        mStats.nInvalid++;
+        return;
+    }
+    if (!mStarted) {
+        mStarted = true;
+        mFront = mEnd = index;
+    }
+    if (index < mFront && mFront - index <= mRing.size()) {
+        mStats.nLate++;
+        return;
+    }
+    if (index < mFront) {
+        // The transmitter restarted: what is open will never be completed
+        mStats.nRestarts++;
+        flush(now);
+        mFront = mEnd = index;
+    }
+    // The ring overflows: wfb-ng's policy, the front is given up however long it waited
+    while (index >= mFront + mRing.size() && mFront < mEnd) {
+        mStats.nOverflowGiveUps++;
+        giveUpFront(now);
+        emitReady(now);
+    }
+    if (index >= mFront + mRing.size()) {
+        mFront = mEnd = index;
+    }
+    while (mEnd <= index) {
+        open(mEnd++, now);
+    }
+    Block &block = slot(index);
+    if (block.received[fragment]) {
+        mStats.nLate++;
+        return;
+    }
+    block.received[fragment] = true;
+    block.sizes[fragment] = size;
+    block.arrivals[fragment] = now;
+    block.maxSize = std::max(block.maxSize, size);
+    block.nReceived++;
+    memcpy(block.data.data() + fragment * mOptions.maxFragmentSize, data, size);
+    update(now);
+}
+
+void FecReassembler::onSessionPacket(const uint8_t *packet, const size_t size, const TIME_POINT now) {
+    if (!mSession.empty() && !std::equal(mSession.begin(), mSession.end(), packet, packet + size)) {
+        mStats.nRestarts++;
+        flush(now);
+        mStarted = false;
+    }
+    mSession.assign(packet, packet + size);
+}
+
+void FecReassembler::update(const TIME_POINT now) {
+    emitReady(now);
+    if (mOptions.maxHoldTime.count() <= 0) return;
+    while (mFront < mEnd && now >= slot(mFront).known + mOptions.maxHoldTime) {
+        mStats.nDeadlineGiveUps++;
+        giveUpFront(now);
+        emitReady(now);
+    }
+}
+
+void FecReassembler::flush(const TIME_POINT now) {
+    emitReady(now);
+    while (mFront < mEnd) {
+        giveUpFront(now);
+        emitReady(now);
+    }
+}
+
+void FecReassembler::open(const uint64_t index, const TIME_POINT now) {
+    Block &block = slot(index);
+    block.index = index;
+    block.known = now;
+    block.nReceived = 0;
+    block.nEmitted = 0;
+    block.maxSize = 0;
+    std::fill(block.received.begin(), block.received.end(), false);
+    std::fill(block.recovered.begin(), block.recovered.end(), false);
+}
+
+void FecReassembler::emitReady(const TIME_POINT now) {
+    while (mFront < mEnd) {
+        Block &block = slot(mFront);
+        if (block.nReceived >= mOptions.k && block.nEmitted < mOptions.k) {
+            recover(block);
+        }
+        while (block.nEmitted < mOptions.k && block.received[block.nEmitted]) {
+            emit(block, block.nEmitted++, now);
+        }
+        if (block.nEmitted < mOptions.k) return;
+        mFront++;
+    }
+}
+
+void FecReassembler::recover(Block &block) {
+    const unsigned k = mOptions.k;
+    size_t nMissing = 0;
+    for (unsigned i = block.nEmitted; i < k; i++) {
+        if (!block.received[i]) mMissing[nMissing++] = i;
+    }
+    if (nMissing == 0) return;
+    // zfec works on blocks of one size: the shorter fragments are zero padded to the largest
+    const size_t size = block.maxSize;
+    const auto fragmentData = [&block, this](const unsigned fragment) {
+        uint8_t *data = block.data.data() + fragment * mOptions.maxFragmentSize;
+        memset(data + block.sizes[fragment], 0, size_t(block.maxSize - block.sizes[fragment]));
+        return data;
+    };
+    // The received data fragments at their own position, the first parity fragments at the missing ones
+    unsigned parity = k;
+    for (unsigned i = 0, missing = 0; i < k; i++) {
+        if (missing < nMissing && mMissing[missing] == i) {
+            while (!block.received[parity]) parity++;
+            mBlocks[i] = fragmentData(parity);
+            mIndex[i] = parity++;
+            mRecovered[missing++] = block.data.data() + i * mOptions.maxFragmentSize;
+        } else {
+            mBlocks[i] = fragmentData(i);
+            mIndex[i] = i;
+        }
+    }
+    if (!mCode.decode(mBlocks.data(), mIndex.data(), mRecovered.data(), size)) return;
+    for (size_t i = 0; i < nMissing; i++) {
+        const unsigned fragment = mMissing[i];
+        block.received[fragment] = true;
+        block.recovered[fragment] = true;
+        block.sizes[fragment] = size;
+    }
+}
+
+void FecReassembler::giveUpFront(const TIME_POINT now) {
+    Block &block = slot(mFront);
+    for (; block.nEmitted < mOptions.k; block.nEmitted++) {
+        if (block.received[block.nEmitted]) {
+            emit(block, block.nEmitted, now);
+        } else {
+            mStats.nLost++;
+        }
+    }
+    mFront++;
+}
+
+void FecReassembler::emit(Block &block, const unsigned fragment, const TIME_POINT now) {
+    microseconds hold{0};
+    if (block.recovered[fragment]) {
+        mStats.nRecovered++;
+    } else {
+        hold = duration_cast<microseconds>(now - block.arrivals[fragment]);
+        mStats.totalHold += hold;
+        mStats.maxHold = std::max(mStats.maxHold, hold);
+    }
+    mStats.nEmitted++;
+    mSink(block.index, fragment, block.data.data() + fragment * mOptions.maxFragmentSize, block.sizes[fragment], hold);
+}
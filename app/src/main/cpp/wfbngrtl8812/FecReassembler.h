@@ -0,0 +1,115 @@
+#ifndef FPV_VR_FEC_REASSEMBLER_H
+#define FPV_VR_FEC_REASSEMBLER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "ReedSolomon.h"
+
+// The FEC half of wfb-ng's Aggregator with a bounded hold time: fragments (block index << 8 | fragment index, as in
+// the nonce) go into a ring of Options::ringSize blocks and the data fragments are emitted in order the moment they
+// are available - received, or recovered once a block has k fragments.
+// A block that cannot be completed holds everything behind it. Without a hold limit (wfb-ng's behaviour) it is only
+// given up when the ring overflows, so one lossy block delays the later (maybe complete) ones by up to ringSize blocks.
+// With Options::maxHoldTime the front block is given up once it waited that long, even if later blocks are complete:
+// its received data fragments are emitted, the missing ones are lost.
+// A block is known since its first fragment arrived, or since a later block did (if none of it arrived).
+// A transmitter restart (the block index starts over at 0) is detected from its session packet, which differs from the
+// one it announced before (new session key): what is open is given up and the next fragment starts over. Without
+// session packets only a jump over more than ringSize blocks (forward or back) is taken as one, fragments of at most
+// ringSize blocks before the front are late.
+// Not in the receive path yet: the Aggregator of wfb-ng does FEC itself (process_packet), so this is only built for
+// the host benchmark until the submodule hands the decrypted fragments out.
+// Like wfb-ng, a recovered fragment has the size of the largest fragment of its block (zero padded).
+// Single threaded like the aggregator. update() applies the deadline without new fragments, call it periodically (or
+// with the capture time when replaying).
+class FecReassembler {
+  public:
+    using TIME_POINT = std::chrono::steady_clock::time_point;
+    // A data fragment in order. hold: since it arrived, 0 for recovered ones
+    using Sink = std::function<void(uint64_t block, unsigned fragment, const uint8_t *data, size_t size,
+                                    std::chrono::microseconds hold)>;
+    struct Options {
+        unsigned k = 8;
+        unsigned n = 12;
+        // 0: no limit, blocks are only given up when the ring overflows
+        std::chrono::microseconds maxHoldTime{0};
+        size_t ringSize = 40;
+        size_t maxFragmentSize = 4096;
+    };
+    struct Stats {
+        uint64_t nFragments = 0;
+        // Fragment index >= n, empty or larger than maxFragmentSize
+        uint64_t nInvalid = 0;
+        // Of blocks that were already emitted or given up (the remaining parity of a complete block), and duplicates
+        uint64_t nLate = 0;
+        uint64_t nEmitted = 0;
+        uint64_t nRecovered = 0;
+        // Data fragments of given up blocks that never arrived
+        uint64_t nLost = 0;
+        // Blocks given up because of maxHoldTime / because the ring overflowed
+        uint64_t nDeadlineGiveUps = 0;
+        uint64_t nOverflowGiveUps = 0;
+        // New session packets, and jumps back by more than ringSize blocks
+        uint64_t nRestarts = 0;
+        // Of the received data fragments that were emitted
+        std::chrono::microseconds totalHold{0};
+        std::chrono::microseconds maxHold{0};
+    };
+
+  public:
+    FecReassembler(Options options, Sink sink);
+    // Fragment of a wfb-ng data packet, size <= Options::maxFragmentSize
+    void onFragment(uint64_t nonce, const uint8_t *data, size_t size, TIME_POINT now);
+    // A session packet of the stream as received (still encrypted). The transmitter repeats the same one until it
+    // restarts with a new session key
+    void onSessionPacket(const uint8_t *packet, size_t size, TIME_POINT now);
+    // Gives up the blocks whose deadline passed
+    void update(TIME_POINT now);
+    // Emits what is left, giving up incomplete blocks (end of a replay)
+    void flush(TIME_POINT now);
+    Stats getStats() const { return mStats; }
+
+  private:
+    struct Block {
+        uint64_t index = 0;
+        TIME_POINT known;
+        unsigned nReceived = 0;
+        // Data fragments emitted so far
+        unsigned nEmitted = 0;
+        size_t maxSize = 0;
+        // Recovered data fragments count as received
+        std::vector<bool> received;
+        std::vector<bool> recovered;
+        std::vector<size_t> sizes;
+        std::vector<TIME_POINT> arrivals;
+        std::vector<uint8_t> data;
+    };
+    Block &slot(uint64_t block) { return mRing[block % mRing.size()]; }
+    void open(uint64_t block, TIME_POINT now);
+    // Emits the front blocks as far as possible, advances over the finished ones
+    void emitReady(TIME_POINT now);
+    void recover(Block &block);
+    // Emits the received data fragments of the front block, the missing ones are lost
+    void giveUpFront(TIME_POINT now);
+    void emit(Block &block, unsigned fragment, TIME_POINT now);
+    const Options mOptions;
+    const Sink mSink;
+    const ReedSolomon mCode;
+    std::vector<Block> mRing;
+    bool mStarted = false;
+    // The last session packet
+    std::vector<uint8_t> mSession;
+    // Oldest block that is not finished, the blocks [mFront, mEnd) are open
+    uint64_t mFront = 0;
+    uint64_t mEnd = 0;
+    Stats mStats;
+    // For recover(), allocated once
+    std::vector<const uint8_t *> mBlocks;
+    std::vector<unsigned> mIndex;
+    std::vector<uint8_t *> mRecovered;
+    std::vector<unsigned> mMissing;
+};
+
+#endif // FPV_VR_FEC_REASSEMBLER_H
@@ -0,0 +1,51 @@
+#ifndef FPV_VR_FRAME_DEDUPLICATOR_H
+#define FPV_VR_FRAME_DEDUPLICATOR_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include "RxFrame.h"
+
+// With several adapters most frames are received more than once. Only the first copy has to be decrypted and go
+// through FEC: a frame is a duplicate if its (radio port, packet type, nonce) was seen within WINDOW.
+// Direct mapped table, one lookup per frame and nothing allocated. A collision evicts the older entry, which at worst
+// lets a duplicate through (the aggregator ignores fragments it already has) but never drops a new frame. WINDOW
+// bounds the time an entry counts, such that a restarted transmitter (its nonces begin anew) is not dropped.
+class FrameDeduplicator {
+  public:
+    // Larger than the frames received within WINDOW at full rate
+    static constexpr size_t TABLE_SIZE = 4096;
+    // Much longer than the adapters' skew, much shorter than a transmitter restart
+    static constexpr std::chrono::milliseconds WINDOW{100};
+
+  public:
+    // Not thread safe. Frames without a nonce are never duplicates
+    bool isDuplicate(const uint8_t radioPort, const uint8_t *payload, const size_t payloadSize,
+                     const std::chrono::steady_clock::time_point now) {
+        if (!WfbPacket::hasNonce(payloadSize)) return false;
+        const uint64_t nonce = WfbPacket::nonce(payload);
+        const uint16_t stream = uint16_t((radioPort << 8) | payload[0]);
+        const uint64_t hash = (nonce ^ (uint64_t(stream) << 48)) * 0x9E3779B97F4A7C15ull;
+        Entry &entry = mEntries[hash >> (64 - TABLE_BITS)];
+        const int64_t time = now.time_since_epoch().count();
+        if (entry.valid && entry.nonce == nonce && entry.stream == stream && time - entry.time <= WINDOW_TICKS) {
+            return true;
+        }
+        entry = Entry{nonce, time, stream, true};
+        return false;
+    }
+
+  private:
+    static constexpr int TABLE_BITS = 12;
+    static_assert(TABLE_SIZE == 1u << TABLE_BITS);
+    static constexpr int64_t WINDOW_TICKS = std::chrono::duration_cast<std::chrono::steady_clock::duration>(WINDOW).count();
+    struct Entry {
+        uint64_t nonce = 0;
+        int64_t time = 0;
+        uint16_t stream = 0;
+        bool valid = false;
+    };
+    std::array<Entry, TABLE_SIZE> mEntries{};
+};
+
+#endif // FPV_VR_FRAME_DEDUPLICATOR_H
@@ -0,0 +1,195 @@
+#include "GaloisField.h"
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define FPV_VR_GF_NEON
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FPV_VR_GF_X86
+#endif
+
+namespace {
+    // x^8 + x^4 + x^3 + x^2 + 1, zfec's "101110001"
+    constexpr unsigned POLYNOMIAL = 0x11d;
+
+    struct Tables {
+        uint8_t exp[2 * 255];
+        uint8_t log[256];
+        uint8_t inverse[256];
+        uint8_t mul[256][256];
+        // c * x and c * (x << 4) for the nibbles x of the source bytes
+        alignas(32) uint8_t low[256][16];
+        alignas(32) uint8_t high[256][16];
+
+        Tables() {
+            unsigned x = 1;
+            for (unsigned i = 0; i < 255; i++) {
+                exp[i] = exp[i + 255] = (uint8_t)x;
+                log[x] = (uint8_t)i;
+                x <<= 1;
+                if (x & 0x100) x ^= POLYNOMIAL;
+            }
+            log[0] = 0;
+            for (unsigned a = 0; a < 256; a++) {
+                for (unsigned b = 0; b < 256; b++) {
+                    mul[a][b] = (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+                }
+                inverse[a] = a == 0 ? 0 : exp[255 - log[a]];
+            }
+            for (unsigned c = 0; c < 256; c++) {
+                for (unsigned i = 0; i < 16; i++) {
+                    low[c][i] = mul[c][i];
+                    high[c][i] = mul[c][i << 4];
+                }
+            }
+        }
+    };
+
+    const Tables &tables() {
+        static const Tables ret;
+        return ret;
+    }
+
+    void mulAddScalar(uint8_t *dst, const uint8_t *src, const uint8_t c, const size_t size) {
+        if (c == 0) return;
+        const uint8_t *row = tables().mul[c];
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            dst[i] ^= row[src[i]];
+            dst[i + 1] ^= row[src[i + 1]];
+            dst[i + 2] ^= row[src[i + 2]];
+            dst[i + 3] ^= row[src[i + 3]];
+            dst[i + 4] ^= row[src[i + 4]];
+            dst[i + 5] ^= row[src[i + 5]];
+            dst[i + 6] ^= row[src[i + 6]];
+            dst[i + 7] ^= row[src[i + 7]];
+        }
+        for (; i < size; i++) {
+            dst[i] ^= row[src[i]];
+        }
+    }
+
+#ifdef FPV_VR_GF_X86
+    __attribute__((target("ssse3"))) void mulAddSSSE3(uint8_t *dst, const uint8_t *src, const uint8_t c, const size_t size) {
+        if (c == 0) return;
+        const Tables &t = tables();
+        const __m128i low = _mm_load_si128((const __m128i *)t.low[c]);
+        const __m128i high = _mm_load_si128((const __m128i *)t.high[c]);
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            const __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            const __m128i product = _mm_xor_si128(_mm_shuffle_epi8(low, _mm_and_si128(s, mask)),
+                                                  _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(dst + i)), product));
+        }
+        mulAddScalar(dst + i, src + i, c, size - i);
+    }
+
+    __attribute__((target("avx2"))) void mulAddAVX2(uint8_t *dst, const uint8_t *src, const uint8_t c, const size_t size) {
+        if (c == 0) return;
+        const Tables &t = tables();
+        const __m256i low = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)t.low[c]));
+        const __m256i high = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)t.high[c]));
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            const __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+            const __m256i product = _mm256_xor_si256(_mm256_shuffle_epi8(low, _mm256_and_si256(s, mask)),
+                                                     _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+            _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(dst + i)), product));
+        }
+        mulAddSSSE3(dst + i, src + i, c, size - i);
+    }
+#endif
+
+#ifdef FPV_VR_GF_NEON
+    void mulAddNEON(uint8_t *dst, const uint8_t *src, const uint8_t c, const size_t size) {
+        if (c == 0) return;
+        const Tables &t = tables();
+        const uint8x16_t low = vld1q_u8(t.low[c]);
+        const uint8x16_t high = vld1q_u8(t.high[c]);
+        const uint8x16_t mask = vdupq_n_u8(0x0f);
+        size_t i = 0;
+        // Two vectors per iteration, the table lookups of both are independent
+        for (; i + 32 <= size; i += 32) {
+            const uint8x16_t s0 = vld1q_u8(src + i);
+            const uint8x16_t s1 = vld1q_u8(src + i + 16);
+            const uint8x16_t p0 = veorq_u8(vqtbl1q_u8(low, vandq_u8(s0, mask)), vqtbl1q_u8(high, vshrq_n_u8(s0, 4)));
+            const uint8x16_t p1 = veorq_u8(vqtbl1q_u8(low, vandq_u8(s1, mask)), vqtbl1q_u8(high, vshrq_n_u8(s1, 4)));
+            vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), p0));
+            vst1q_u8(dst + i + 16, veorq_u8(vld1q_u8(dst + i + 16), p1));
+        }
+        for (; i + 16 <= size; i += 16) {
+            const uint8x16_t s = vld1q_u8(src + i);
+            const uint8x16_t p = veorq_u8(vqtbl1q_u8(low, vandq_u8(s, mask)), vqtbl1q_u8(high, vshrq_n_u8(s, 4)));
+            vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), p));
+        }
+        mulAddScalar(dst + i, src + i, c, size - i);
+    }
+#endif
+} // namespace
+
+namespace GaloisField {
+uint8_t mul(const uint8_t a, const uint8_t b) { return tables().mul[a][b]; }
+
+uint8_t exp(const unsigned e) { return tables().exp[e % 255]; }
+
+uint8_t inverse(const uint8_t a) { return tables().inverse[a]; }
+
+Path resolve(const Path path) {
+    if (path != Path::AUTO) return path;
+#if defined(FPV_VR_GF_NEON)
+    return Path::NEON;
+#elif defined(FPV_VR_GF_X86)
+    if (isSupported(Path::AVX2)) return Path::AVX2;
+    return isSupported(Path::SSSE3) ? Path::SSSE3 : Path::SCALAR;
+#else
+    return Path::SCALAR;
+#endif
+}
+
+bool isSupported(const Path path) {
+    switch (path) {
+    case Path::AUTO:
+    case Path::SCALAR:
+        return true;
+#ifdef FPV_VR_GF_X86
+    case Path::SSSE3:
+        return __builtin_cpu_supports("ssse3");
+    case Path::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef FPV_VR_GF_NEON
+    case Path::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const char *pathName(const Path path) {
+    static constexpr const char *NAMES[] = {"auto", "scalar", "ssse3", "avx2", "neon"};
+    return NAMES[(int)path];
+}
+
+MulAddFunction mulAddFunction(Path path) {
+    path = resolve(path);
+    if (!isSupported(path)) return mulAddScalar;
+    switch (path) {
+#ifdef FPV_VR_GF_X86
+    case Path::SSSE3:
+        return mulAddSSSE3;
+    case Path::AVX2:
+        return mulAddAVX2;
+#endif
+#ifdef FPV_VR_GF_NEON
+    case Path::NEON:
+        return mulAddNEON;
+#endif
+    default:
+        return mulAddScalar;
+    }
+}
+} // namespace GaloisField
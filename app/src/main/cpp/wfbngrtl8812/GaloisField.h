@@ -0,0 +1,29 @@
+#ifndef FPV_VR_GALOIS_FIELD_H
+#define FPV_VR_GALOIS_FIELD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// GF(2^8) with the field polynomial of wfb-ng's FEC (zfec: x^8 + x^4 + x^3 + x^2 + 1) and the region kernel all of
+// Reed-Solomon encoding / decoding consists of: dst ^= c * src over a whole fragment.
+// The scalar kernel looks every byte up in the 64KB multiplication table, like zfec. The SIMD kernels split each source
+// byte into its nibbles and look both up in the 16 entry tables of c with a byte shuffle (pshufb / tbl), 16 or 32
+// bytes at a time. All paths produce bit-identical output.
+namespace GaloisField {
+enum class Path { AUTO, SCALAR, SSSE3, AVX2, NEON };
+using MulAddFunction = void (*)(uint8_t *dst, const uint8_t *src, uint8_t c, size_t size);
+
+uint8_t mul(uint8_t a, uint8_t b);
+// The generator (2) to the power e
+uint8_t exp(unsigned e);
+// a != 0
+uint8_t inverse(uint8_t a);
+// AUTO: the fastest path of this CPU
+Path resolve(Path path);
+bool isSupported(Path path);
+const char *pathName(Path path);
+// dst[i] ^= c * src[i], the kernel of path (scalar if not supported)
+MulAddFunction mulAddFunction(Path path);
+} // namespace GaloisField
+
+#endif // FPV_VR_GALOIS_FIELD_H
@@ -0,0 +1,114 @@
+#ifndef FPV_VR_MOCK_RADIO_DEVICE_H
+#define FPV_VR_MOCK_RADIO_DEVICE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "RadioDevice.h"
+
+// Scripted RadioDevice for the host: each transmitter sends one wfb-ng frame per framePeriod on its channel, only the
+// ones on the tuned channel are received (with the transmitter's RSSI). Reprogramming the channel takes programLatency,
+// nothing is received meanwhile. Transmitters can change channel at any time, like a drone that was re-configured.
+// The frames are wfb-ng data packets with increasing nonces, followed by the channel they were sent on.
+class MockRadioDevice : public RadioDevice {
+  public:
+    struct Transmitter {
+        uint32_t linkId;
+        uint8_t radioPort;
+        uint8_t channel;
+        int8_t rssi = -50;
+    };
+    // Of the channel in the payload
+    static constexpr size_t CHANNEL_OFFSET = WfbPacket::NONCE + WfbPacket::NONCE_SIZE;
+    struct Options {
+        std::vector<Transmitter> transmitters;
+        std::chrono::microseconds framePeriod{200};
+        std::chrono::microseconds programLatency{2000};
+        size_t payloadSize = 1024;
+    };
+
+  public:
+    explicit MockRadioDevice(Options options)
+        : mOptions(std::move(options)), mTransmitterChannels(new std::atomic<uint8_t>[mOptions.transmitters.size()]) {
+        for (size_t i = 0; i < mOptions.transmitters.size(); i++) {
+            mTransmitterChannels[i] = mOptions.transmitters[i].channel;
+        }
+    }
+
+    void receive(FrameCallback callback, const uint8_t channel) override {
+        nReceiveCalls++;
+        mChannel = channel;
+        mStop = false;
+        std::vector<std::vector<uint8_t>> frames;
+        for (const auto &transmitter : mOptions.transmitters) {
+            frames.push_back(createFrame(transmitter.linkId, transmitter.radioPort, mOptions.payloadSize));
+        }
+        std::vector<uint64_t> nonces(frames.size(), 0);
+        RxInfo info;
+        info.antenna[0] = 0;
+        info.noise[0] = -90;
+        while (!mStop) {
+            std::this_thread::sleep_for(mOptions.framePeriod);
+            if (mProgramming) continue;
+            const uint8_t tuned = mChannel;
+            for (size_t i = 0; i < frames.size(); i++) {
+                if (mTransmitterChannels[i] == tuned) {
+                    setNonce(frames[i], nonces[i]++);
+                    frames[i][WfbHeader::SIZE + CHANNEL_OFFSET] = tuned;
+                    info.rssi[0] = mOptions.transmitters[i].rssi;
+                    callback(frames[i], info);
+                }
+            }
+        }
+    }
+
+    bool setChannel(const uint8_t channel) override {
+        mProgramming = true;
+        std::this_thread::sleep_for(mOptions.programLatency);
+        mChannel = channel;
+        mProgramming = false;
+        return true;
+    }
+
+    void stop() override { mStop = true; }
+
+    void moveTransmitter(const size_t index, const uint8_t channel) { mTransmitterChannels[index] = channel; }
+
+    // A whole frame (802.11 header, payload, FCS) as a wfb-ng transmitter sends it, a data packet with nonce 0
+    static std::vector<uint8_t> createFrame(const uint32_t linkId, const uint8_t radioPort, const size_t payloadSize) {
+        std::vector<uint8_t> frame(WfbHeader::SIZE + std::max(payloadSize, CHANNEL_OFFSET + 1) + WfbHeader::FCS_SIZE, 0xAA);
+        frame[0] = 0x08;
+        frame[1] = 0x01;
+        const uint32_t channelId = WfbHeader::channelId(linkId, radioPort);
+        for (const size_t offset : {WfbHeader::SRC_MAC, WfbHeader::DST_MAC}) {
+            frame[offset] = WfbHeader::MAGIC[0];
+            frame[offset + 1] = WfbHeader::MAGIC[1];
+            for (int i = 0; i < 4; i++) {
+                frame[offset + 2 + i] = uint8_t(channelId >> (24 - 8 * i));
+            }
+        }
+        frame[WfbHeader::SIZE] = WfbPacket::TYPE_DATA;
+        setNonce(frame, 0);
+        return frame;
+    }
+    static void setNonce(std::vector<uint8_t> &frame, const uint64_t nonce) {
+        for (size_t i = 0; i < WfbPacket::NONCE_SIZE; i++) {
+            frame[WfbHeader::SIZE + WfbPacket::NONCE + i] = uint8_t(nonce >> (56 - 8 * i));
+        }
+    }
+
+    // Stays 1 if the link only ever retunes
+    std::atomic<int> nReceiveCalls{0};
+
+  private:
+    const Options mOptions;
+    std::unique_ptr<std::atomic<uint8_t>[]> mTransmitterChannels;
+    std::atomic<uint8_t> mChannel{0};
+    std::atomic<bool> mProgramming = false;
+    std::atomic<bool> mStop = false;
+};
+
+#endif // FPV_VR_MOCK_RADIO_DEVICE_H
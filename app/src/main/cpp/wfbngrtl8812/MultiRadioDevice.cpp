@@ -0,0 +1,53 @@
+#include "MultiRadioDevice.h"
+#include <algorithm>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+MultiRadioDevice::MultiRadioDevice(std::vector<std::unique_ptr<RadioDevice>> devices) : mDevices(std::move(devices)) {}
+
+void MultiRadioDevice::receive(FrameCallback callback, const uint8_t channel) {
+    if (mDevices.empty()) return;
+    const size_t nAdapters = std::min(mDevices.size(), MAX_ADAPTERS);
+    const uint8_t antennasPerAdapter = static_cast<uint8_t>(RxInfo::MAX_ANTENNAS / nAdapters);
+    auto receiveAdapter = [&](const size_t adapter) {
+        mDevices[adapter]->receive(
+            [&, adapter](std::span<uint8_t> frame, const RxInfo &deviceInfo) {
+                RxInfo info = deviceInfo;
+                info.adapter = static_cast<uint8_t>(adapter);
+                for (size_t i = 0; i < RxInfo::MAX_ANTENNAS; i++) {
+                    if (i >= antennasPerAdapter || info.antenna[i] >= antennasPerAdapter) {
+                        info.antenna[i] = 0xff;
+                        continue;
+                    }
+                    info.antenna[i] = static_cast<uint8_t>(adapter * antennasPerAdapter + info.antenna[i]);
+                }
+                std::lock_guard<std::mutex> lock(mCallbackMutex);
+                callback(frame, info);
+            },
+            channel);
+    };
+    std::vector<std::thread> threads;
+    for (size_t adapter = 1; adapter < nAdapters; adapter++) {
+        threads.emplace_back(receiveAdapter, adapter);
+        pthread_setname_np(threads.back().native_handle(), ("WfbRxAdapter" + std::to_string(adapter)).c_str());
+    }
+    receiveAdapter(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+bool MultiRadioDevice::setChannel(const uint8_t channel) {
+    bool ok = true;
+    for (const auto &device : mDevices) {
+        ok = device->setChannel(channel) && ok;
+    }
+    return ok;
+}
+
+void MultiRadioDevice::stop() {
+    for (const auto &device : mDevices) {
+        device->stop();
+    }
+}
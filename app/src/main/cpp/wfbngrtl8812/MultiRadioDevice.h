@@ -0,0 +1,32 @@
+#ifndef FPV_VR_MULTI_RADIO_DEVICE_H
+#define FPV_VR_MULTI_RADIO_DEVICE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "RadioDevice.h"
+
+// Several adapters (different antennas / polarisations) received as one: every adapter runs its own receive loop,
+// their frames are merged into the one callback with RxInfo::adapter set. The callback is never called concurrently.
+// The antennas are renumbered such that they stay distinct: adapter n gets antenna indices
+// n * (RxInfo::MAX_ANTENNAS / nAdapters) onwards, paths beyond that are not reported.
+class MultiRadioDevice : public RadioDevice {
+  public:
+    static constexpr size_t MAX_ADAPTERS = RxInfo::MAX_ADAPTERS;
+
+  public:
+    explicit MultiRadioDevice(std::vector<std::unique_ptr<RadioDevice>> devices);
+    // The first adapter receives on the calling thread, each other one on its own. Returns once all of them did, an
+    // adapter that fails (unplugged) does not take the others down
+    void receive(FrameCallback callback, uint8_t channel) override;
+    // All adapters. False if any failed
+    bool setChannel(uint8_t channel) override;
+    void stop() override;
+    size_t getNumAdapters() const { return mDevices.size(); }
+
+  private:
+    const std::vector<std::unique_ptr<RadioDevice>> mDevices;
+    std::mutex mCallbackMutex;
+};
+
+#endif // FPV_VR_MULTI_RADIO_DEVICE_H
@@ -0,0 +1,151 @@
+#include "PcapFile.h"
+#include <cstring>
+
+namespace {
+    constexpr uint32_t MAGIC_MICROSECONDS = 0xa1b2c3d4;
+    constexpr uint32_t MAGIC_NANOSECONDS = 0xa1b23c4d;
+    // Larger packets / blocks mean the file is corrupt
+    constexpr uint32_t MAX_PACKET_SIZE = 256 * 1024;
+
+    uint32_t swap32(const uint32_t value) { return __builtin_bswap32(value); }
+} // namespace
+
+PcapReader::~PcapReader() {
+    if (mFile) {
+        fclose(mFile);
+    }
+}
+
+bool PcapReader::open(const std::string &path) {
+    if (mFile) {
+        fclose(mFile);
+    }
+    mFile = fopen(path.c_str(), "rb");
+    if (!mFile) return false;
+    uint32_t magic;
+    if (!read(&magic, sizeof(magic))) return false;
+    mPcapng = magic == Pcapng::SECTION_HEADER_BLOCK;
+    return mPcapng ? openPcapng() : openPcap(magic);
+}
+
+bool PcapReader::next(Packet &packet) {
+    if (!mFile) return false;
+    if (mPcapng) return nextPcapng(packet);
+    // seconds, micro- / nanoseconds, captured length, original length
+    uint32_t header[4];
+    if (!read(header, sizeof(header))) return false;
+    const uint32_t size = toHost(header[2]);
+    if (size > MAX_PACKET_SIZE) return false;
+    packet.timestampUs = int64_t(toHost(header[0])) * 1000000 + (mNanoseconds ? toHost(header[1]) / 1000 : toHost(header[1]));
+    packet.interfaceId = 0;
+    packet.data.resize(size);
+    return read(packet.data.data(), size);
+}
+
+bool PcapReader::openPcap(const uint32_t magic) {
+    if (magic == MAGIC_MICROSECONDS || magic == MAGIC_NANOSECONDS) {
+        mSwapped = false;
+    } else if (swap32(magic) == MAGIC_MICROSECONDS || swap32(magic) == MAGIC_NANOSECONDS) {
+        mSwapped = true;
+    } else {
+        return false;
+    }
+    mNanoseconds = toHost(magic) == MAGIC_NANOSECONDS;
+    // version major / minor, reserved, reserved, snaplen, link type
+    uint32_t header[5];
+    if (!read(header, sizeof(header))) return false;
+    mLinkType = toHost(header[4]) & 0xffff;
+    return true;
+}
+
+bool PcapReader::openPcapng() {
+    // Section header block: total length, byte order magic, then version, section length and options are skipped
+    uint32_t header[2];
+    if (!read(header, sizeof(header))) return false;
+    if (header[1] == Pcapng::BYTE_ORDER_MAGIC) {
+        mSwapped = false;
+    } else if (swap32(header[1]) == Pcapng::BYTE_ORDER_MAGIC) {
+        mSwapped = true;
+    } else {
+        return false;
+    }
+    const uint32_t length = toHost(header[0]);
+    if (length < Pcapng::BLOCK_OVERHEAD + 4 || length > MAX_PACKET_SIZE) return false;
+    mBlock.resize(length - Pcapng::BLOCK_OVERHEAD);
+    if (!read(mBlock.data(), mBlock.size())) return false;
+    // The link type is the one of the first interface
+    mTimestampResolutions.clear();
+    uint32_t type;
+    while (mTimestampResolutions.empty()) {
+        if (!readPcapngBlock(type)) return false;
+        if (type == Pcapng::INTERFACE_DESCRIPTION_BLOCK) addPcapngInterface();
+    }
+    return true;
+}
+
+bool PcapReader::readPcapngBlock(uint32_t &type) {
+    uint32_t header[2];
+    if (!read(header, sizeof(header))) return false;
+    type = toHost(header[0]);
+    const uint32_t length = toHost(header[1]);
+    if (length < Pcapng::BLOCK_OVERHEAD || length > MAX_PACKET_SIZE || length % 4 != 0) return false;
+    // Body and the trailing length
+    mBlock.resize(length - Pcapng::BLOCK_OVERHEAD + 4);
+    if (!read(mBlock.data(), mBlock.size())) return false;
+    mBlock.resize(mBlock.size() - 4);
+    return true;
+}
+
+void PcapReader::addPcapngInterface() {
+    // link type, reserved, snaplen, options
+    if (mBlock.size() < 8) return;
+    uint16_t linkType;
+    memcpy(&linkType, mBlock.data(), sizeof(linkType));
+    if (mTimestampResolutions.empty()) mLinkType = toHost16(linkType);
+    uint64_t resolution = 1000000;
+    size_t offset = 8;
+    while (offset + 4 <= mBlock.size()) {
+        uint16_t option[2];
+        memcpy(option, mBlock.data() + offset, sizeof(option));
+        const uint16_t code = toHost16(option[0]);
+        const uint16_t length = toHost16(option[1]);
+        offset += 4;
+        if (code == Pcapng::OPT_ENDOFOPT || offset + length > mBlock.size()) break;
+        if (code == Pcapng::IF_TSRESOL && length >= 1) {
+            const uint8_t value = mBlock[offset];
+            // Most significant bit: power of 2, otherwise of 10
+            resolution = 1;
+            for (int i = 0; i < (value & 0x7f); i++) resolution *= (value & 0x80) ? 2 : 10;
+        }
+        offset += Pcapng::pad4(length);
+    }
+    mTimestampResolutions.push_back(resolution);
+}
+
+bool PcapReader::nextPcapng(Packet &packet) {
+    uint32_t type;
+    while (readPcapngBlock(type)) {
+        if (type == Pcapng::INTERFACE_DESCRIPTION_BLOCK) {
+            addPcapngInterface();
+            continue;
+        }
+        if (type != Pcapng::ENHANCED_PACKET_BLOCK || mBlock.size() < Pcapng::ENHANCED_PACKET_HEADER) continue;
+        uint32_t header[5];
+        memcpy(header, mBlock.data(), sizeof(header));
+        packet.interfaceId = toHost(header[0]);
+        const uint32_t size = toHost(header[3]);
+        if (packet.interfaceId >= mTimestampResolutions.size() || Pcapng::ENHANCED_PACKET_HEADER + size > mBlock.size()) return false;
+        const uint64_t timestamp = (uint64_t(toHost(header[1])) << 32) | toHost(header[2]);
+        const uint64_t resolution = mTimestampResolutions[packet.interfaceId];
+        packet.timestampUs = (int64_t)(timestamp / resolution * 1000000 + timestamp % resolution * 1000000 / resolution);
+        packet.data.assign(mBlock.begin() + Pcapng::ENHANCED_PACKET_HEADER, mBlock.begin() + Pcapng::ENHANCED_PACKET_HEADER + size);
+        return true;
+    }
+    return false;
+}
+
+bool PcapReader::read(void *dst, const size_t size) { return fread(dst, 1, size, mFile) == size; }
+
+uint32_t PcapReader::toHost(const uint32_t value) const { return mSwapped ? swap32(value) : value; }
+
+uint16_t PcapReader::toHost16(const uint16_t value) const { return mSwapped ? __builtin_bswap16(value) : value; }
@@ -0,0 +1,72 @@
+#ifndef FPV_VR_PCAP_FILE_H
+#define FPV_VR_PCAP_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// pcapng (https://www.ietf.org/archive/id/draft-ietf-opsawg-pcapng-02.html), the blocks PcapngRecorder writes
+namespace Pcapng {
+constexpr uint32_t SECTION_HEADER_BLOCK = 0x0A0D0D0A;
+constexpr uint32_t INTERFACE_DESCRIPTION_BLOCK = 1;
+constexpr uint32_t ENHANCED_PACKET_BLOCK = 6;
+constexpr uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr uint16_t OPT_ENDOFOPT = 0;
+constexpr uint16_t IF_NAME = 2;
+constexpr uint16_t IF_TSRESOL = 9;
+// Block type, total length ... total length
+constexpr size_t BLOCK_OVERHEAD = 12;
+// Interface id, timestamp high / low, captured / original length
+constexpr size_t ENHANCED_PACKET_HEADER = 20;
+
+constexpr size_t pad4(const size_t size) { return (size + 3) & ~size_t(3); }
+} // namespace Pcapng
+
+// Sequential reader of pcap (https://www.tcpdump.org/manpages/pcap-savefile.5.html, either byte order, micro- or
+// nanosecond timestamps) and pcapng captures (the enhanced packet blocks of all interfaces, which are expected to have
+// the link type of the first one). Written for the link types of monitor mode captures, the data is not interpreted.
+// libpcap itself is only available for Android (libs/), this also runs on the host.
+class PcapReader {
+  public:
+    static constexpr uint32_t LINKTYPE_IEEE802_11 = 105;
+    static constexpr uint32_t LINKTYPE_IEEE802_11_RADIOTAP = 127;
+    struct Packet {
+        // Capture time since the epoch
+        int64_t timestampUs = 0;
+        // pcapng interface, 0 for pcap
+        uint32_t interfaceId = 0;
+        std::vector<uint8_t> data;
+    };
+
+  public:
+    PcapReader() = default;
+    ~PcapReader();
+    PcapReader(const PcapReader &) = delete;
+    // False if path cannot be opened or is neither a pcap nor a pcapng file
+    bool open(const std::string &path);
+    // False at the end of the file (or a truncated packet). packet.data is reused
+    bool next(Packet &packet);
+    uint32_t getLinkType() const { return mLinkType; }
+
+  private:
+    bool openPcap(uint32_t magic);
+    bool openPcapng();
+    // The next block into mBlock (without type and lengths)
+    bool readPcapngBlock(uint32_t &type);
+    void addPcapngInterface();
+    bool nextPcapng(Packet &packet);
+    bool read(void *dst, size_t size);
+    uint32_t toHost(uint32_t value) const;
+    uint16_t toHost16(uint16_t value) const;
+    FILE *mFile = nullptr;
+    uint32_t mLinkType = 0;
+    bool mSwapped = false;
+    bool mNanoseconds = false;
+    bool mPcapng = false;
+    // pcapng: timestamp units per second of each interface
+    std::vector<uint64_t> mTimestampResolutions;
+    std::vector<uint8_t> mBlock;
+};
+
+#endif // FPV_VR_PCAP_FILE_H
@@ -0,0 +1,87 @@
+#include "PcapRadioDevice.h"
+#include <algorithm>
+#include <thread>
+#include "MultiRadioDevice.h"
+#include "PcapFile.h"
+#include "Radiotap.h"
+
+using namespace std::chrono;
+
+PcapRadioDevice::PcapRadioDevice(std::string path, const Options options) : mPath(std::move(path)), mOptions(options) {}
+
+void PcapRadioDevice::receive(FrameCallback callback, const uint8_t channel) {
+    mChannel = channel;
+    mStop = false;
+    PcapReader reader;
+    if (!reader.open(mPath)) return;
+    const bool radiotap = reader.getLinkType() == PcapReader::LINKTYPE_IEEE802_11_RADIOTAP;
+    PcapReader::Packet packet;
+    // Frames captured without FCS get a (zero) one, the dispatcher expects it
+    std::vector<uint8_t> withFcs;
+    const auto start = steady_clock::now();
+    int64_t origin = mOptions.originUs;
+    while (!mStop && reader.next(packet)) {
+        if (origin < 0) origin = packet.timestampUs;
+        if (mOptions.speed > 0) {
+            std::this_thread::sleep_until(start + microseconds((int64_t)((double)(packet.timestampUs - origin) / mOptions.speed)));
+        }
+        Radiotap::Parsed parsed;
+        if (radiotap && !Radiotap::parse(packet.data.data(), packet.data.size(), parsed)) {
+            nInvalid++;
+            continue;
+        }
+        if (parsed.info.freq != 0 && parsed.info.freq != RxInfo::channelToFrequency(mChannel)) {
+            nOtherChannel++;
+            continue;
+        }
+        std::span<uint8_t> frame(packet.data.data() + parsed.length, packet.data.size() - parsed.length);
+        if (radiotap && !parsed.hasFcs) {
+            withFcs.assign(frame.begin(), frame.end());
+            withFcs.resize(withFcs.size() + WfbHeader::FCS_SIZE);
+            frame = withFcs;
+        }
+        // Like a device, which does not know the frequency. pcapng captures of PcapngRecorder have an interface per adapter
+        parsed.info.freq = 0;
+        parsed.info.adapter = (uint8_t)std::min<uint32_t>(packet.interfaceId, RxInfo::MAX_ADAPTERS - 1);
+        nFrames++;
+        callback(frame, parsed.info);
+    }
+}
+
+bool PcapRadioDevice::setChannel(const uint8_t channel) {
+    mChannel = channel;
+    return true;
+}
+
+void PcapRadioDevice::stop() { mStop = true; }
+
+PcapRadioDevice::Stats PcapRadioDevice::getStats() const {
+    Stats ret;
+    ret.nFrames = nFrames;
+    ret.nOtherChannel = nOtherChannel;
+    ret.nInvalid = nInvalid;
+    return ret;
+}
+
+int64_t PcapRadioDevice::firstTimestampUs(const std::string &path) {
+    PcapReader reader;
+    PcapReader::Packet packet;
+    if (!reader.open(path) || !reader.next(packet)) return -1;
+    return packet.timestampUs;
+}
+
+std::unique_ptr<RadioDevice> PcapRadioDevice::openMerged(const std::vector<std::string> &paths, const double speed) {
+    Options options;
+    options.speed = speed;
+    for (const auto &path : paths) {
+        const int64_t first = firstTimestampUs(path);
+        if (first < 0) return nullptr;
+        options.originUs = options.originUs < 0 ? first : std::min(options.originUs, first);
+    }
+    std::vector<std::unique_ptr<RadioDevice>> devices;
+    for (const auto &path : paths) {
+        devices.push_back(std::make_unique<PcapRadioDevice>(path, options));
+    }
+    if (devices.size() == 1) return std::move(devices.front());
+    return std::make_unique<MultiRadioDevice>(std::move(devices));
+}
@@ -0,0 +1,52 @@
+#ifndef FPV_VR_PCAP_RADIO_DEVICE_H
+#define FPV_VR_PCAP_RADIO_DEVICE_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RadioDevice.h"
+
+// Replays a monitor mode capture (pcap or pcapng, 802.11 with or without radiotap) as if it was received live, with the
+// original timing. The radiotap header provides the RxInfo, frames from another channel than the tuned one are skipped.
+// Together with MultiRadioDevice, captures of several adapters replay like a diversity receiver (openMerged()).
+// A pcapng capture of PcapngRecorder already has all adapters, each frame keeps the adapter (interface) it came from.
+class PcapRadioDevice : public RadioDevice {
+  public:
+    struct Options {
+        // 2: twice as fast, 0: as fast as possible
+        double speed = 1.0;
+        // Capture time (us since the epoch) replayed when receive() starts, -1 for the first packet of the file
+        int64_t originUs = -1;
+    };
+    struct Stats {
+        uint64_t nFrames = 0;
+        // Captured on another channel than the tuned one
+        uint64_t nOtherChannel = 0;
+        // No valid radiotap header
+        uint64_t nInvalid = 0;
+    };
+
+  public:
+    PcapRadioDevice(std::string path, Options options);
+    // Returns at the end of the capture or after stop()
+    void receive(FrameCallback callback, uint8_t channel) override;
+    bool setChannel(uint8_t channel) override;
+    void stop() override;
+    Stats getStats() const;
+    // Capture time of the first packet, -1 if path is no readable capture
+    static int64_t firstTimestampUs(const std::string &path);
+    // The captures of several adapters, aligned on their capture time. nullptr if one cannot be read
+    static std::unique_ptr<RadioDevice> openMerged(const std::vector<std::string> &paths, double speed = 1.0);
+
+  private:
+    const std::string mPath;
+    const Options mOptions;
+    std::atomic<uint8_t> mChannel{0};
+    std::atomic<bool> mStop = false;
+    std::atomic<uint64_t> nFrames{0};
+    std::atomic<uint64_t> nOtherChannel{0};
+    std::atomic<uint64_t> nInvalid{0};
+};
+
+#endif // FPV_VR_PCAP_RADIO_DEVICE_H
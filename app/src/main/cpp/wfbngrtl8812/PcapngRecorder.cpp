@@ -0,0 +1,137 @@
+#include "PcapngRecorder.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include "PcapFile.h"
+#include "Radiotap.h"
+
+using namespace std::chrono;
+
+namespace {
+    // Section header block: byte order magic, version 1.0, unknown section length, no options
+    constexpr size_t SECTION_HEADER_SIZE = Pcapng::BLOCK_OVERHEAD + 16;
+    constexpr size_t MAX_INTERFACE_NAME = 16;
+    // Link type, reserved, snaplen, if_name, if_tsresol, end of options
+    constexpr size_t INTERFACE_DESCRIPTION_MAX_SIZE = Pcapng::BLOCK_OVERHEAD + 8 + 4 + MAX_INTERFACE_NAME + 8 + 4;
+    constexpr size_t HEADER_MAX_SIZE = SECTION_HEADER_SIZE + RxInfo::MAX_ADAPTERS * INTERFACE_DESCRIPTION_MAX_SIZE;
+    static_assert(HEADER_MAX_SIZE <= PcapngRecorder::BATCH_SIZE);
+    // Microseconds
+    constexpr uint8_t TIMESTAMP_RESOLUTION = 6;
+    constexpr uint32_t SNAPLEN = 65535;
+
+    // Host byte order, the byte order magic tells readers which one
+    uint8_t *put16(uint8_t *dst, const uint16_t value) {
+        memcpy(dst, &value, sizeof(value));
+        return dst + sizeof(value);
+    }
+    uint8_t *put32(uint8_t *dst, const uint32_t value) {
+        memcpy(dst, &value, sizeof(value));
+        return dst + sizeof(value);
+    }
+    uint8_t *putOption(uint8_t *dst, const uint16_t code, const void *value, const uint16_t length) {
+        dst = put16(dst, code);
+        dst = put16(dst, length);
+        memcpy(dst, value, length);
+        memset(dst + length, 0, Pcapng::pad4(length) - length);
+        return dst + Pcapng::pad4(length);
+    }
+} // namespace
+
+PcapngRecorder::~PcapngRecorder() { stop(); }
+
+bool PcapngRecorder::start(const std::string &fileName) {
+    stop();
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    // At most one batch, the header is never split
+    if (!mWriter.start(fileName, HEADER_MAX_SIZE)) {
+        return false;
+    }
+    nFramesRecorded = 0;
+    nFramesDropped = 0;
+    uint8_t *dst = mWriter.reserve(SECTION_HEADER_SIZE);
+    dst = put32(dst, Pcapng::SECTION_HEADER_BLOCK);
+    dst = put32(dst, SECTION_HEADER_SIZE);
+    dst = put32(dst, Pcapng::BYTE_ORDER_MAGIC);
+    dst = put16(dst, 1);
+    dst = put16(dst, 0);
+    dst = put32(dst, 0xffffffff);
+    dst = put32(dst, 0xffffffff);
+    put32(dst, SECTION_HEADER_SIZE);
+    // One interface per adapter, interface id == RxInfo::adapter
+    for (size_t adapter = 0; adapter < RxInfo::MAX_ADAPTERS; adapter++) {
+        uint8_t block[INTERFACE_DESCRIPTION_MAX_SIZE];
+        const std::string name = "adapter" + std::to_string(adapter);
+        uint8_t *end = block + 8;
+        end = put16(end, PcapReader::LINKTYPE_IEEE802_11_RADIOTAP);
+        end = put16(end, 0);
+        end = put32(end, SNAPLEN);
+        end = putOption(end, Pcapng::IF_NAME, name.data(), (uint16_t)name.size());
+        end = putOption(end, Pcapng::IF_TSRESOL, &TIMESTAMP_RESOLUTION, sizeof(TIMESTAMP_RESOLUTION));
+        end = put32(end, Pcapng::OPT_ENDOFOPT);
+        const auto size = uint32_t(end - block + 4);
+        put32(end, size);
+        put32(block, Pcapng::INTERFACE_DESCRIPTION_BLOCK);
+        put32(block + 4, size);
+        memcpy(mWriter.reserve(size), block, size);
+    }
+    mRecording = true;
+    return true;
+}
+
+void PcapngRecorder::stop() {
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    if (!mRecording) return;
+    mRecording = false;
+    mWriter.stop();
+}
+
+void PcapngRecorder::onFrame(const std::span<const uint8_t> frame, const RxInfo &info,
+                             const system_clock::time_point arrival) {
+    if (!mRecording) return;
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    if (!mRecording) return;
+    mRadiotap.clear();
+    // The devices deliver the frames with their FCS
+    Radiotap::write(mRadiotap, info, true);
+    const size_t captured = mRadiotap.size() + frame.size();
+    const size_t size = Pcapng::BLOCK_OVERHEAD + Pcapng::ENHANCED_PACKET_HEADER + Pcapng::pad4(captured);
+    uint8_t *dst = mWriter.reserve(size);
+    if (!dst) {
+        nFramesDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const auto timestamp = (uint64_t)duration_cast<microseconds>(arrival.time_since_epoch()).count();
+    dst = put32(dst, Pcapng::ENHANCED_PACKET_BLOCK);
+    dst = put32(dst, (uint32_t)size);
+    dst = put32(dst, std::min<uint32_t>(info.adapter, RxInfo::MAX_ADAPTERS - 1));
+    dst = put32(dst, uint32_t(timestamp >> 32));
+    dst = put32(dst, uint32_t(timestamp));
+    dst = put32(dst, (uint32_t)captured);
+    dst = put32(dst, (uint32_t)captured);
+    memcpy(dst, mRadiotap.data(), mRadiotap.size());
+    memcpy(dst + mRadiotap.size(), frame.data(), frame.size());
+    memset(dst + captured, 0, Pcapng::pad4(captured) - captured);
+    put32(dst + Pcapng::pad4(captured), (uint32_t)size);
+    nFramesRecorded.fetch_add(1, std::memory_order_relaxed);
+    mWriter.flushIfDue();
+}
+
+PcapngRecorder::Stats PcapngRecorder::getStats() const {
+    const auto writerStats = mWriter.getStats();
+    Stats ret;
+    ret.nBytesWritten = writerStats.nBytesWritten;
+    ret.nFramesRecorded = nFramesRecorded;
+    ret.nFramesDropped = nFramesDropped;
+    ret.nWriteErrors = writerStats.nWriteErrors;
+    ret.openErrno = writerStats.openErrno;
+    return ret;
+}
+
+std::string PcapngRecorder::createFileName(const std::string &directory) {
+    const time_t now = time(nullptr);
+    tm local{};
+    localtime_r(&now, &local);
+    char name[64];
+    strftime(name, sizeof(name), "wfb_%Y%m%d_%H%M%S.pcapng", &local);
+    return directory + "/" + name;
+}
@@ -0,0 +1,70 @@
+#ifndef FPV_VR_PCAPNG_RECORDER_H
+#define FPV_VR_PCAPNG_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+#include "../videonative/helper/BatchedFileWriter.hpp"
+#include "RxFrame.h"
+
+// Records the received wfb-ng frames as they came from the adapters (before deduplication, decryption and FEC) into
+// a pcapng file, such that a flight with bad video can be analyzed afterwards: Wireshark, wfb-ng's tools, or
+// PcapRadioDevice which replays it through the whole receive path.
+// Each frame gets a radiotap header with its PHY status (RSSI / noise per antenna, rate, channel) and the arrival
+// time. Every adapter is its own pcapng interface.
+// onFrame() runs on the USB thread and never blocks: frames are serialized into the batches of a BatchedFileWriter,
+// which writes them on its own I/O thread. If the I/O thread falls behind and no batch is free the frame is dropped
+// and counted. start() and stop() do not block either, the I/O thread creates and closes the file.
+class PcapngRecorder {
+  public:
+    // Since the last start()
+    struct Stats {
+        uint64_t nBytesWritten = 0;
+        uint64_t nFramesRecorded = 0;
+        // No free batch (the I/O thread fell behind)
+        uint64_t nFramesDropped = 0;
+        // Batches lost because write() failed
+        uint64_t nWriteErrors = 0;
+        // errno if the file could not be created, nothing is recorded then
+        int openErrno = 0;
+    };
+    // 16 batches of 256KB ~ 130ms at 250MBit/s
+    static constexpr size_t BATCH_SIZE = 256 * 1024;
+    static constexpr size_t N_BATCHES = 16;
+    // A partially filled batch is handed to the I/O thread after this time at the latest
+    static constexpr std::chrono::milliseconds MAX_BATCH_AGE{250};
+
+  public:
+    PcapngRecorder() = default;
+    ~PcapngRecorder();
+    PcapngRecorder(const PcapngRecorder &) = delete;
+    // Records into fileName, starting with its header. False (errno set) if the I/O thread is still busy with earlier
+    // captures
+    bool start(const std::string &fileName);
+    // The I/O thread writes everything that is queued, then closes the file
+    void stop();
+    // Blocks until the files of all stop() calls so far are closed
+    void waitUntilClosed() { mWriter.waitUntilClosed(); }
+    bool isRecording() const { return mRecording; }
+    // USB thread. info.adapter selects the pcapng interface
+    void onFrame(std::span<const uint8_t> frame, const RxInfo &info,
+                 std::chrono::system_clock::time_point arrival = std::chrono::system_clock::now());
+    Stats getStats() const;
+    // e.g. "wfb_20240131_235959.pcapng" in directory
+    static std::string createFileName(const std::string &directory);
+
+  private:
+    std::atomic<bool> mRecording = false;
+    // Only contended by start() / stop()
+    std::mutex mProducerMutex;
+    BatchedFileWriter<BATCH_SIZE, N_BATCHES> mWriter{"WfbCapture", MAX_BATCH_AGE};
+    // Reused for the radiotap header of each frame
+    std::vector<uint8_t> mRadiotap;
+    std::atomic<uint64_t> nFramesRecorded{0};
+    std::atomic<uint64_t> nFramesDropped{0};
+};
+
+#endif // FPV_VR_PCAPNG_RECORDER_H
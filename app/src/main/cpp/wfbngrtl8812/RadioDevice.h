@@ -0,0 +1,24 @@
+#ifndef FPV_VR_RADIO_DEVICE_H
+#define FPV_VR_RADIO_DEVICE_H
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include "RxFrame.h"
+
+// What the link needs from a wifi adapter in monitor mode. Rtl8812RadioDevice is the RTL8812AU over libusb (devourer),
+// MockRadioDevice a scripted one for host benchmarks / tests.
+class RadioDevice {
+  public:
+    // frame: the whole 802.11 frame. info.freq is not filled in by the device
+    using FrameCallback = std::function<void(std::span<uint8_t> frame, const RxInfo &info)>;
+    virtual ~RadioDevice() = default;
+    // Tunes to channel and receives until stop(), on the calling thread
+    virtual void receive(FrameCallback callback, uint8_t channel) = 0;
+    // Only reprograms the RF channel, USB, firmware and the receive loop keep running. Any thread
+    virtual bool setChannel(uint8_t channel) = 0;
+    // receive() returns soon after. Any thread
+    virtual void stop() = 0;
+};
+
+#endif // FPV_VR_RADIO_DEVICE_H
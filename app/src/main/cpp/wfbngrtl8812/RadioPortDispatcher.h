@@ -0,0 +1,87 @@
+#ifndef FPV_VR_RADIO_PORT_DISPATCHER_H
+#define FPV_VR_RADIO_PORT_DISPATCHER_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include "RxFrame.h"
+
+// Routes the received wfb-ng frames to the handler (usually an Aggregator) registered for their radio port: video,
+// mavlink, tunnel, a second camera ... One table lookup per frame, link id and port are then checked with two 32-bit
+// compares of the channel id in the transmitter and destination address.
+// Not thread safe, handlers are registered before the first frame is dispatched.
+class RadioPortDispatcher {
+  public:
+    // payload is the wfb-ng packet, without 802.11 header and FCS
+    using Handler = std::function<void(const uint8_t *payload, size_t payloadSize, const RxInfo &info)>;
+    struct Stats {
+        uint64_t nDispatched = 0;
+        // Not a wfb-ng data frame
+        uint64_t nInvalid = 0;
+        // No handler for the radio port
+        uint64_t nUnknownPort = 0;
+        // Registered radio port, but another link id (or corrupted addresses)
+        uint64_t nOtherLink = 0;
+    };
+
+  public:
+    // Replaces the handler already registered for radioPort
+    void registerHandler(const uint32_t linkId, const uint8_t radioPort, Handler handler) {
+        const uint32_t channelId = WfbHeader::channelId(linkId, radioPort);
+        const uint8_t channelIdBe[4] = {uint8_t(channelId >> 24), uint8_t(channelId >> 16), uint8_t(channelId >> 8),
+                                        uint8_t(channelId)};
+        Entry &entry = mEntries[radioPort];
+        memcpy(&entry.channelIdBe, channelIdBe, sizeof(entry.channelIdBe));
+        entry.handler = std::move(handler);
+    }
+
+    void unregisterHandler(const uint8_t radioPort) { mEntries[radioPort] = Entry{}; }
+
+    // True if the frame was handed to a handler
+    bool dispatch(const std::span<uint8_t> data, const RxInfo &info) {
+        const int radioPort = classify(data);
+        if (radioPort < 0) {
+            return false;
+        }
+        handle((uint8_t)radioPort, data.data() + WfbHeader::SIZE, data.size() - WfbHeader::SIZE - WfbHeader::FCS_SIZE, info);
+        return true;
+    }
+    // The first half of dispatch(): the radio port the frame goes to, -1 if it is dropped (counted in the stats).
+    // Split such that the handler can run on another thread
+    int classify(const std::span<uint8_t> data) {
+        const RxFrame frame(data);
+        if (!frame.IsValidWfbFrame()) {
+            mStats.nInvalid++;
+            return -1;
+        }
+        const Entry &entry = mEntries[frame.GetRadioPort()];
+        if (!entry.handler) {
+            mStats.nUnknownPort++;
+            return -1;
+        }
+        if (!frame.MatchesChannelID(entry.channelIdBe)) {
+            mStats.nOtherLink++;
+            return -1;
+        }
+        mStats.nDispatched++;
+        return frame.GetRadioPort();
+    }
+    // The second half, for a radio port classify() returned
+    void handle(const uint8_t radioPort, const uint8_t *payload, const size_t payloadSize, const RxInfo &info) {
+        mEntries[radioPort].handler(payload, payloadSize, info);
+    }
+
+    const Stats &getStats() const { return mStats; }
+
+  private:
+    struct Entry {
+        // As it is in the frame, compared without byte swapping
+        uint32_t channelIdBe = 0;
+        Handler handler;
+    };
+    std::array<Entry, 256> mEntries{};
+    Stats mStats;
+};
+
+#endif // FPV_VR_RADIO_PORT_DISPATCHER_H
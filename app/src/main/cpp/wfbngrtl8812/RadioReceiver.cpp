@@ -0,0 +1,105 @@
+#include "RadioReceiver.h"
+
+using namespace std::chrono;
+
+RadioReceiver::RadioReceiver(std::unique_ptr<RadioDevice> device, std::shared_ptr<SignalQuality> signalQuality)
+    : mDevice(std::move(device)), mSignalQuality(std::move(signalQuality)),
+      mWorker([this](uint8_t radioPort, const uint8_t *payload, size_t payloadSize, const RxInfo &info) {
+          mDispatcher.handle(radioPort, payload, payloadSize, info);
+      }) {}
+
+void RadioReceiver::run(const uint8_t channel) {
+    {
+        std::lock_guard<std::mutex> lock(mRetuneMutex);
+        mRetuneStats.channel = channel;
+    }
+    mFreq = RxInfo::channelToFrequency(channel);
+    for (auto &counters : mAdapterCounters) {
+        counters.nFrames = 0;
+        counters.nFirst = 0;
+        counters.rssiSum = 0;
+    }
+    nDuplicates = 0;
+    mWorker.start();
+    mDevice->receive([this](std::span<uint8_t> frame, const RxInfo &info) { onFrame(frame, info); }, channel);
+    mWorker.stop();
+}
+
+bool RadioReceiver::retune(const uint8_t channel) {
+    std::lock_guard<std::mutex> lock(mRetuneMutex);
+    const auto start = steady_clock::now();
+    if (!mDevice->setChannel(channel)) {
+        mRetuneStats.nFailed++;
+        return false;
+    }
+    const auto programmed = steady_clock::now();
+    mFreq = RxInfo::channelToFrequency(channel);
+    mRetuneStats.nRetunes++;
+    mRetuneStats.channel = channel;
+    mRetuneStats.lastProgram = duration_cast<microseconds>(programmed - start);
+    mRetuneStats.maxProgram = std::max(mRetuneStats.maxProgram, mRetuneStats.lastProgram);
+    mRetuneStats.lastFirstFrame = microseconds(0);
+    mRetuneStart = start;
+    mSettleUntil = programmed + RETUNE_SETTLE;
+    mAwaitFirstFrame = true;
+    return true;
+}
+
+void RadioReceiver::stop() { mDevice->stop(); }
+
+RadioReceiver::DiversityStats RadioReceiver::getDiversityStats() const {
+    DiversityStats ret;
+    ret.nDuplicates = nDuplicates;
+    for (size_t i = 0; i < RxInfo::MAX_ADAPTERS; i++) {
+        ret.adapters[i].nFrames = mAdapterCounters[i].nFrames;
+        ret.adapters[i].nFirst = mAdapterCounters[i].nFirst;
+        ret.adapters[i].rssiSum = mAdapterCounters[i].rssiSum;
+    }
+    return ret;
+}
+
+RadioReceiver::RetuneStats RadioReceiver::getRetuneStats() const {
+    std::lock_guard<std::mutex> lock(mRetuneMutex);
+    return mRetuneStats;
+}
+
+void RadioReceiver::onFrame(const std::span<uint8_t> frame, RxInfo info) {
+    info.freq = mFreq;
+    const int radioPort = mDispatcher.classify(frame);
+    if (radioPort < 0) {
+        return;
+    }
+    // Every copy counts for the signal quality and the scanner, and is recorded
+    if (mFrameRecorder) {
+        mFrameRecorder->onFrame(frame, info);
+    }
+    if (mSignalQuality) {
+        mSignalQuality->add(info);
+    }
+    if (mFrameObserver) {
+        mFrameObserver(info);
+    }
+    if (mAwaitFirstFrame) {
+        const auto now = steady_clock::now();
+        std::lock_guard<std::mutex> lock(mRetuneMutex);
+        if (mAwaitFirstFrame && now >= mSettleUntil) {
+            mRetuneStats.lastFirstFrame = duration_cast<microseconds>(now - mRetuneStart);
+            mAwaitFirstFrame = false;
+        }
+    }
+    const uint8_t *payload = frame.data() + WfbHeader::SIZE;
+    const size_t payloadSize = frame.size() - WfbHeader::SIZE - WfbHeader::FCS_SIZE;
+    AdapterCounters &counters = mAdapterCounters[std::min<size_t>(info.adapter, RxInfo::MAX_ADAPTERS - 1)];
+    int8_t rssi = SCHAR_MIN;
+    for (size_t i = 0; i < RxInfo::MAX_ANTENNAS && info.antenna[i] != 0xff; i++) {
+        rssi = std::max(rssi, info.rssi[i]);
+    }
+    counters.nFrames.fetch_add(1, std::memory_order_relaxed);
+    counters.rssiSum.fetch_add(rssi, std::memory_order_relaxed);
+    if (mDeduplicator.isDuplicate((uint8_t)radioPort, payload, payloadSize, steady_clock::now())) {
+        nDuplicates.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    counters.nFirst.fetch_add(1, std::memory_order_relaxed);
+    mWorker.push((uint8_t)radioPort, payload, payloadSize, info);
+}
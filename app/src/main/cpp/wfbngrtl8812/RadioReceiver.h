@@ -0,0 +1,101 @@
+#ifndef FPV_VR_RADIO_RECEIVER_H
+#define FPV_VR_RADIO_RECEIVER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include "FrameDeduplicator.h"
+#include "PcapngRecorder.h"
+#include "RadioDevice.h"
+#include "RadioPortDispatcher.h"
+#include "RxFrameWorker.h"
+#include "SignalQuality.h"
+
+// Receives the frames of a RadioDevice and hands them to the RadioPortDispatcher. The device thread (USB) only
+// classifies the frames, the handlers (decryption and FEC in the aggregators) run on the RxFrameWorker.
+// With several adapters (MultiRadioDevice) the copies of a frame are dropped before they are queued, only the first
+// one is decrypted.
+// retune() moves to another channel while receiving: only the RF channel is reprogrammed, the device, its firmware
+// and everything registered on the dispatcher (the aggregators with their FEC and crypto state) stay as they are.
+class RadioReceiver {
+  public:
+    struct RetuneStats {
+        uint64_t nRetunes = 0;
+        uint64_t nFailed = 0;
+        uint8_t channel = 0;
+        // Reprogramming the RF channel
+        std::chrono::microseconds lastProgram{0};
+        std::chrono::microseconds maxProgram{0};
+        // From the retune() call until the first frame was dispatched after RETUNE_SETTLE, 0 until then
+        std::chrono::microseconds lastFirstFrame{0};
+    };
+    // Frames dispatched that soon after a retune may still have been received on the previous channel (USB transfers
+    // in flight)
+    static constexpr std::chrono::milliseconds RETUNE_SETTLE{10};
+
+    struct AdapterStats {
+        // Dispatched, duplicates included
+        uint64_t nFrames = 0;
+        // The first copy, which went to the aggregators
+        uint64_t nFirst = 0;
+        // Of the strongest path
+        int64_t rssiSum = 0;
+        float getRssiAvg() const { return nFrames == 0 ? 0 : (float)rssiSum / (float)nFrames; }
+    };
+    struct DiversityStats {
+        uint64_t nDuplicates = 0;
+        std::array<AdapterStats, RxInfo::MAX_ADAPTERS> adapters;
+    };
+
+  public:
+    using FrameObserver = std::function<void(const RxInfo &info)>;
+
+  public:
+    RadioReceiver(std::unique_ptr<RadioDevice> device, std::shared_ptr<SignalQuality> signalQuality);
+    // Register the handlers before run()
+    RadioPortDispatcher &getDispatcher() { return mDispatcher; }
+    // Called for every dispatched frame (e.g. the ChannelScanner), set before run()
+    void setFrameObserver(FrameObserver observer) { mFrameObserver = std::move(observer); }
+    // Gets every wfb-ng frame of a registered link as received, duplicates included, set before run()
+    void setFrameRecorder(std::shared_ptr<PcapngRecorder> recorder) { mFrameRecorder = std::move(recorder); }
+    // Blocks until stop()
+    void run(uint8_t channel);
+    // Any thread, while run() is active
+    bool retune(uint8_t channel);
+    void stop();
+    RetuneStats getRetuneStats() const;
+    // Queue occupancy and the frames dropped because the handlers fell behind
+    RxFrameWorker::Stats getWorkerStats() const { return mWorker.getStats(); }
+    // Per adapter frames / RSSI and how many frames each one contributed first, since run()
+    DiversityStats getDiversityStats() const;
+
+  private:
+    void onFrame(std::span<uint8_t> frame, RxInfo info);
+    const std::unique_ptr<RadioDevice> mDevice;
+    const std::shared_ptr<SignalQuality> mSignalQuality;
+    RadioPortDispatcher mDispatcher;
+    FrameObserver mFrameObserver;
+    std::shared_ptr<PcapngRecorder> mFrameRecorder;
+    RxFrameWorker mWorker;
+    FrameDeduplicator mDeduplicator;
+    struct AdapterCounters {
+        std::atomic<uint64_t> nFrames{0};
+        std::atomic<uint64_t> nFirst{0};
+        std::atomic<int64_t> rssiSum{0};
+    };
+    std::array<AdapterCounters, RxInfo::MAX_ADAPTERS> mAdapterCounters;
+    std::atomic<uint64_t> nDuplicates{0};
+    std::atomic<uint32_t> mFreq{0};
+    // Serializes retunes, guards the stats
+    mutable std::mutex mRetuneMutex;
+    RetuneStats mRetuneStats;
+    std::chrono::steady_clock::time_point mRetuneStart;
+    std::chrono::steady_clock::time_point mSettleUntil;
+    std::atomic<bool> mAwaitFirstFrame = false;
+};
+
+#endif // FPV_VR_RADIO_RECEIVER_H
@@ -0,0 +1,207 @@
+#ifndef FPV_VR_RADIOTAP_H
+#define FPV_VR_RADIOTAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "RxFrame.h"
+
+// Just enough of radiotap (https://www.radiotap.org) to replay and write captures of wfb-ng links: the flags (FCS),
+// the rate, the channel and the signal / noise, per antenna the way Linux reports it (one radiotap namespace per RF
+// chain with its dBm signal and antenna index, after the frame level fields).
+namespace Radiotap {
+constexpr uint8_t FLAGS_FCS = 0x10;
+enum Field : uint8_t {
+    TSFT = 0,
+    FLAGS = 1,
+    RATE = 2,
+    CHANNEL = 3,
+    FHSS = 4,
+    DBM_ANTSIGNAL = 5,
+    DBM_ANTNOISE = 6,
+    LOCK_QUALITY = 7,
+    TX_ATTENUATION = 8,
+    DB_TX_ATTENUATION = 9,
+    DBM_TX_POWER = 10,
+    ANTENNA = 11,
+    DB_ANTSIGNAL = 12,
+    DB_ANTNOISE = 13,
+    RX_FLAGS = 14,
+    TX_FLAGS = 15,
+    RTS_RETRIES = 16,
+    DATA_RETRIES = 17,
+    XCHANNEL = 18,
+    MCS = 19,
+    AMPDU_STATUS = 20,
+    VHT = 21,
+    TIMESTAMP = 22,
+    RADIOTAP_NAMESPACE = 29,
+    VENDOR_NAMESPACE = 30,
+    EXT = 31,
+};
+// Alignment and size of the fields up to TIMESTAMP, in bit order
+constexpr uint8_t ALIGN[] = {8, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1, 1, 1, 1, 2, 2, 1, 1, 4, 1, 4, 2, 8};
+constexpr uint8_t SIZE[] = {8, 1, 1, 4, 2, 1, 1, 2, 2, 2, 1, 1, 1, 1, 2, 2, 1, 1, 8, 3, 8, 12, 12};
+constexpr uint8_t MAX_KNOWN_FIELD = TIMESTAMP;
+// Legacy rates in 500kbit/s, in the order of the Realtek rate index (CCK 0..3, OFDM 4..11). HT MCS n is index 12 + n
+constexpr uint8_t LEGACY_RATES[] = {2, 4, 11, 22, 12, 18, 24, 36, 48, 72, 96, 108};
+constexpr uint8_t RTL_HT_MCS0 = 12;
+constexpr uint8_t RTL_VHT_1SS_MCS0 = 44;
+
+struct Parsed {
+    // Of the whole radiotap header, the 802.11 frame follows
+    size_t length = 0;
+    // The frame ends with the FCS
+    bool hasFcs = false;
+    RxInfo info;
+};
+
+inline uint16_t load16(const uint8_t *p) { return uint16_t(p[0] | (p[1] << 8)); }
+inline uint32_t load32(const uint8_t *p) { return uint32_t(p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24)); }
+
+// Without per chain fields the frame level signal is antenna 0
+inline bool finish(Parsed &out, const size_t nChains, const bool hasFrameSignal, const int8_t frameSignal) {
+    if (nChains == 0 && hasFrameSignal) {
+        out.info.antenna[0] = 0;
+        out.info.rssi[0] = frameSignal;
+    }
+    return true;
+}
+
+// False if data does not start with a valid radiotap header. Fields after an unknown one are ignored
+inline bool parse(const uint8_t *data, const size_t size, Parsed &out) {
+    if (size < 8 || data[0] != 0) return false;
+    const size_t length = load16(data + 2);
+    if (length < 8 || length > size) return false;
+    out = Parsed{};
+    out.length = length;
+    // The presence words, each namespace (frame level first, then one per RF chain) has at least one.
+    // The fields of namespaces beyond MAX_PRESENT are ignored
+    constexpr size_t MAX_PRESENT = 8;
+    uint32_t present[MAX_PRESENT];
+    size_t nPresent = 0;
+    size_t offset = 4;
+    uint32_t word;
+    do {
+        if (offset + 4 > length) return false;
+        word = load32(data + offset);
+        if (nPresent < MAX_PRESENT) present[nPresent++] = word;
+        offset += 4;
+    } while (word & (1u << EXT));
+    int8_t frameSignal = SCHAR_MIN;
+    bool hasFrameSignal = false;
+    size_t nChains = 0;
+    int8_t chainSignal = SCHAR_MIN;
+    int chainAntenna = -1;
+    bool frameLevel = true;
+    bool continuation = false;
+    for (size_t i = 0; i < nPresent; i++) {
+        const uint32_t word = present[i];
+        // Bits 32.. of the namespace, none of them known
+        if (continuation && (word & ((1u << RADIOTAP_NAMESPACE) - 1))) break;
+        continuation = (word & (1u << EXT)) && !(word & ((1u << RADIOTAP_NAMESPACE) | (1u << VENDOR_NAMESPACE)));
+        for (uint8_t bit = 0; bit < RADIOTAP_NAMESPACE; bit++) {
+            if (!(word & (1u << bit))) continue;
+            if (bit > MAX_KNOWN_FIELD) return finish(out, nChains, hasFrameSignal, frameSignal);
+            offset = (offset + ALIGN[bit] - 1) & ~size_t(ALIGN[bit] - 1);
+            if (offset + SIZE[bit] > length) return false;
+            const uint8_t *field = data + offset;
+            if (frameLevel) {
+                switch (bit) {
+                case FLAGS:
+                    out.hasFcs = (field[0] & FLAGS_FCS) != 0;
+                    break;
+                case RATE:
+                    for (uint8_t i = 0; i < sizeof(LEGACY_RATES); i++) {
+                        if (LEGACY_RATES[i] == field[0]) out.info.dataRate = i;
+                    }
+                    break;
+                case CHANNEL:
+                    out.info.freq = load16(field);
+                    break;
+                case DBM_ANTSIGNAL:
+                    frameSignal = (int8_t)field[0];
+                    hasFrameSignal = true;
+                    break;
+                case DBM_ANTNOISE:
+                    for (auto &noise : out.info.noise) noise = (int8_t)field[0];
+                    break;
+                case MCS:
+                    // known, flags, mcs
+                    if (field[0] & 0x02) out.info.dataRate = uint8_t(RTL_HT_MCS0 + field[2]);
+                    break;
+                default:
+                    break;
+                }
+            } else if (bit == DBM_ANTSIGNAL) {
+                chainSignal = (int8_t)field[0];
+            } else if (bit == ANTENNA) {
+                chainAntenna = field[0];
+            }
+            offset += SIZE[bit];
+        }
+        if (word & (1u << VENDOR_NAMESPACE)) break;
+        if (!frameLevel && chainAntenna >= 0 && nChains < RxInfo::MAX_ANTENNAS) {
+            out.info.antenna[nChains] = (uint8_t)chainAntenna;
+            out.info.rssi[nChains] = chainSignal;
+            nChains++;
+        }
+        chainAntenna = -1;
+        if (word & (1u << RADIOTAP_NAMESPACE)) frameLevel = false;
+    }
+    return finish(out, nChains, hasFrameSignal, frameSignal);
+}
+
+// Appends a radiotap header for info in the layout parse() reads (and Linux writes): frame level flags, rate,
+// channel, strongest signal and noise, then one namespace per antenna
+inline void write(std::vector<uint8_t> &out, const RxInfo &info, const bool hasFcs) {
+    size_t nChains = 0;
+    int8_t strongest = SCHAR_MIN;
+    while (nChains < RxInfo::MAX_ANTENNAS && info.antenna[nChains] != 0xff) {
+        strongest = std::max(strongest, info.rssi[nChains]);
+        nChains++;
+    }
+    const bool ht = info.dataRate >= RTL_HT_MCS0 && info.dataRate < RTL_VHT_1SS_MCS0;
+    uint32_t frameLevel = (1u << FLAGS) | (1u << CHANNEL);
+    frameLevel |= ht ? (1u << MCS) : (info.dataRate < sizeof(LEGACY_RATES) ? (1u << RATE) : 0);
+    if (nChains > 0) frameLevel |= (1u << DBM_ANTSIGNAL);
+    if (info.noise[0] != SCHAR_MAX) frameLevel |= (1u << DBM_ANTNOISE);
+    std::vector<uint32_t> present{frameLevel};
+    for (size_t i = 0; i < nChains; i++) {
+        present.back() |= (1u << RADIOTAP_NAMESPACE) | (1u << EXT);
+        present.push_back((1u << DBM_ANTSIGNAL) | (1u << ANTENNA));
+    }
+    const size_t start = out.size();
+    out.resize(start + 4 + 4 * present.size());
+    for (size_t i = 0; i < present.size(); i++) {
+        for (int b = 0; b < 4; b++) out[start + 4 + 4 * i + b] = uint8_t(present[i] >> (8 * b));
+    }
+    out.push_back(hasFcs ? FLAGS_FCS : 0);
+    if (frameLevel & (1u << RATE)) out.push_back(LEGACY_RATES[info.dataRate]);
+    if ((out.size() - start) & 1) out.push_back(0);
+    out.push_back(uint8_t(info.freq));
+    out.push_back(uint8_t(info.freq >> 8));
+    // Channel flags: 5GHz / 2GHz, OFDM
+    const uint16_t channelFlags = (info.freq > 4000 ? 0x0100 : 0x0080) | 0x0040;
+    out.push_back(uint8_t(channelFlags));
+    out.push_back(uint8_t(channelFlags >> 8));
+    if (frameLevel & (1u << DBM_ANTSIGNAL)) out.push_back((uint8_t)strongest);
+    if (frameLevel & (1u << DBM_ANTNOISE)) out.push_back((uint8_t)info.noise[0]);
+    if (ht) {
+        // Known: MCS index, flags: none
+        out.insert(out.end(), {0x02, 0x00, uint8_t(info.dataRate - RTL_HT_MCS0)});
+    }
+    for (size_t i = 0; i < nChains; i++) {
+        out.push_back((uint8_t)info.rssi[i]);
+        out.push_back(info.antenna[i]);
+    }
+    const size_t length = out.size() - start;
+    out[start] = 0;
+    out[start + 1] = 0;
+    out[start + 2] = uint8_t(length);
+    out[start + 3] = uint8_t(length >> 8);
+}
+} // namespace Radiotap
+
+#endif // FPV_VR_RADIOTAP_H
@@ -0,0 +1,111 @@
+#include "ReedSolomon.h"
+#include <cstring>
+#include <utility>
+
+namespace {
+    // Gauss-Jordan, matrix (k x k) is destroyed. False if it is singular
+    bool invert(uint8_t *matrix, uint8_t *inverse, const unsigned k) {
+        memset(inverse, 0, size_t(k) * k);
+        for (unsigned i = 0; i < k; i++) {
+            inverse[i * k + i] = 1;
+        }
+        for (unsigned col = 0; col < k; col++) {
+            unsigned pivot = col;
+            while (pivot < k && matrix[pivot * k + col] == 0) pivot++;
+            if (pivot == k) return false;
+            if (pivot != col) {
+                for (unsigned i = 0; i < k; i++) {
+                    std::swap(matrix[pivot * k + i], matrix[col * k + i]);
+                    std::swap(inverse[pivot * k + i], inverse[col * k + i]);
+                }
+            }
+            const uint8_t scale = GaloisField::inverse(matrix[col * k + col]);
+            for (unsigned i = 0; i < k; i++) {
+                matrix[col * k + i] = GaloisField::mul(matrix[col * k + i], scale);
+                inverse[col * k + i] = GaloisField::mul(inverse[col * k + i], scale);
+            }
+            for (unsigned row = 0; row < k; row++) {
+                const uint8_t factor = matrix[row * k + col];
+                if (row == col || factor == 0) continue;
+                for (unsigned i = 0; i < k; i++) {
+                    matrix[row * k + i] ^= GaloisField::mul(matrix[col * k + i], factor);
+                    inverse[row * k + i] ^= GaloisField::mul(inverse[col * k + i], factor);
+                }
+            }
+        }
+        return true;
+    }
+
+    GaloisField::Path supportedPath(GaloisField::Path path) {
+        path = GaloisField::resolve(path);
+        return GaloisField::isSupported(path) ? path : GaloisField::Path::SCALAR;
+    }
+} // namespace
+
+ReedSolomon::ReedSolomon(const unsigned k, const unsigned n, const GaloisField::Path path)
+    : mK(k), mN(n), mPath(supportedPath(path)), mMulAdd(GaloisField::mulAddFunction(mPath)), mEncodeMatrix(size_t(n) * k, 0) {
+    // Vandermonde rows of the points 0, 1, a, a^2 ... a^(n-2) (zfec's fec_new())
+    std::vector<uint8_t> vandermonde(size_t(n) * k, 0);
+    vandermonde[0] = 1;
+    for (unsigned row = 1; row < n; row++) {
+        for (unsigned col = 0; col < k; col++) {
+            vandermonde[row * k + col] = GaloisField::exp((row - 1) * col);
+        }
+    }
+    // Systematic: the bottom rows times the inverse of the top k x k, which is never singular (distinct points)
+    std::vector<uint8_t> top(vandermonde.begin(), vandermonde.begin() + size_t(k) * k);
+    std::vector<uint8_t> topInverse(size_t(k) * k);
+    invert(top.data(), topInverse.data(), k);
+    for (unsigned i = 0; i < k; i++) {
+        mEncodeMatrix[i * k + i] = 1;
+    }
+    for (unsigned row = k; row < n; row++) {
+        for (unsigned col = 0; col < k; col++) {
+            uint8_t sum = 0;
+            for (unsigned i = 0; i < k; i++) {
+                sum ^= GaloisField::mul(vandermonde[row * k + i], topInverse[i * k + col]);
+            }
+            mEncodeMatrix[row * k + col] = sum;
+        }
+    }
+}
+
+void ReedSolomon::encode(const uint8_t *const *data, uint8_t *const *fecs, const unsigned *blockNums,
+                         const size_t nBlockNums, const size_t size) const {
+    for (size_t i = 0; i < nBlockNums; i++) {
+        if (blockNums[i] < mK) {
+            memcpy(fecs[i], data[blockNums[i]], size);
+            continue;
+        }
+        const uint8_t *row = getEncodeRow(blockNums[i]);
+        memset(fecs[i], 0, size);
+        for (unsigned j = 0; j < mK; j++) {
+            mMulAdd(fecs[i], data[j], row[j], size);
+        }
+    }
+}
+
+bool ReedSolomon::decode(const uint8_t *const *blocks, const unsigned *index, uint8_t *const *recovered,
+                         const size_t size) const {
+    // The aggregator's thread, allocated once
+    thread_local std::vector<uint8_t> matrix;
+    thread_local std::vector<uint8_t> inverse;
+    matrix.resize(size_t(mK) * mK);
+    inverse.resize(size_t(mK) * mK);
+    for (unsigned i = 0; i < mK; i++) {
+        if (index[i] < mK ? index[i] != i : index[i] >= mN) return false;
+        memcpy(matrix.data() + size_t(i) * mK, getEncodeRow(index[i]), mK);
+    }
+    // A repeated parity block makes it singular
+    if (!invert(matrix.data(), inverse.data(), mK)) return false;
+    size_t nRecovered = 0;
+    for (unsigned row = 0; row < mK; row++) {
+        if (index[row] < mK) continue;
+        uint8_t *out = recovered[nRecovered++];
+        memset(out, 0, size);
+        for (unsigned col = 0; col < mK; col++) {
+            mMulAdd(out, blocks[col], inverse[row * mK + col], size);
+        }
+    }
+    return true;
+}
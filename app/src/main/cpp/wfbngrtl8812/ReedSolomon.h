@@ -0,0 +1,45 @@
+#ifndef FPV_VR_REED_SOLOMON_H
+#define FPV_VR_REED_SOLOMON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GaloisField.h"
+
+// Systematic (k, n) Reed-Solomon erasure code, block compatible with wfb-ng's FEC (zfec): the same Vandermonde based
+// encoding matrix, so the parity blocks are identical and a block of either side decodes with the other.
+// Blocks 0..k-1 are the data, k..n-1 the parity. The region arithmetic runs on the GaloisField kernel of path
+// (scalar if this CPU does not support it).
+// Compatible by construction only, not yet checked against the output of zfec's fec_decode(). Host builds only until
+// the wfb-ng submodule uses it instead of fec.c.
+class ReedSolomon {
+  public:
+    // zfec's limits
+    static constexpr unsigned MAX_N = 256;
+
+  public:
+    // 1 <= k <= n <= MAX_N
+    ReedSolomon(unsigned k, unsigned n, GaloisField::Path path = GaloisField::Path::AUTO);
+    unsigned getK() const { return mK; }
+    unsigned getN() const { return mN; }
+    GaloisField::Path getPath() const { return mPath; }
+    // Row of block index (k coefficients over the data blocks)
+    const uint8_t *getEncodeRow(unsigned index) const { return mEncodeMatrix.data() + size_t(index) * mK; }
+    // fecs[i] = block blockNums[i] (>= k) of the k data blocks, size bytes each
+    void encode(const uint8_t *const *data, uint8_t *const *fecs, const unsigned *blockNums, size_t nBlockNums,
+                size_t size) const;
+    // k received blocks, blocks[i] is block index[i]. A received data block has to be at its own position
+    // (index[i] == i), parity blocks fill the positions of the missing ones. The missing data blocks are written to
+    // recovered in ascending order. Like zfec's fec_decode(). False if an index is out of range or repeated
+    bool decode(const uint8_t *const *blocks, const unsigned *index, uint8_t *const *recovered, size_t size) const;
+
+  private:
+    const unsigned mK;
+    const unsigned mN;
+    const GaloisField::Path mPath;
+    const GaloisField::MulAddFunction mMulAdd;
+    // n x k, the first k rows are the identity
+    std::vector<uint8_t> mEncodeMatrix;
+};
+
+#endif // FPV_VR_REED_SOLOMON_H
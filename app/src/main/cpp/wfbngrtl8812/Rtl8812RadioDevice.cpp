@@ -0,0 +1,43 @@
+#include "Rtl8812RadioDevice.h"
+#include <algorithm>
+
+// The RTL8812AU has two RF paths
+static constexpr size_t RTL8812_RF_PATHS = 2;
+
+// The PHY status reports the per path signal strength in percent, which Realtek maps linearly from -100..0 dBm
+static int8_t rtlRssiToDbm(const uint8_t percentage) {
+    return static_cast<int8_t>(std::min<int>(percentage, 100) - 100);
+}
+
+static SelectedChannel toSelectedChannel(const uint8_t channel) {
+    return SelectedChannel{
+            .Channel = channel,
+            .ChannelOffset = 0,
+            .ChannelWidth = CHANNEL_WIDTH_20,
+    };
+}
+
+void Rtl8812RadioDevice::receive(FrameCallback callback, const uint8_t channel) {
+    mDevice->should_stop = false;
+    mDevice->Init([callback = std::move(callback)](const Packet &packet) {
+        // PHY status of the RX descriptor as decoded by devourer's FrameParser, one entry per RF path
+        RxInfo info;
+        for (size_t i = 0; i < RTL8812_RF_PATHS; i++) {
+            info.antenna[i] = static_cast<uint8_t>(i);
+            info.rssi[i] = rtlRssiToDbm(packet.RxAtrib.rssi[i]);
+            info.noise[i] = info.rssi[i] - packet.RxAtrib.snr[i];
+        }
+        info.dataRate = packet.RxAtrib.data_rate;
+        callback(packet.Data, info);
+    }, toSelectedChannel(channel));
+}
+
+bool Rtl8812RadioDevice::setChannel(const uint8_t channel) {
+    std::lock_guard<std::mutex> lock(mChannelMutex);
+    mDevice->SetMonitorChannel(toSelectedChannel(channel));
+    return true;
+}
+
+void Rtl8812RadioDevice::stop() {
+    mDevice->should_stop = true;
+}
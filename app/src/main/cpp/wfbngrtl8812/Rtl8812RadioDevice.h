@@ -0,0 +1,23 @@
+#ifndef FPV_VR_RTL8812_RADIO_DEVICE_H
+#define FPV_VR_RTL8812_RADIO_DEVICE_H
+
+#include <memory>
+#include <mutex>
+#include "RadioDevice.h"
+#include "devourer/src/Rtl8812aDevice.h"
+
+// devourer's Rtl8812aDevice. The PHY status devourer's FrameParser decodes becomes the RxInfo of each frame.
+class Rtl8812RadioDevice : public RadioDevice {
+  public:
+    explicit Rtl8812RadioDevice(std::unique_ptr<Rtl8812aDevice> device) : mDevice(std::move(device)) {}
+    void receive(FrameCallback callback, uint8_t channel) override;
+    bool setChannel(uint8_t channel) override;
+    void stop() override;
+
+  private:
+    std::unique_ptr<Rtl8812aDevice> mDevice;
+    // Register writes of a retune must not interleave
+    std::mutex mChannelMutex;
+};
+
+#endif // FPV_VR_RTL8812_RADIO_DEVICE_H
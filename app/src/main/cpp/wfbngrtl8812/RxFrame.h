@@ -6,6 +6,9 @@
 #define LIBUSBDEMO_RXFRAME_H
 
 #include <array>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <span>
@@ -13,6 +16,64 @@
 
 enum class RadioPort { /* define your RadioPort enum */ };
 
+// Layout of the 802.11 header of a wfb-ng frame. The transmitter (10..15) and destination (16..21) addresses both carry
+// 'W' 'B' followed by the big endian channel id ((link id << 8) | radio port)
+namespace WfbHeader {
+constexpr size_t SRC_MAC = 10;
+constexpr size_t SRC_CHANNEL_ID = 12;
+constexpr size_t SRC_RADIO_PORT = 15;
+constexpr size_t DST_MAC = 16;
+constexpr size_t DST_CHANNEL_ID = 18;
+constexpr size_t DST_RADIO_PORT = 21;
+constexpr size_t SEQUENCE_CONTROL = 22;
+constexpr size_t SIZE = 24;
+// Frame check sequence at the end of the frame
+constexpr size_t FCS_SIZE = 4;
+constexpr uint8_t MAGIC[2] = {0x57, 0x42};
+
+constexpr uint32_t channelId(const uint32_t linkId, const uint8_t radioPort) { return (linkId << 8) + radioPort; }
+} // namespace WfbHeader
+
+// The start of the wfb-ng packet (the frame payload): the packet type, then for data packets the big endian nonce
+// ((block index << 8) | fragment index), for session packets the first bytes of the random session nonce.
+// Either way the 8 bytes after the type identify the packet.
+namespace WfbPacket {
+constexpr uint8_t TYPE_DATA = 0x01;
+constexpr uint8_t TYPE_SESSION = 0x02;
+constexpr size_t NONCE = 1;
+constexpr size_t NONCE_SIZE = 8;
+
+inline bool hasNonce(const size_t payloadSize) { return payloadSize >= NONCE + NONCE_SIZE; }
+inline uint64_t nonce(const uint8_t *payload) {
+    uint64_t ret = 0;
+    for (size_t i = 0; i < NONCE_SIZE; i++) ret = (ret << 8) | payload[NONCE + i];
+    return ret;
+}
+} // namespace WfbPacket
+
+// Per frame PHY status of the adapter, in the form wfb-ng's Aggregator::process_packet takes it.
+// Unused paths have antenna 0xff.
+struct RxInfo {
+    static constexpr size_t MAX_ANTENNAS = 4;
+    // Each adapter has at least one antenna
+    static constexpr size_t MAX_ADAPTERS = MAX_ANTENNAS;
+    std::array<uint8_t, MAX_ANTENNAS> antenna{0xff, 0xff, 0xff, 0xff};
+    std::array<int8_t, MAX_ANTENNAS> rssi{SCHAR_MIN, SCHAR_MIN, SCHAR_MIN, SCHAR_MIN};
+    std::array<int8_t, MAX_ANTENNAS> noise{SCHAR_MAX, SCHAR_MAX, SCHAR_MAX, SCHAR_MAX};
+    uint32_t freq = 0;
+    // Realtek rate index of the descriptor (0..3 CCK, 4..11 OFDM, 12.. HT MCS, 44.. VHT)
+    uint8_t dataRate = 0;
+    // Which adapter received the frame when several are merged (MultiRadioDevice)
+    uint8_t adapter = 0;
+
+    static uint32_t channelToFrequency(const uint32_t channel) {
+        if (channel == 14) return 2484;
+        return channel < 14 ? 2407 + channel * 5 : 5000 + channel * 5;
+    }
+};
+
+// View of a received frame, never copies. All accessors but IsValidWfbFrame() expect a frame of at least
+// WfbHeader::SIZE + WfbHeader::FCS_SIZE bytes, which IsValidWfbFrame() checks.
 class RxFrame {
   private:
     std::span<uint8_t> _data;
@@ -20,9 +81,7 @@ class RxFrame {
                                                            uint8_t(0x01)}; // Frame control value for QoS Data
 
   public:
-    RxFrame(const std::span<uint8_t> &data) : _data(data) { DataAsMemory = _data; }
-
-    std::span<uint8_t> DataAsMemory; // useless in c++
+    RxFrame(const std::span<uint8_t> &data) : _data(data) {}
 
     std::span<uint8_t> ControlField() const { return {_data.data(), 2}; }
 
@@ -41,23 +100,27 @@ class RxFrame {
 
     std::span<uint8_t> SequenceControl() const { return {_data.data() + 22, 2}; }
 
-    std::span<uint8_t> PayloadSpan() const { return {_data.data() + 24, _data.size() - 28}; }
+    std::span<uint8_t> PayloadSpan() const {
+        return {_data.data() + WfbHeader::SIZE, _data.size() - WfbHeader::SIZE - WfbHeader::FCS_SIZE};
+    }
 
-    std::span<uint8_t> GetNonce() const {
+    // By value, the two halves are not contiguous in the frame
+    std::array<uint8_t, 8> GetNonce() const {
         std::array<uint8_t, 8> data;
         std::copy(_data.begin() + 11, _data.begin() + 15, data.begin());
         std::copy(_data.begin() + 17, _data.begin() + 21, data.begin() + 4);
-        return {data.data(), data.size()};
+        return data;
     }
 
+    uint8_t GetRadioPort() const { return _data[WfbHeader::SRC_RADIO_PORT]; }
+
     //    RadioPort get_valid_radio_port() const {
     //        return RadioPort::Fromuint8_t(_data[15]);
     //    }
 
     bool IsValidWfbFrame() const {
-        if (_data.empty()) return false;
+        if (_data.size() <= WfbHeader::SIZE + WfbHeader::FCS_SIZE) return false;
         if (!IsDataFrame()) return false;
-        if (PayloadSpan().empty()) return false;
         if (!HasValidAirGndId()) return false;
         if (!HasValidRadioPort()) return false;
         // TODO: add `frame.PayloadSpan().size() > RAW_WIFI_FRAME_MAX_PAYLOAD_SIZE`
@@ -73,15 +136,30 @@ class RxFrame {
         }
     }
 
+    // channelIdBe: the channel id in network byte order, as it is in the frame
+    bool MatchesChannelID(const uint32_t channelIdBe) const {
+        return Load32(WfbHeader::SRC_CHANNEL_ID) == channelIdBe && Load32(WfbHeader::DST_CHANNEL_ID) == channelIdBe &&
+               HasMagic(WfbHeader::SRC_MAC) && HasMagic(WfbHeader::DST_MAC);
+    }
+
     bool MatchesChannelID(const uint8_t *channel_id) const {
-        //        0x57, 0x42, 0xaa, 0xbb, 0xcc, 0xdd,   // last four bytes are replaced by channel_id (x2)
-        return _data[10] == 0x57 && _data[11] == 0x42 && _data[12] == channel_id[0] && _data[13] == channel_id[1] &&
-               _data[14] == channel_id[2] && _data[15] == channel_id[3] && _data[16] == 0x57 && _data[17] == 0x42 &&
-               _data[18] == channel_id[0] && _data[19] == channel_id[1] && _data[20] == channel_id[2] &&
-               _data[21] == channel_id[3];
+        uint32_t channelIdBe;
+        memcpy(&channelIdBe, channel_id, sizeof(channelIdBe));
+        return MatchesChannelID(channelIdBe);
     }
 
   private:
+    // Unaligned, compiles to a single load
+    uint32_t Load32(const size_t offset) const {
+        uint32_t ret;
+        memcpy(&ret, _data.data() + offset, sizeof(ret));
+        return ret;
+    }
+
+    bool HasMagic(const size_t offset) const {
+        return _data[offset] == WfbHeader::MAGIC[0] && _data[offset + 1] == WfbHeader::MAGIC[1];
+    }
+
     bool IsDataFrame() const { return _data.size() >= 2 && _data[0] == _dataHeader[0] && _data[1] == _dataHeader[1]; }
 
     bool HasValidAirGndId() const { return _data.size() >= 18 && _data[10] == _data[16]; }
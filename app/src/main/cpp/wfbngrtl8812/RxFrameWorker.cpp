@@ -0,0 +1,86 @@
+#include "RxFrameWorker.h"
+#include <cstring>
+#include <pthread.h>
+
+RxFrameWorker::RxFrameWorker(Handler handler) : mHandler(std::move(handler)), mBuffers(N_BUFFERS) {
+    for (auto &buffer : mBuffers) {
+        mFreeBuffers.push(&buffer);
+    }
+}
+
+RxFrameWorker::~RxFrameWorker() { stop(); }
+
+void RxFrameWorker::start() {
+    stop();
+    mStop = false;
+    mThread = std::make_unique<std::thread>(&RxFrameWorker::loop, this);
+    pthread_setname_np(mThread->native_handle(), "WfbRxWorker");
+}
+
+void RxFrameWorker::stop() {
+    if (!mThread) return;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_one();
+    mThread->join();
+    mThread.reset();
+}
+
+bool RxFrameWorker::push(const uint8_t radioPort, const uint8_t *payload, const size_t payloadSize, const RxInfo &info) {
+    if (payloadSize > MAX_PAYLOAD_SIZE) {
+        nTooLarge++;
+        return false;
+    }
+    Buffer *buffer;
+    if (!mFreeBuffers.pop(buffer)) {
+        nDropped++;
+        return false;
+    }
+    buffer->radioPort = radioPort;
+    buffer->size = (uint16_t)payloadSize;
+    buffer->info = info;
+    memcpy(buffer->data.data(), payload, payloadSize);
+    // Cannot fail, there are only N_BUFFERS buffers
+    mFullBuffers.push(buffer);
+    const size_t occupancy = mFullBuffers.size();
+    if (occupancy > mMaxOccupancy.load(std::memory_order_relaxed)) {
+        mMaxOccupancy.store(occupancy, std::memory_order_relaxed);
+    }
+    // Pairs with the fence in loop(): either the worker sees the new buffer or we see that it is waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mWaiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCondition.notify_one();
+    }
+    return true;
+}
+
+void RxFrameWorker::loop() {
+    while (true) {
+        Buffer *buffer;
+        if (!mFullBuffers.pop(buffer)) {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (mStop && mFullBuffers.empty()) return;
+            mWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            mCondition.wait(lock, [this] { return mStop || !mFullBuffers.empty(); });
+            mWaiting.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        mHandler(buffer->radioPort, buffer->data.data(), buffer->size, buffer->info);
+        nProcessed++;
+        mFreeBuffers.push(buffer);
+    }
+}
+
+RxFrameWorker::Stats RxFrameWorker::getStats() const {
+    Stats ret;
+    ret.nProcessed = nProcessed;
+    ret.nDropped = nDropped;
+    ret.nTooLarge = nTooLarge;
+    ret.occupancy = mFullBuffers.size();
+    ret.maxOccupancy = mMaxOccupancy.load(std::memory_order_relaxed);
+    return ret;
+}
@@ -0,0 +1,74 @@
+#ifndef FPV_VR_RX_FRAME_WORKER_H
+#define FPV_VR_RX_FRAME_WORKER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../videonative/helper/SPSCQueue.hpp"
+#include "RxFrame.h"
+
+// Runs the expensive part of the receive path (decryption and FEC recovery in the aggregators) on its own thread, such
+// that the USB thread is back for the next bulk transfer before the adapter's RX FIFO overflows.
+// push() is called by the USB thread: it copies the payload into one of the pooled buffers (allocated once) and hands
+// it over through a lock-free queue, it never blocks. If the worker fell behind and no buffer is free the frame is
+// dropped and counted - as the FIFO would have done, but without stalling the frames that follow.
+class RxFrameWorker {
+  public:
+    using Handler = std::function<void(uint8_t radioPort, const uint8_t *payload, size_t payloadSize, const RxInfo &info)>;
+    // Larger than any wfb-ng packet
+    static constexpr size_t MAX_PAYLOAD_SIZE = 4096;
+    // ~1.5MB of 1500 byte frames, 60ms at 200MBit/s
+    static constexpr size_t N_BUFFERS = 1024;
+    struct Stats {
+        uint64_t nProcessed = 0;
+        // USB side: no free buffer
+        uint64_t nDropped = 0;
+        // USB side: larger than MAX_PAYLOAD_SIZE
+        uint64_t nTooLarge = 0;
+        // Frames queued for the worker
+        size_t occupancy = 0;
+        size_t maxOccupancy = 0;
+    };
+
+  public:
+    explicit RxFrameWorker(Handler handler);
+    ~RxFrameWorker();
+    RxFrameWorker(const RxFrameWorker &) = delete;
+    void start();
+    // Processes what is still queued, then joins the worker
+    void stop();
+    // USB thread. False if the frame was dropped
+    bool push(uint8_t radioPort, const uint8_t *payload, size_t payloadSize, const RxInfo &info);
+    Stats getStats() const;
+
+  private:
+    struct Buffer {
+        uint8_t radioPort;
+        uint16_t size;
+        RxInfo info;
+        std::array<uint8_t, MAX_PAYLOAD_SIZE> data;
+    };
+    void loop();
+    const Handler mHandler;
+    std::vector<Buffer> mBuffers;
+    // Buffers cycle USB thread -> mFullBuffers -> worker -> mFreeBuffers -> USB thread
+    SPSCQueue<Buffer *, N_BUFFERS> mFreeBuffers;
+    SPSCQueue<Buffer *, N_BUFFERS> mFullBuffers;
+    std::unique_ptr<std::thread> mThread;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    // The USB thread only takes mMutex to wake the worker when it sleeps
+    std::atomic<bool> mWaiting = false;
+    bool mStop = false;
+    std::atomic<uint64_t> nProcessed{0};
+    std::atomic<uint64_t> nDropped{0};
+    std::atomic<uint64_t> nTooLarge{0};
+    std::atomic<size_t> mMaxOccupancy{0};
+};
+
+#endif // FPV_VR_RX_FRAME_WORKER_H
@@ -0,0 +1,95 @@
+#ifndef FPV_VR_SIGNAL_QUALITY_H
+#define FPV_VR_SIGNAL_QUALITY_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "RxFrame.h"
+
+// Per antenna RSSI / SNR of the received wfb-ng frames, aggregated in windows of 100ms and kept for the last 64
+// windows. Written by the receiving thread, read by the OSD and link adaptation logic.
+class SignalQuality {
+  public:
+    static constexpr std::chrono::milliseconds WINDOW{100};
+    static constexpr size_t HISTORY = 64;
+    struct Antenna {
+        uint32_t nPackets = 0;
+        int8_t rssiMin = 0;
+        int8_t rssiMax = 0;
+        float rssiAvg = 0;
+        float snrAvg = 0;
+    };
+    struct Window {
+        std::chrono::steady_clock::time_point start;
+        std::array<Antenna, RxInfo::MAX_ANTENNAS> antennas;
+        // Of the last frame in the window
+        uint8_t dataRate = 0;
+    };
+
+  public:
+    // Receiving thread
+    void add(const RxInfo &info, const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mNWindows == 0 || now - mWindows[mCurrent].start >= WINDOW) {
+            beginWindow(now);
+        }
+        Window &window = mWindows[mCurrent];
+        for (size_t i = 0; i < RxInfo::MAX_ANTENNAS; i++) {
+            if (info.antenna[i] == 0xff) break;
+            const size_t index = std::min<size_t>(info.antenna[i], RxInfo::MAX_ANTENNAS - 1);
+            Antenna &antenna = window.antennas[index];
+            const int8_t rssi = info.rssi[i];
+            if (antenna.nPackets == 0) {
+                antenna.rssiMin = antenna.rssiMax = rssi;
+            }
+            antenna.rssiMin = std::min(antenna.rssiMin, rssi);
+            antenna.rssiMax = std::max(antenna.rssiMax, rssi);
+            mRssiSum[index] += rssi;
+            mSnrSum[index] += rssi - info.noise[i];
+            antenna.nPackets++;
+            antenna.rssiAvg = (float)mRssiSum[index] / (float)antenna.nPackets;
+            antenna.snrAvg = (float)mSnrSum[index] / (float)antenna.nPackets;
+        }
+        window.dataRate = info.dataRate;
+    }
+    // The newest window with at least one frame, nullopt if nothing was received for stale
+    std::optional<Window> getLatest(const std::chrono::nanoseconds stale = std::chrono::seconds(1)) const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mNWindows == 0 || std::chrono::steady_clock::now() - mWindows[mCurrent].start > stale) {
+            return std::nullopt;
+        }
+        return mWindows[mCurrent];
+    }
+    // Oldest first
+    std::vector<Window> getHistory() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::vector<Window> ret;
+        ret.reserve(mNWindows);
+        for (size_t i = 0; i < mNWindows; i++) {
+            ret.push_back(mWindows[(mCurrent + HISTORY - mNWindows + 1 + i) % HISTORY]);
+        }
+        return ret;
+    }
+
+  private:
+    void beginWindow(const std::chrono::steady_clock::time_point now) {
+        mCurrent = mNWindows == 0 ? 0 : (mCurrent + 1) % HISTORY;
+        mNWindows = std::min(mNWindows + 1, HISTORY);
+        mWindows[mCurrent] = Window{now, {}, 0};
+        mRssiSum.fill(0);
+        mSnrSum.fill(0);
+    }
+    mutable std::mutex mMutex;
+    std::array<Window, HISTORY> mWindows{};
+    size_t mCurrent = 0;
+    size_t mNWindows = 0;
+    // Of the current window
+    std::array<int64_t, RxInfo::MAX_ANTENNAS> mRssiSum{};
+    std::array<int64_t, RxInfo::MAX_ANTENNAS> mSnrSum{};
+};
+
+#endif // FPV_VR_SIGNAL_QUALITY_H
@@ -16,6 +16,8 @@
 #include "devourer/src/WiFiDriver.h"
 #include "wfb-ng/src/wifibroadcast.hpp"
 #include "RxFrame.h"
+#include "MultiRadioDevice.h"
+#include "Rtl8812RadioDevice.h"
 
 #include <sstream>
 #include <iostream>
@@ -31,9 +33,10 @@ std::string uint8_to_hex_string(const uint8_t *v, const size_t s) {
     return ss.str();
 }
 
-WfbngLink::WfbngLink(JNIEnv* env, int fd, const char* key): fd(fd), aggregator(nullptr), keyPath(key) {}
+WfbngLink::WfbngLink(JNIEnv* env, std::vector<int> fds, const char* key): fds(std::move(fds)), aggregator(nullptr), keyPath(key) {}
 
 int WfbngLink::run(JNIEnv* env, int wifiChannel) {
+    channel = wifiChannel;
     int r;
     libusb_context *ctx = NULL;
 
@@ -46,99 +49,178 @@ int WfbngLink::run(JNIEnv* env, int wifiChannel) {
         return r;
     }
 
-    struct libusb_device_handle *dev_handle;
-    r = libusb_wrap_sys_device(ctx, (intptr_t) fd, &dev_handle);
-    __android_log_print(ANDROID_LOG_DEBUG, TAG, "libusb_wrap_sys_device: %d", r);
-    if (r < 0) {
-        libusb_exit(ctx);
-        return r;
-    }
-
-    /*Check if kenel driver attached*/
-    if (libusb_kernel_driver_active(dev_handle, 0)) {
-        r = libusb_detach_kernel_driver(dev_handle, 0); // detach driver
-        __android_log_print(ANDROID_LOG_DEBUG, TAG, "libusb_detach_kernel_driver: %d", r);
-
-    }
-    r = libusb_claim_interface(dev_handle, 0);
-    __android_log_print(ANDROID_LOG_DEBUG, TAG, "libusb_claim_interface: %d", r);
-
+    // One Rtl8812aDevice per adapter, all of them feed the same aggregators
     Logger_t log;
     WiFiDriver wifi_driver(log);
-    rtlDevice = wifi_driver.CreateRtlDevice(dev_handle);
-    if (!rtlDevice) {
-        __android_log_print(ANDROID_LOG_DEBUG, TAG,
-                            "CreateRtlDevice error");
-    } else {
+    std::vector<libusb_device_handle *> dev_handles;
+    std::vector<std::unique_ptr<RadioDevice>> devices;
+    for (const int fd : fds) {
+        struct libusb_device_handle *dev_handle;
+        r = libusb_wrap_sys_device(ctx, (intptr_t) fd, &dev_handle);
+        __android_log_print(ANDROID_LOG_DEBUG, TAG, "libusb_wrap_sys_device(%d): %d", fd, r);
+        if (r < 0) {
+            continue;
+        }
+        dev_handles.push_back(dev_handle);
+
+        /*Check if kenel driver attached*/
+        if (libusb_kernel_driver_active(dev_handle, 0)) {
+            r = libusb_detach_kernel_driver(dev_handle, 0); // detach driver
+            __android_log_print(ANDROID_LOG_DEBUG, TAG, "libusb_detach_kernel_driver: %d", r);
+
+        }
+        r = libusb_claim_interface(dev_handle, 0);
+        __android_log_print(ANDROID_LOG_DEBUG, TAG, "libusb_claim_interface: %d", r);
+
+        auto rtlDevice = wifi_driver.CreateRtlDevice(dev_handle);
+        if (!rtlDevice) {
+            __android_log_print(ANDROID_LOG_DEBUG, TAG,
+                                "CreateRtlDevice error");
+            continue;
+        }
         __android_log_print(ANDROID_LOG_DEBUG, TAG,
                             "CreateRtlDevice success");
+        devices.push_back(std::make_unique<Rtl8812RadioDevice>(std::move(rtlDevice)));
+        if (devices.size() == MultiRadioDevice::MAX_ADAPTERS) {
+            break;
+        }
     }
+    if (devices.empty()) {
+        releaseDevices(ctx, dev_handles);
+        return -1;
+    }
+    std::unique_ptr<RadioDevice> device = devices.size() == 1 ? std::move(devices.front())
+                                                              : std::make_unique<MultiRadioDevice>(std::move(devices));
 
     // Config
     // TODO(geehe) Get that form the android UI.
     int video_client_port = 5600;
     int mavlink_client_port = 14550;
     std::string client_addr = "127.0.0.1";
-    uint32_t link_id = 7669206 ; // sha1 hash of link_domain="default"
+    uint32_t link_id = DEFAULT_LINK_ID;
     uint8_t video_radio_port = 0;
     uint8_t mavlink_radio_port = 0x10;
     uint64_t epoch = 0;
 
-    uint32_t video_channel_id_f = (link_id << 8) + video_radio_port;
-    uint32_t video_channel_id_be = htobe32(video_channel_id_f);
-    uint8_t* video_channel_id_be8 = reinterpret_cast<uint8_t *>(&video_channel_id_be);
-
-    uint32_t mavlink_channel_id_f = (link_id << 8) + mavlink_radio_port;
-    uint32_t mavlink_channel_id_be = htobe32(mavlink_channel_id_f);
-    uint8_t* mavlink_channel_id_be8 = reinterpret_cast<uint8_t *>(&mavlink_channel_id_be);
+    uint32_t video_channel_id_f = WfbHeader::channelId(link_id, video_radio_port);
+    uint32_t mavlink_channel_id_f = WfbHeader::channelId(link_id, mavlink_radio_port);
 
     try {
         Aggregator video_agg(client_addr, video_client_port, keyPath, epoch, video_channel_id_f);
         aggregator = &video_agg;
         Aggregator mavlink_agg(client_addr, mavlink_client_port, keyPath, epoch, mavlink_channel_id_f);
 
-        auto packetProcessor = [&video_agg, video_channel_id_be8, &mavlink_agg, mavlink_channel_id_be8](const Packet &packet) {
-            RxFrame frame(packet.Data);
-            if (!frame.IsValidWfbFrame()) {
-                return;
-            }
-            // TODO(geehe) Get data from libusb?
-            int8_t rssi[4] = {1,1,1,1};
-            uint32_t freq = 0;
-            int8_t noise[4] = {1,1,1,1};
-            uint8_t antenna[4] = {1,1,1,1};
-            if (frame.MatchesChannelID(video_channel_id_be8)) {
-                video_agg.process_packet(packet.Data.data() + sizeof(ieee80211_header), packet.Data.size() - sizeof(ieee80211_header) - 4, 0, antenna, rssi, noise, freq, NULL);
-            } else if (frame.MatchesChannelID(mavlink_channel_id_be8)) {
-                mavlink_agg.process_packet(packet.Data.data() + sizeof(ieee80211_header), packet.Data.size() - sizeof(ieee80211_header) - 4, 0, antenna, rssi, noise, freq, NULL);
-            }
-        };
-
-        rtlDevice->Init(packetProcessor, SelectedChannel{
-                .Channel = static_cast<uint8_t>(wifiChannel),
-                .ChannelOffset = 0,
-                .ChannelWidth = CHANNEL_WIDTH_20,
-        });
+        // While receiving, retune() only reprograms the RF channel of it
+        const auto radioReceiver = std::make_shared<RadioReceiver>(std::move(device), signalQuality);
+        for (auto [radio_port, agg] : {std::pair{video_radio_port, &video_agg}, std::pair{mavlink_radio_port, &mavlink_agg}}) {
+            radioReceiver->getDispatcher().registerHandler(link_id, radio_port, [agg](const uint8_t *payload, size_t payload_size, const RxInfo &info) {
+                agg->process_packet(payload, payload_size, 0, info.antenna.data(), info.rssi.data(), info.noise.data(), info.freq, NULL);
+            });
+        }
+        // Without frames on wifiChannel the scanner looks for the link on the other channels
+        const auto channelScanner = std::make_shared<ChannelScanner>(
+            scanChannels, [receiver = radioReceiver.get()](uint8_t channel) { return receiver->retune(channel); },
+            static_cast<uint8_t>(wifiChannel), ChannelScanner::Options{});
+        radioReceiver->setFrameObserver([scanner = channelScanner.get()](const RxInfo &info) { scanner->onFrame(info); });
+        radioReceiver->setFrameRecorder(frameRecorder);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            receiver = radioReceiver;
+            scanner = channelScanner;
+        }
+        channelScanner->start();
+        radioReceiver->run(static_cast<uint8_t>(wifiChannel));
+        // Waits for the calls of the other threads that are in flight
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            scanner.reset();
+            receiver.reset();
+        }
+        // Not while it was hopping, the link was not found then
+        const auto scanStats = channelScanner->getStats();
+        if (scanStats.state == ChannelScanner::State::LOCKED && scanStats.channel != 0) {
+            channel = scanStats.channel;
+        }
+        channelScanner->stop();
 
     } catch (const std::runtime_error& error) {
         __android_log_print(ANDROID_LOG_ERROR, TAG,
                             "runtime_error: %s", error.what());
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            scanner.reset();
+            receiver.reset();
+        }
+        releaseDevices(ctx, dev_handles);
         return -1;
     }
 
     __android_log_print(ANDROID_LOG_DEBUG, TAG, "Init done, releasing...");
 
-    r = libusb_release_interface(dev_handle, 0);
-    __android_log_print(ANDROID_LOG_DEBUG, TAG, "libusb_release_interface: %d", r);
+    releaseDevices(ctx, dev_handles);
+
+    return 0;
+}
 
+void WfbngLink::releaseDevices(libusb_context *ctx, const std::vector<libusb_device_handle *> &dev_handles) {
+    for (auto dev_handle : dev_handles) {
+        int r = libusb_release_interface(dev_handle, 0);
+        __android_log_print(ANDROID_LOG_DEBUG, TAG, "libusb_release_interface: %d", r);
+    }
     libusb_exit(ctx);
+}
 
-    return 0;
+bool WfbngLink::retune(int wifiChannel) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    channel = wifiChannel;
+    if (!receiver) {
+        return false;
+    }
+    if (!receiver->retune(static_cast<uint8_t>(wifiChannel))) {
+        return false;
+    }
+    if (scanner) {
+        scanner->onManualRetune(static_cast<uint8_t>(wifiChannel));
+    }
+    const auto stats = receiver->getRetuneStats();
+    __android_log_print(ANDROID_LOG_DEBUG, TAG, "Retuned to channel %d in %.2fms", wifiChannel,
+                        stats.lastProgram.count() / 1000.0);
+    return true;
+}
+
+RadioReceiver::RetuneStats WfbngLink::getRetuneStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return receiver ? receiver->getRetuneStats() : RadioReceiver::RetuneStats{};
+}
+
+bool WfbngLink::scan() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!scanner) {
+        return false;
+    }
+    scanner->scan();
+    return true;
+}
+
+ChannelScanner::Stats WfbngLink::getScanStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return scanner ? scanner->getStats() : ChannelScanner::Stats{};
+}
+
+RadioReceiver::DiversityStats WfbngLink::getDiversityStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return receiver ? receiver->getDiversityStats() : RadioReceiver::DiversityStats{};
+}
+
+RxFrameWorker::Stats WfbngLink::getWorkerStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return receiver ? receiver->getWorkerStats() : RxFrameWorker::Stats{};
 }
 
 void WfbngLink::stop(JNIEnv* env) {
-    if (rtlDevice) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (receiver) {
         __android_log_print(ANDROID_LOG_ERROR, TAG, "Stopping rtlDevice");
-        rtlDevice->should_stop = true;
+        receiver->stop();
     }
-}
\ No newline at end of file
+}
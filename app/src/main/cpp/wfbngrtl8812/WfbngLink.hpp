@@ -2,21 +2,54 @@
 #define FPV_VR_WFBNG_LINK_H
 
 #include <jni.h>
+#include <atomic>
+#include <mutex>
 #include "wfb-ng/src/rx.hpp"
 #include "devourer/src/WiFiDriver.h"
+#include "ChannelScanner.h"
+#include "RadioReceiver.h"
+#include "SignalQuality.h"
 
 class WfbngLink{
 public:
     WfbngLink() = default;
-    WfbngLink(JNIEnv * env, int fd, const char *key);
+    // One fd per RTL8812 adapter, their frames are merged (diversity receive)
+    WfbngLink(JNIEnv * env, std::vector<int> fds, const char *key);
     int run(JNIEnv *env, int wifiChannel);
+    // Moves the running link to another channel, keeping USB, firmware and the aggregators. False if not running,
+    // getChannel() returns wifiChannel anyways
+    bool retune(int wifiChannel);
+    // The channel to run() on next: the one the scanner locked onto or retune() was asked for, kept when run() returns
+    int getChannel() const { return channel; }
+    RadioReceiver::RetuneStats getRetuneStats() const;
+    // Scans scanChannels for the strongest signal of our link and locks onto it. False if not running
+    bool scan();
+    ChannelScanner::Stats getScanStats() const;
+    // Decryption / FEC worker: queue occupancy and the frames the USB thread had to drop
+    RxFrameWorker::Stats getWorkerStats() const;
+    // Per adapter RSSI and how many frames each one contributed first
+    RadioReceiver::DiversityStats getDiversityStats() const;
     void stop(JNIEnv *env);
     Aggregator* aggregator;
+    // Per antenna RSSI / SNR of the received wfb-ng frames, for the OSD and link adaptation
+    std::shared_ptr<SignalQuality> signalQuality = std::make_shared<SignalQuality>();
+    // Raw capture of the received frames (before FEC), start() / stop() it any time
+    std::shared_ptr<PcapngRecorder> frameRecorder = std::make_shared<PcapngRecorder>();
+    // Searched when the link is lost (or on scan()), set before run()
+    std::vector<uint8_t> scanChannels;
+    // sha1 hash of link_domain="default"
+    static constexpr uint32_t DEFAULT_LINK_ID = 7669206;
 
 private:
     const char *keyPath;
-    int fd;
-    std::unique_ptr<Rtl8812aDevice> rtlDevice;
+    std::vector<int> fds;
+    // Set while run() receives. Held while they are used by the other threads (retune(), scan(), the stats, stop()),
+    // such that run() only deletes them once no call is in flight
+    mutable std::mutex mMutex;
+    std::shared_ptr<RadioReceiver> receiver;
+    std::shared_ptr<ChannelScanner> scanner;
+    std::atomic<int> channel{0};
+    static void releaseDevices(libusb_context *ctx, const std::vector<libusb_device_handle *> &dev_handles);
     bool should_stop;
 };
 
@@ -0,0 +1,142 @@
+// Host benchmark of the raw frame capture (PcapngRecorder) on the USB thread: two adapters receive every fragment of a
+// wfb-ng stream (the second one misses some), each copy is recorded like RadioReceiver does it. Prints how long
+// onFrame() blocks the USB thread, the bytes written and the frames dropped because the I/O thread fell behind.
+// First at a fixed frame rate (a fast link), then as fast as possible to overload the I/O thread.
+// The capture of the paced run is replayed through PcapRadioDevice and a RadioReceiver: every recorded frame must come
+// back with its adapter and RSSI, in real time.
+//
+// Usage: CaptureBenchmark [nFrames=100000] [framePeriodUs=50] [directory=/tmp]
+
+#include "../MockRadioDevice.h"
+#include "../PcapRadioDevice.h"
+#include "../PcapngRecorder.h"
+#include "../Radiotap.h"
+#include "../RadioReceiver.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+    constexpr uint32_t LINK_ID = 7669206;
+    constexpr uint8_t VIDEO_RADIO_PORT = 0;
+    constexpr uint8_t CHANNEL = 149;
+    constexpr size_t PAYLOAD_SIZE = 1400;
+    constexpr int N_ADAPTERS = 2;
+
+    struct Recorded {
+        // Per adapter
+        std::array<uint64_t, N_ADAPTERS> nFrames{};
+        std::array<int64_t, N_ADAPTERS> rssiSum{};
+        std::set<uint64_t> nonces;
+        PcapngRecorder::Stats stats;
+        std::vector<nanoseconds> onFrameTimes;
+    };
+
+    // framePeriod 0: as fast as possible
+    bool record(const std::string &path, const int nFrames, const microseconds framePeriod, Recorded &recorded) {
+        // The capture of an earlier run would be truncated on the I/O thread while the frames already arrive, which
+        // takes longer than the batches buffer. The app always starts a new file
+        std::remove(path.c_str());
+        PcapngRecorder recorder;
+        if (!recorder.start(path)) return false;
+        auto frame = MockRadioDevice::createFrame(LINK_ID, VIDEO_RADIO_PORT, PAYLOAD_SIZE);
+        std::mt19937 random(1);
+        RxInfo info;
+        info.freq = RxInfo::channelToFrequency(CHANNEL);
+        info.dataRate = Radiotap::RTL_HT_MCS0 + 1;
+        info.noise.fill(-92);
+        recorded.onFrameTimes.reserve(size_t(nFrames) * N_ADAPTERS);
+        const auto start = steady_clock::now();
+        const auto captureStart = system_clock::now();
+        for (int i = 0; i < nFrames; i++) {
+            if (framePeriod.count() > 0 && i % 16 == 0) {
+                std::this_thread::sleep_until(start + framePeriod * i);
+            }
+            MockRadioDevice::setNonce(frame, (uint64_t)i);
+            for (int adapter = 0; adapter < N_ADAPTERS; adapter++) {
+                if (adapter > 0 && random() % 4 == 0) continue;
+                info.adapter = (uint8_t)adapter;
+                for (size_t antenna = 0; antenna < 2; antenna++) {
+                    info.antenna[antenna] = uint8_t(adapter * 2 + antenna);
+                    info.rssi[antenna] = (int8_t)(-55 - adapter * 6 - (int)(random() % 10));
+                }
+                const auto before = steady_clock::now();
+                recorder.onFrame(frame, info, captureStart + framePeriod * i);
+                recorded.onFrameTimes.push_back(steady_clock::now() - before);
+                recorded.nFrames[adapter]++;
+                recorded.rssiSum[adapter] += std::max(info.rssi[0], info.rssi[1]);
+            }
+            recorded.nonces.insert((uint64_t)i);
+        }
+        recorder.stop();
+        recorder.waitUntilClosed();
+        recorded.stats = recorder.getStats();
+        return true;
+    }
+
+    void print(const char *name, const Recorded &recorded, const double seconds) {
+        auto times = recorded.onFrameTimes;
+        std::sort(times.begin(), times.end());
+        auto percentile = [&](const double p) { return (double)times[size_t(p / 100 * (double)(times.size() - 1))].count() / 1000.0; };
+        printf("%s: onFrame p50 %.2fus p99 %.2fus max %.1fus, frames %llu dropped %llu write errors %llu, %.1fMB written "
+               "(%.0fMB/s)\n",
+               name, percentile(50), percentile(99), percentile(100), (unsigned long long)recorded.stats.nFramesRecorded,
+               (unsigned long long)recorded.stats.nFramesDropped, (unsigned long long)recorded.stats.nWriteErrors,
+               (double)recorded.stats.nBytesWritten / (1024.0 * 1024.0), (double)recorded.stats.nBytesWritten / (1024.0 * 1024.0) / seconds);
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    const int nFrames = argc > 1 ? atoi(argv[1]) : 100000;
+    const microseconds framePeriod(argc > 2 ? atoi(argv[2]) : 50);
+    const std::string directory = argc > 3 ? argv[3] : "/tmp";
+    const std::string paced = directory + "/capture_paced.pcapng";
+    const std::string burst = directory + "/capture_burst.pcapng";
+
+    bool ok = true;
+    Recorded pacedRecorded;
+    auto before = steady_clock::now();
+    if (!record(paced, nFrames, framePeriod, pacedRecorded)) {
+        printf("cannot write %s\n", paced.c_str());
+        return 1;
+    }
+    print("paced", pacedRecorded, duration<double>(steady_clock::now() - before).count());
+    Recorded burstRecorded;
+    before = steady_clock::now();
+    if (!record(burst, nFrames, microseconds(0), burstRecorded)) {
+        printf("cannot write %s\n", burst.c_str());
+        return 1;
+    }
+    print("burst", burstRecorded, duration<double>(steady_clock::now() - before).count());
+    const uint64_t nBurstFrames = burstRecorded.onFrameTimes.size();
+    ok = ok && burstRecorded.stats.nFramesRecorded + burstRecorded.stats.nFramesDropped == nBurstFrames;
+
+    // Everything recorded comes back, the first copy of each fragment reaches the handler. With the original timing, as
+    // fast as possible the RxFrameWorker would drop
+    RadioReceiver receiver(PcapRadioDevice::openMerged({paced}, 1.0), nullptr);
+    std::set<uint64_t> delivered;
+    uint64_t nDeliveredTwice = 0;
+    receiver.getDispatcher().registerHandler(LINK_ID, VIDEO_RADIO_PORT, [&](const uint8_t *payload, size_t, const RxInfo &) {
+        if (!delivered.insert(WfbPacket::nonce(payload)).second) nDeliveredTwice++;
+    });
+    receiver.run(CHANNEL);
+    const auto diversity = receiver.getDiversityStats();
+    for (int adapter = 0; adapter < N_ADAPTERS; adapter++) {
+        const auto &stats = diversity.adapters[adapter];
+        const double expectedRssi = (double)pacedRecorded.rssiSum[adapter] / (double)std::max<uint64_t>(pacedRecorded.nFrames[adapter], 1);
+        printf("replay adapter %d: frames %llu/%llu rssi %.2fdBm/%.2fdBm\n", adapter, (unsigned long long)stats.nFrames,
+               (unsigned long long)pacedRecorded.nFrames[adapter], stats.getRssiAvg(), expectedRssi);
+        ok = ok && stats.nFrames == pacedRecorded.nFrames[adapter] && stats.rssiSum == pacedRecorded.rssiSum[adapter];
+    }
+    printf("replay: fragments %zu/%zu delivered twice %llu worker drops %llu\n", delivered.size(), pacedRecorded.nonces.size(),
+           (unsigned long long)nDeliveredTwice, (unsigned long long)receiver.getWorkerStats().nDropped);
+    ok = ok && pacedRecorded.stats.nFramesDropped == 0 && pacedRecorded.stats.nWriteErrors == 0 &&
+         delivered == pacedRecorded.nonces && nDeliveredTwice == 0;
+    printf("capture: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
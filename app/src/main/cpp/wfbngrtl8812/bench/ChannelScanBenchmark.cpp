@@ -0,0 +1,85 @@
+// Host benchmark of the automatic channel scan, with a MockRadioDevice instead of the adapter.
+// Our drone is heard strong on one channel and weak (a reflection, a second drone of the same link) on another, a
+// drone of another link id is on a third channel. For each dwell time the scanner has to lock onto the strong channel,
+// then the drone moves to another channel and the scanner has to notice the lost link and find it again.
+// Prints the time to lock of the first scan and of the rescan (including the lost timeout).
+//
+// Usage: ChannelScanBenchmark [framePeriodUs=1000] [lostTimeoutMs=500]
+
+#include "../ChannelScanner.h"
+#include "../MockRadioDevice.h"
+#include "../RadioReceiver.h"
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+    constexpr uint32_t LINK_ID = 7669206;
+    constexpr uint32_t OTHER_LINK_ID = 1234567;
+    constexpr uint8_t VIDEO_RADIO_PORT = 0;
+    const std::vector<uint8_t> CHANNELS = {36, 40, 44, 48, 52, 56, 60, 64, 100, 104, 108, 112, 116, 120,
+                                           124, 128, 132, 136, 140, 144, 149, 153, 157, 161, 165, 169, 171, 173};
+    constexpr uint8_t STRONG_CHANNEL = 149;
+    constexpr uint8_t WEAK_CHANNEL = 36;
+    constexpr uint8_t OTHER_LINK_CHANNEL = 161;
+    constexpr uint8_t MOVED_CHANNEL = 60;
+
+    bool waitForLock(const ChannelScanner &scanner, const uint64_t nScans, const milliseconds timeout) {
+        const auto start = steady_clock::now();
+        while (steady_clock::now() - start < timeout) {
+            const auto stats = scanner.getStats();
+            if (stats.state == ChannelScanner::State::LOCKED && stats.nScans >= nScans) return true;
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+        return false;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    const auto framePeriod = microseconds(argc > 1 ? atoi(argv[1]) : 1000);
+    const auto lostTimeout = milliseconds(argc > 2 ? atoi(argv[2]) : 500);
+    bool ok = true;
+    for (const int dwellMs : {50, 100, 150}) {
+        MockRadioDevice::Options options;
+        options.framePeriod = framePeriod;
+        options.transmitters.push_back({LINK_ID, VIDEO_RADIO_PORT, STRONG_CHANNEL, -45});
+        options.transmitters.push_back({LINK_ID, VIDEO_RADIO_PORT, WEAK_CHANNEL, -80});
+        options.transmitters.push_back({OTHER_LINK_ID, VIDEO_RADIO_PORT, OTHER_LINK_CHANNEL, -30});
+        auto device = std::make_unique<MockRadioDevice>(options);
+        MockRadioDevice &mock = *device;
+        RadioReceiver receiver(std::move(device), nullptr);
+        receiver.getDispatcher().registerHandler(LINK_ID, VIDEO_RADIO_PORT, [](const uint8_t *, size_t, const RxInfo &) {});
+        ChannelScanner::Options scanOptions;
+        scanOptions.dwell = milliseconds(dwellMs);
+        scanOptions.lostTimeout = lostTimeout;
+        ChannelScanner scanner(CHANNELS, [&receiver](uint8_t channel) { return receiver.retune(channel); }, CHANNELS[0], scanOptions);
+        receiver.setFrameObserver([&scanner](const RxInfo &info) { scanner.onFrame(info); });
+        std::thread receiveThread([&receiver] { receiver.run(CHANNELS[0]); });
+
+        const milliseconds timeout = milliseconds(dwellMs) * CHANNELS.size() * 3 + lostTimeout;
+        scanner.scan();
+        scanner.start();
+        const bool locked = waitForLock(scanner, 1, timeout);
+        const auto first = scanner.getStats();
+        // The drone was re-configured to another channel
+        const auto moved = steady_clock::now();
+        mock.moveTransmitter(0, MOVED_CHANNEL);
+        const bool relocked = locked && waitForLock(scanner, first.nScans + 1, timeout);
+        const auto rescanTime = duration_cast<milliseconds>(steady_clock::now() - moved);
+        const auto second = scanner.getStats();
+        scanner.stop();
+        receiver.stop();
+        receiveThread.join();
+
+        const bool dwellOk = locked && relocked && first.channel == STRONG_CHANNEL && second.channel == MOVED_CHANNEL &&
+                             mock.nReceiveCalls == 1;
+        ok = ok && dwellOk;
+        printf("dwell:%dms time to lock:%lldms channel:%d rescan after move:%lldms (scan %lldms) channel:%d empty scans:%llu %s\n", dwellMs,
+               (long long)first.lastTimeToLock.count(), first.channel, (long long)rescanTime.count(), (long long)second.lastTimeToLock.count(),
+               second.channel, (unsigned long long)second.nEmptyScans, dwellOk ? "ok" : "FAILED");
+    }
+    printf("channel scan: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
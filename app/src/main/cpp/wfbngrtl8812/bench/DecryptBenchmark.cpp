@@ -0,0 +1,201 @@
+// Host benchmark of the BlockDecryptor against the per packet path the Aggregator takes. A wfb-ng stream of FEC blocks
+// (n fragments, some lost, some corrupted such that authentication fails) with a session packet (new key) every
+// sessionEvery packets is decrypted as fast as possible, once packet by packet and once batched with 2..nThreads
+// threads. Both have to deliver the identical sequence of plaintexts to the sink.
+// libsodium is only available for Android (libs/): the stand-in cipher is ChaCha20 (scalar, the keystream of each
+// packet) with a 32 bit tag, a comparable cost per byte.
+// Needs several cores, with one the pool only adds its overhead.
+//
+// Usage: DecryptBenchmark [nPackets=100000] [packetSize=1400] [nThreads=hardware concurrency] [sessionEvery=10000]
+
+#include "../BlockDecryptor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    constexpr int FEC_N = 12;
+    constexpr size_t HEADER_SIZE = WfbPacket::NONCE + WfbPacket::NONCE_SIZE;
+    constexpr size_t TAG_SIZE = 4;
+
+    uint32_t rotl(const uint32_t x, const int n) { return (x << n) | (x >> (32 - n)); }
+
+    void quarterRound(uint32_t *s, const int a, const int b, const int c, const int d) {
+        s[a] += s[b], s[d] = rotl(s[d] ^ s[a], 16);
+        s[c] += s[d], s[b] = rotl(s[b] ^ s[c], 12);
+        s[a] += s[b], s[d] = rotl(s[d] ^ s[a], 8);
+        s[c] += s[d], s[b] = rotl(s[b] ^ s[c], 7);
+    }
+
+    // XORs the ChaCha20 keystream of (key, nonce) into data
+    void chacha20(const uint32_t key, const uint64_t nonce, uint8_t *data, const size_t size) {
+        uint32_t input[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+        for (int i = 0; i < 8; i++) input[4 + i] = key * (i + 1);
+        input[13] = uint32_t(nonce);
+        input[14] = uint32_t(nonce >> 32);
+        for (size_t offset = 0; offset < size; offset += 64) {
+            input[12] = uint32_t(offset / 64);
+            uint32_t state[16];
+            memcpy(state, input, sizeof(state));
+            for (int i = 0; i < 10; i++) {
+                quarterRound(state, 0, 4, 8, 12), quarterRound(state, 1, 5, 9, 13);
+                quarterRound(state, 2, 6, 10, 14), quarterRound(state, 3, 7, 11, 15);
+                quarterRound(state, 0, 5, 10, 15), quarterRound(state, 1, 6, 11, 12);
+                quarterRound(state, 2, 7, 8, 13), quarterRound(state, 3, 4, 9, 14);
+            }
+            uint8_t keystream[64];
+            for (int i = 0; i < 16; i++) {
+                const uint32_t word = state[i] + input[i];
+                memcpy(keystream + i * 4, &word, 4);
+            }
+            for (size_t i = 0; i < 64 && offset + i < size; i++) data[offset + i] ^= keystream[i];
+        }
+    }
+
+    uint32_t tag(const uint32_t key, const uint8_t *data, const size_t size) {
+        uint32_t hash = 2166136261u ^ key;
+        for (size_t i = 0; i < size; i++) hash = (hash ^ data[i]) * 16777619u;
+        return hash;
+    }
+
+    // Data packet: type, nonce, ciphertext, tag. Session packet: type, nonce, the new key
+    struct Stream {
+        std::vector<std::vector<uint8_t>> packets;
+        uint64_t nCorrupted = 0;
+    };
+
+    Stream createStream(const int nPackets, const size_t packetSize, const int sessionEvery) {
+        Stream ret;
+        std::mt19937 random(1);
+        uint32_t key = 1;
+        uint64_t block = 0;
+        int fragment = 0;
+        for (int i = 0; i < nPackets; i++) {
+            std::vector<uint8_t> packet(packetSize);
+            if (i % sessionEvery == 0) {
+                key = (uint32_t)random();
+                packet[0] = WfbPacket::TYPE_SESSION;
+                memcpy(packet.data() + HEADER_SIZE, &key, sizeof(key));
+                ret.packets.push_back(std::move(packet));
+                continue;
+            }
+            // Lost fragments
+            while (random() % 10 == 0) {
+                if (++fragment == FEC_N) block++, fragment = 0;
+            }
+            const uint64_t nonce = (block << 8) | (uint64_t)fragment;
+            if (++fragment == FEC_N) block++, fragment = 0;
+            packet[0] = WfbPacket::TYPE_DATA;
+            for (size_t j = 0; j < WfbPacket::NONCE_SIZE; j++) packet[WfbPacket::NONCE + j] = uint8_t(nonce >> (56 - 8 * j));
+            uint8_t *plaintext = packet.data() + HEADER_SIZE;
+            const size_t plaintextSize = packetSize - HEADER_SIZE - TAG_SIZE;
+            for (size_t j = 0; j < plaintextSize; j++) plaintext[j] = (uint8_t)random();
+            const uint32_t packetTag = tag(key, plaintext, plaintextSize);
+            chacha20(key, nonce, plaintext, plaintextSize);
+            memcpy(plaintext + plaintextSize, &packetTag, TAG_SIZE);
+            if (random() % 100 == 0) {
+                packet[HEADER_SIZE] ^= 1;
+                ret.nCorrupted++;
+            }
+            ret.packets.push_back(std::move(packet));
+        }
+        return ret;
+    }
+
+    // Stands in for the aggregator: the session key, and what reached FEC
+    struct Receiver {
+        std::atomic<uint32_t> key{0};
+        std::vector<uint32_t> delivered;
+
+        bool decrypt(const uint8_t *packet, const size_t size, uint8_t *plaintext, size_t &plaintextSize) const {
+            if (size < HEADER_SIZE + TAG_SIZE) return false;
+            const uint32_t sessionKey = key.load(std::memory_order_relaxed);
+            plaintextSize = size - HEADER_SIZE - TAG_SIZE;
+            memcpy(plaintext, packet + HEADER_SIZE, plaintextSize);
+            chacha20(sessionKey, WfbPacket::nonce(packet), plaintext, plaintextSize);
+            uint32_t packetTag;
+            memcpy(&packetTag, packet + HEADER_SIZE + plaintextSize, TAG_SIZE);
+            return packetTag == tag(sessionKey, plaintext, plaintextSize);
+        }
+        void deliver(const uint8_t *data, const size_t size, const bool decrypted) {
+            if (!decrypted) {
+                uint32_t sessionKey;
+                memcpy(&sessionKey, data + HEADER_SIZE, sizeof(sessionKey));
+                key.store(sessionKey, std::memory_order_relaxed);
+                return;
+            }
+            delivered.push_back(tag(0, data, size));
+        }
+    };
+
+    // Aggregator::process_packet(): one packet after the other
+    double runPerPacket(const Stream &stream, Receiver &receiver) {
+        std::vector<uint8_t> plaintext(BlockDecryptor::MAX_PACKET_SIZE);
+        const auto before = steady_clock::now();
+        for (const auto &packet : stream.packets) {
+            if (packet[0] != WfbPacket::TYPE_DATA) {
+                receiver.deliver(packet.data(), packet.size(), false);
+                continue;
+            }
+            size_t plaintextSize = 0;
+            if (receiver.decrypt(packet.data(), packet.size(), plaintext.data(), plaintextSize)) {
+                receiver.deliver(plaintext.data(), plaintextSize, true);
+            }
+        }
+        return duration<double>(steady_clock::now() - before).count();
+    }
+
+    double runBatched(const Stream &stream, Receiver &receiver, const size_t nThreads, BlockDecryptor::Stats &stats) {
+        BlockDecryptor decryptor(
+            nThreads,
+            [&receiver](const uint8_t *packet, size_t size, uint8_t *plaintext, size_t &plaintextSize) {
+                return receiver.decrypt(packet, size, plaintext, plaintextSize);
+            },
+            [&receiver](const uint8_t *data, size_t size, const RxInfo &, bool decrypted) { receiver.deliver(data, size, decrypted); });
+        const RxInfo info;
+        const auto before = steady_clock::now();
+        for (const auto &packet : stream.packets) {
+            decryptor.push(packet.data(), packet.size(), info);
+        }
+        decryptor.flush();
+        const double seconds = duration<double>(steady_clock::now() - before).count();
+        stats = decryptor.getStats();
+        return seconds;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    const int nPackets = argc > 1 ? atoi(argv[1]) : 100000;
+    const size_t packetSize = argc > 2 ? (size_t)atoi(argv[2]) : 1400;
+    const size_t maxThreads = argc > 3 ? (size_t)atoi(argv[3]) : std::max(2u, std::thread::hardware_concurrency());
+    const int sessionEvery = argc > 4 ? atoi(argv[4]) : 10000;
+    const Stream stream = createStream(nPackets, packetSize, sessionEvery);
+    if (std::thread::hardware_concurrency() < 2) {
+        printf("only %u core, the pool cannot decrypt in parallel\n", std::thread::hardware_concurrency());
+    }
+
+    Receiver reference;
+    const double perPacketSeconds = runPerPacket(stream, reference);
+    printf("per packet:  %8.0f packets/s, delivered %zu authentication failed %llu\n", nPackets / perPacketSeconds,
+           reference.delivered.size(), (unsigned long long)stream.nCorrupted);
+    bool ok = reference.delivered.size() + stream.nCorrupted + (nPackets + sessionEvery - 1) / sessionEvery == (size_t)nPackets;
+    for (size_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        Receiver receiver;
+        BlockDecryptor::Stats stats;
+        const double seconds = runBatched(stream, receiver, nThreads, stats);
+        const bool same = receiver.delivered == reference.delivered && stats.nAuthFailed == stream.nCorrupted;
+        printf("%zu thread%s %8.0f packets/s (%.2fx), batch avg %.1f parallel %llu/%llu, same sequence %s\n", nThreads,
+               nThreads == 1 ? ": " : "s:", nPackets / seconds, perPacketSeconds / seconds, stats.getAvgBatchSize(),
+               (unsigned long long)stats.nParallelBatches, (unsigned long long)stats.nBatches, same ? "yes" : "NO");
+        ok = ok && same;
+    }
+    printf("decrypt: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// Host benchmark of the diversity receive path without adapters: a simulated wfb-ng video stream (FEC blocks of
+// k data + n - k parity fragments) is written as one pcap capture per adapter, each adapter with its own bursty
+// losses (Gilbert-Elliott) and RSSI. The captures are replayed alone and merged (PcapRadioDevice::openMerged) through
+// the RadioReceiver. The handler stands in for the aggregator and counts the FEC blocks with less than k distinct
+// fragments, which FEC cannot recover.
+// Duplicates must never reach the aggregator, and the merged replay must deliver every fragment any adapter received.
+//
+// Usage: DiversityBenchmark [nBlocks=1500] [directory=/tmp] [seed=1]
+
+#include "../PcapRadioDevice.h"
+#include "../Radiotap.h"
+#include "../RadioReceiver.h"
+#include "../MockRadioDevice.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+    constexpr uint32_t LINK_ID = 7669206;
+    constexpr uint8_t VIDEO_RADIO_PORT = 0;
+    constexpr uint8_t CHANNEL = 149;
+    constexpr int FEC_K = 8;
+    constexpr int FEC_N = 12;
+    constexpr int64_t FRAME_PERIOD_US = 100;
+    constexpr size_t PAYLOAD_SIZE = 1200;
+
+    // Loses frames in bursts: rare losses in the good state, most frames in the bad one (a fade of this antenna)
+    struct GilbertElliott {
+        double pGoodToBad;
+        double pBadToGood;
+        double lossGood;
+        double lossBad;
+        bool bad = false;
+        bool lost(std::mt19937 &random) {
+            std::uniform_real_distribution<double> uniform(0, 1);
+            bad = bad ? uniform(random) >= pBadToGood : uniform(random) < pGoodToBad;
+            return uniform(random) < (bad ? lossBad : lossGood);
+        }
+    };
+
+    void put32(FILE *file, const uint32_t value) { fwrite(&value, sizeof(value), 1, file); }
+
+    struct Capture {
+        std::string path;
+        GilbertElliott channel;
+        int8_t rssi;
+        std::set<uint64_t> received;
+    };
+
+    bool writeCapture(Capture &capture, const int nBlocks, const uint32_t seed) {
+        FILE *file = fopen(capture.path.c_str(), "wb");
+        if (!file) return false;
+        for (const uint32_t value : {0xa1b2c3d4u, 0x00040002u, 0u, 0u, 65535u, 127u}) put32(file, value);
+        std::mt19937 random(seed);
+        auto frame = MockRadioDevice::createFrame(LINK_ID, VIDEO_RADIO_PORT, PAYLOAD_SIZE);
+        RxInfo info;
+        info.freq = RxInfo::channelToFrequency(CHANNEL);
+        info.dataRate = Radiotap::RTL_HT_MCS0 + 1;
+        info.noise.fill(-92);
+        std::vector<uint8_t> packet;
+        const int64_t start = 1700000000LL * 1000000;
+        for (int block = 0; block < nBlocks; block++) {
+            for (int fragment = 0; fragment < FEC_N; fragment++) {
+                if (capture.channel.lost(random)) continue;
+                const uint64_t nonce = (uint64_t(block) << 8) | fragment;
+                MockRadioDevice::setNonce(frame, nonce);
+                capture.received.insert(nonce);
+                for (size_t i = 0; i < 2; i++) {
+                    info.antenna[i] = (uint8_t)i;
+                    info.rssi[i] = (int8_t)(capture.rssi - (int)(random() % 6));
+                }
+                packet.clear();
+                Radiotap::write(packet, info, true);
+                packet.insert(packet.end(), frame.begin(), frame.end());
+                const int64_t timestamp = start + (block * FEC_N + fragment) * FRAME_PERIOD_US;
+                put32(file, uint32_t(timestamp / 1000000));
+                put32(file, uint32_t(timestamp % 1000000));
+                put32(file, (uint32_t)packet.size());
+                put32(file, (uint32_t)packet.size());
+                fwrite(packet.data(), 1, packet.size(), file);
+            }
+        }
+        return fclose(file) == 0;
+    }
+
+    struct Result {
+        int nUnrecoverable = 0;
+        uint64_t nDelivered = 0;
+        // The same fragment handed to the aggregator twice
+        uint64_t nDuplicatesDelivered = 0;
+        RadioReceiver::DiversityStats diversity;
+    };
+
+    Result replay(const std::vector<std::string> &paths, const int nBlocks) {
+        Result result;
+        RadioReceiver receiver(PcapRadioDevice::openMerged(paths), nullptr);
+        std::vector<std::set<int>> fragments(nBlocks);
+        receiver.getDispatcher().registerHandler(LINK_ID, VIDEO_RADIO_PORT, [&](const uint8_t *payload, size_t, const RxInfo &) {
+            const uint64_t nonce = WfbPacket::nonce(payload);
+            result.nDelivered++;
+            if (!fragments[nonce >> 8].insert(int(nonce & 0xff)).second) result.nDuplicatesDelivered++;
+        });
+        receiver.run(CHANNEL);
+        for (const auto &block : fragments) {
+            if ((int)block.size() < FEC_K) result.nUnrecoverable++;
+        }
+        result.diversity = receiver.getDiversityStats();
+        return result;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    const int nBlocks = argc > 1 ? atoi(argv[1]) : 1500;
+    const std::string directory = argc > 2 ? argv[2] : "/tmp";
+    const uint32_t seed = argc > 3 ? (uint32_t)atoi(argv[3]) : 1;
+    // Two antennas with different polarisation: similar average loss, independent fades
+    std::vector<Capture> captures = {
+        {directory + "/diversity_adapter0.pcap", {0.02, 0.15, 0.01, 0.7}, -62, {}},
+        {directory + "/diversity_adapter1.pcap", {0.03, 0.2, 0.02, 0.6}, -66, {}},
+    };
+    for (size_t i = 0; i < captures.size(); i++) {
+        if (!writeCapture(captures[i], nBlocks, seed + (uint32_t)i)) {
+            printf("cannot write %s\n", captures[i].path.c_str());
+            return 1;
+        }
+    }
+    std::set<uint64_t> union_;
+    for (const auto &capture : captures) union_.insert(capture.received.begin(), capture.received.end());
+
+    bool ok = true;
+    int bestSingle = nBlocks;
+    for (size_t i = 0; i < captures.size(); i++) {
+        const Result result = replay({captures[i].path}, nBlocks);
+        bestSingle = std::min(bestSingle, result.nUnrecoverable);
+        printf("adapter %zu alone: fragments %llu/%d unrecoverable blocks %d/%d\n", i, (unsigned long long)result.nDelivered,
+               nBlocks * FEC_N, result.nUnrecoverable, nBlocks);
+        ok = ok && result.nDelivered == captures[i].received.size();
+    }
+    const auto before = steady_clock::now();
+    const Result merged = replay({captures[0].path, captures[1].path}, nBlocks);
+    const double seconds = duration<double>(steady_clock::now() - before).count();
+    printf("merged: fragments %llu/%d unrecoverable blocks %d/%d duplicates dropped %llu delivered twice %llu (%.2fs)\n",
+           (unsigned long long)merged.nDelivered, nBlocks * FEC_N, merged.nUnrecoverable, nBlocks,
+           (unsigned long long)merged.diversity.nDuplicates, (unsigned long long)merged.nDuplicatesDelivered, seconds);
+    for (size_t i = 0; i < captures.size(); i++) {
+        const auto &adapter = merged.diversity.adapters[i];
+        printf("  adapter %zu: frames %llu first %llu (%.1f%%) rssi %.1fdBm\n", i, (unsigned long long)adapter.nFrames,
+               (unsigned long long)adapter.nFirst, 100.0 * (double)adapter.nFirst / (double)std::max<uint64_t>(merged.nDelivered, 1),
+               adapter.getRssiAvg());
+    }
+    ok = ok && merged.nDuplicatesDelivered == 0 && merged.nDelivered == union_.size() && merged.nUnrecoverable <= bestSingle;
+    printf("diversity receive: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
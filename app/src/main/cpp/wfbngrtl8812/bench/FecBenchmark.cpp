@@ -0,0 +1,232 @@
+// Host benchmark of the Reed-Solomon FEC (ReedSolomon, GaloisField). First every kernel this CPU supports is checked
+// to be bit-identical to the scalar one (all coefficients, unaligned sizes and tails), and the field to be zfec's.
+// Then for typical wfb-ng (k, n) every path encodes and recovers every loss pattern of a block (a sample for large n)
+// of random fragments, which have to match the scalar path and the original data.
+// Finally each path is timed: encoding throughput (data bytes) and the recovery of a block that lost n - k data
+// fragments, the worst case the aggregator has to handle in a FEC recovery burst.
+//
+// Usage: FecBenchmark [nBlocks=2000] [fragmentSize=1400]
+
+#include "../GaloisField.h"
+#include "../ReedSolomon.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    using GaloisField::Path;
+    constexpr Path PATHS[] = {Path::SCALAR, Path::SSSE3, Path::AVX2, Path::NEON};
+
+    // Shift and add, reduced by x^8 + x^4 + x^3 + x^2 + 1
+    uint8_t mulReference(uint8_t a, uint8_t b) {
+        unsigned product = 0;
+        for (int i = 0; i < 8; i++) {
+            if (b & (1 << i)) product ^= unsigned(a) << i;
+        }
+        for (int i = 15; i >= 8; i--) {
+            if (product & (1u << i)) product ^= 0x11du << (i - 8);
+        }
+        return (uint8_t)product;
+    }
+
+    bool checkField() {
+        for (unsigned a = 0; a < 256; a++) {
+            for (unsigned b = 0; b < 256; b++) {
+                if (GaloisField::mul((uint8_t)a, (uint8_t)b) != mulReference((uint8_t)a, (uint8_t)b)) return false;
+            }
+            if (a != 0 && GaloisField::mul((uint8_t)a, GaloisField::inverse((uint8_t)a)) != 1) return false;
+        }
+        return true;
+    }
+
+    bool checkKernel(const Path path, std::mt19937 &random) {
+        const auto scalar = GaloisField::mulAddFunction(Path::SCALAR);
+        const auto kernel = GaloisField::mulAddFunction(path);
+        std::vector<uint8_t> src(2048 + 64);
+        std::vector<uint8_t> expected(src.size());
+        std::vector<uint8_t> actual(src.size());
+        for (auto &value : src) value = (uint8_t)random();
+        std::vector<size_t> sizes;
+        for (size_t size = 0; size <= 97; size++) sizes.push_back(size);
+        for (const size_t size : {1400, 1446, 2048}) sizes.push_back(size);
+        for (unsigned c = 0; c < 256; c++) {
+            for (const size_t size : sizes) {
+                const size_t offset = (c + size) % 4;
+                for (size_t i = 0; i < expected.size(); i++) expected[i] = actual[i] = (uint8_t)random();
+                scalar(expected.data() + offset, src.data() + 3 - offset, (uint8_t)c, size);
+                kernel(actual.data() + offset, src.data() + 3 - offset, (uint8_t)c, size);
+                if (expected != actual) return false;
+            }
+        }
+        return true;
+    }
+
+    struct Block {
+        std::vector<std::vector<uint8_t>> data;
+        std::vector<const uint8_t *> dataPointers;
+        Block(const unsigned k, const size_t size, std::mt19937 &random) : data(k, std::vector<uint8_t>(size)) {
+            for (auto &fragment : data) {
+                for (auto &value : fragment) value = (uint8_t)random();
+                dataPointers.push_back(fragment.data());
+            }
+        }
+    };
+
+    std::vector<std::vector<uint8_t>> encodeAll(const ReedSolomon &code, const Block &block, const size_t size) {
+        const unsigned k = code.getK();
+        const unsigned n = code.getN();
+        std::vector<std::vector<uint8_t>> parity(n - k, std::vector<uint8_t>(size));
+        std::vector<uint8_t *> parityPointers;
+        std::vector<unsigned> blockNums;
+        for (unsigned i = 0; i < n - k; i++) {
+            parityPointers.push_back(parity[i].data());
+            blockNums.push_back(k + i);
+        }
+        code.encode(block.dataPointers.data(), parityPointers.data(), blockNums.data(), blockNums.size(), size);
+        return parity;
+    }
+
+    // received: sorted block indices, at least k. Decodes from the first k like the aggregator
+    bool recover(const ReedSolomon &code, const Block &block, const std::vector<std::vector<uint8_t>> &parity,
+                 const std::vector<unsigned> &received, const size_t size) {
+        const unsigned k = code.getK();
+        std::vector<const uint8_t *> blocks(k, nullptr);
+        std::vector<unsigned> index(k, 0);
+        std::vector<unsigned> nextParity;
+        for (unsigned i = 0; i < k; i++) {
+            if (received[i] < k) {
+                blocks[received[i]] = block.data[received[i]].data();
+                index[received[i]] = received[i];
+            } else {
+                nextParity.push_back(received[i]);
+            }
+        }
+        std::vector<unsigned> missing;
+        for (unsigned i = 0, p = 0; i < k; i++) {
+            if (blocks[i]) continue;
+            missing.push_back(i);
+            blocks[i] = parity[nextParity[p] - k].data();
+            index[i] = nextParity[p++];
+        }
+        std::vector<std::vector<uint8_t>> recovered(missing.size(), std::vector<uint8_t>(size));
+        std::vector<uint8_t *> recoveredPointers;
+        for (auto &fragment : recovered) recoveredPointers.push_back(fragment.data());
+        if (!code.decode(blocks.data(), index.data(), recoveredPointers.data(), size)) return false;
+        for (size_t i = 0; i < missing.size(); i++) {
+            if (recovered[i] != block.data[missing[i]]) return false;
+        }
+        return true;
+    }
+
+    // Every loss pattern, or nSamples random ones
+    bool checkCode(const unsigned k, const unsigned n, const Path path, std::mt19937 &random, const size_t size) {
+        const ReedSolomon scalar(k, n, Path::SCALAR);
+        const ReedSolomon code(k, n, path);
+        const Block block(k, size, random);
+        const auto parity = encodeAll(code, block, size);
+        if (parity != encodeAll(scalar, block, size)) return false;
+        std::vector<unsigned> all(n);
+        for (unsigned i = 0; i < n; i++) all[i] = i;
+        if (n <= 16) {
+            for (unsigned mask = 0; mask < (1u << n); mask++) {
+                if ((unsigned)__builtin_popcount(mask) != k) continue;
+                std::vector<unsigned> received;
+                for (unsigned i = 0; i < n; i++) {
+                    if (mask & (1u << i)) received.push_back(i);
+                }
+                if (!recover(code, block, parity, received, size)) return false;
+            }
+            return true;
+        }
+        for (int sample = 0; sample < 500; sample++) {
+            std::shuffle(all.begin(), all.end(), random);
+            std::vector<unsigned> received(all.begin(), all.begin() + k);
+            std::sort(received.begin(), received.end());
+            if (!recover(code, block, parity, received, size)) return false;
+        }
+        return true;
+    }
+
+    struct Timing {
+        double encodeMBytesPerSecond;
+        double decodeMBytesPerSecond;
+        double decodeUs;
+    };
+
+    Timing time(const unsigned k, const unsigned n, const Path path, const int nBlocks, const size_t size) {
+        std::mt19937 random(k * n);
+        const ReedSolomon code(k, n, path);
+        const Block block(k, size, random);
+        auto parity = encodeAll(code, block, size);
+        std::vector<uint8_t *> parityPointers;
+        std::vector<unsigned> blockNums;
+        for (unsigned i = 0; i < n - k; i++) {
+            parityPointers.push_back(parity[i].data());
+            blockNums.push_back(k + i);
+        }
+        auto before = steady_clock::now();
+        for (int i = 0; i < nBlocks; i++) {
+            code.encode(block.dataPointers.data(), parityPointers.data(), blockNums.data(), blockNums.size(), size);
+        }
+        const double encodeSeconds = duration<double>(steady_clock::now() - before).count();
+        // The first n - k data fragments lost, replaced by all parity fragments
+        const unsigned nLost = std::min(n - k, k);
+        std::vector<const uint8_t *> blocks(block.dataPointers);
+        std::vector<unsigned> index(k);
+        for (unsigned i = 0; i < k; i++) {
+            index[i] = i < nLost ? k + i : i;
+            if (i < nLost) blocks[i] = parity[i].data();
+        }
+        std::vector<std::vector<uint8_t>> recovered(nLost, std::vector<uint8_t>(size));
+        std::vector<uint8_t *> recoveredPointers;
+        for (auto &fragment : recovered) recoveredPointers.push_back(fragment.data());
+        before = steady_clock::now();
+        for (int i = 0; i < nBlocks; i++) {
+            code.decode(blocks.data(), index.data(), recoveredPointers.data(), size);
+        }
+        const double decodeSeconds = duration<double>(steady_clock::now() - before).count();
+        const double dataMBytes = double(k) * (double)size * nBlocks / (1024.0 * 1024.0);
+        return {dataMBytes / encodeSeconds, dataMBytes / decodeSeconds, decodeSeconds / nBlocks * 1e6};
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    const int nBlocks = argc > 1 ? atoi(argv[1]) : 2000;
+    const size_t fragmentSize = argc > 2 ? (size_t)atoi(argv[2]) : 1400;
+    const std::pair<unsigned, unsigned> CODES[] = {{1, 2}, {4, 6}, {8, 12}, {16, 24}, {32, 48}};
+
+    bool ok = checkField();
+    printf("field: %s\n", ok ? "ok" : "FAILED");
+    std::mt19937 random(1);
+    for (const Path path : PATHS) {
+        if (!GaloisField::isSupported(path)) {
+            printf("%-6s not supported\n", GaloisField::pathName(path));
+            continue;
+        }
+        bool same = checkKernel(path, random);
+        for (const auto &[k, n] : CODES) {
+            same = same && checkCode(k, n, path, random, fragmentSize);
+        }
+        printf("%-6s bit-exact kernel and recovery: %s\n", GaloisField::pathName(path), same ? "yes" : "NO");
+        ok = ok && same;
+    }
+    printf("auto: %s\n", GaloisField::pathName(GaloisField::resolve(Path::AUTO)));
+    for (const auto &[k, n] : CODES) {
+        const Timing scalar = time(k, n, Path::SCALAR, nBlocks, fragmentSize);
+        for (const Path path : PATHS) {
+            if (!GaloisField::isSupported(path)) continue;
+            const Timing timing = path == Path::SCALAR ? scalar : time(k, n, path, nBlocks, fragmentSize);
+            printf("%2u/%-2u %-6s encode %7.0fMB/s decode %7.0fMB/s, recover %u fragments %7.2fus (%.1fx)\n", k, n,
+                   GaloisField::pathName(path), timing.encodeMBytesPerSecond, timing.decodeMBytesPerSecond, std::min(n - k, k),
+                   timing.decodeUs, scalar.decodeUs / timing.decodeUs);
+        }
+    }
+    printf("fec: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+// Host benchmark of the FEC hold time limit (FecReassembler::Options::maxHoldTime). A capture is replayed in virtual time
+// (its timestamps, an update() tick every millisecond between fragments) once with wfb-ng's policy (a lossy block
+// holds everything behind it until the ring overflows) and once per hold time. Prints how often the deadline gave a
+// block up, the hold time of the received data fragments (arrival to emission) and the latency saved against wfb-ng's
+// policy, and the data fragments that were lost, which is what the limit costs.
+// Without a capture a wfb-ng stream with real parity (ReedSolomon) and burst losses (Gilbert-Elliott) is generated and
+// recorded with PcapngRecorder first: there every emitted fragment also has to match what was sent (zero padded if
+// recovered). In every run the fragments have to come out in order, each at most once.
+// Finally the generated stream is replayed with a transmitter restart (new session packet, block index 0 again) after a
+// few blocks: nothing after it may be discarded as late.
+// Captures (pcap or pcapng, 802.11 or radiotap) are replayed as they are: the fragments are still encrypted, so only
+// the timing is meaningful.
+//
+// Usage: FecHoldBenchmark [capture=generated] [radioPort=0] [k=8] [n=12] [nBlocks=5000] [fragmentPeriodUs=250]
+
+#include "../FecReassembler.h"
+#include "../MockRadioDevice.h"
+#include "../PcapFile.h"
+#include "../PcapngRecorder.h"
+#include "../Radiotap.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <random>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+    constexpr uint32_t LINK_ID = 7669206;
+    constexpr size_t HEADER_SIZE = WfbPacket::NONCE + WfbPacket::NONCE_SIZE;
+    constexpr size_t MAX_FRAGMENT_SIZE = 1400;
+
+    struct Fragment {
+        microseconds time;
+        uint64_t nonce;
+        std::vector<uint8_t> data;
+        // data is a whole session packet, nonce unused
+        bool session;
+    };
+
+    // Stands in for the encrypted session announcement, which only changes with the session key
+    std::vector<uint8_t> sessionPacket(const uint8_t key) {
+        std::vector<uint8_t> packet(1 + 24 + 48, key);
+        packet[0] = WfbPacket::TYPE_SESSION;
+        return packet;
+    }
+
+    // What was sent, by nonce
+    using Sent = std::map<uint64_t, std::vector<uint8_t>>;
+
+    // Losses in bursts: 1% in the good state, 50% in the bad one, which lasts 10 fragments on average
+    class GilbertElliott {
+      public:
+        bool lost(std::mt19937 &random) {
+            std::uniform_real_distribution<double> uniform;
+            mBad = mBad ? uniform(random) >= 0.1 : uniform(random) < 0.005;
+            return uniform(random) < (mBad ? 0.5 : 0.01);
+        }
+
+      private:
+        bool mBad = false;
+    };
+
+    // Writes the received fragments of nBlocks blocks to path, one every fragmentPeriod
+    bool generate(const std::string &path, const unsigned k, const unsigned n, const int nBlocks,
+                  const microseconds fragmentPeriod, Sent &sent) {
+        PcapngRecorder recorder;
+        if (!recorder.start(path)) return false;
+        const ReedSolomon code(k, n);
+        std::mt19937 random(1);
+        GilbertElliott channel;
+        RxInfo info;
+        info.rssi[0] = -60;
+        info.noise[0] = -92;
+        const auto captureStart = system_clock::now();
+        std::vector<std::vector<uint8_t>> fragments(n, std::vector<uint8_t>(MAX_FRAGMENT_SIZE));
+        std::vector<size_t> sizes(n);
+        std::vector<const uint8_t *> data(k);
+        std::vector<uint8_t *> parity(n - k);
+        std::vector<unsigned> blockNums(n - k);
+        uint64_t nFrames = 0;
+        const auto session = sessionPacket(1);
+        for (int block = 0; block < nBlocks; block++) {
+            // Announced every 100 blocks, like wfb-ng does about once per second
+            if (block % 100 == 0) {
+                auto frame = MockRadioDevice::createFrame(LINK_ID, 0, session.size());
+                memcpy(frame.data() + WfbHeader::SIZE, session.data(), session.size());
+                recorder.onFrame(frame, info, captureStart + fragmentPeriod * (block * n));
+            }
+            // Video packets of varying size, the parity has the size of the largest
+            size_t maxSize = 0;
+            for (unsigned i = 0; i < k; i++) {
+                sizes[i] = 100 + random() % (MAX_FRAGMENT_SIZE - 99);
+                maxSize = std::max(maxSize, sizes[i]);
+                for (size_t j = 0; j < MAX_FRAGMENT_SIZE; j++) fragments[i][j] = j < sizes[i] ? (uint8_t)random() : 0;
+                data[i] = fragments[i].data();
+            }
+            for (unsigned i = k; i < n; i++) {
+                sizes[i] = maxSize;
+                parity[i - k] = fragments[i].data();
+                blockNums[i - k] = i;
+            }
+            code.encode(data.data(), parity.data(), blockNums.data(), n - k, maxSize);
+            for (unsigned i = 0; i < n; i++) {
+                const uint64_t nonce = (uint64_t(block) << 8) | i;
+                if (i < k) sent[nonce].assign(fragments[i].begin(), fragments[i].begin() + sizes[i]);
+                if (channel.lost(random)) continue;
+                auto frame = MockRadioDevice::createFrame(LINK_ID, 0, HEADER_SIZE + sizes[i]);
+                MockRadioDevice::setNonce(frame, nonce);
+                memcpy(frame.data() + WfbHeader::SIZE + HEADER_SIZE, fragments[i].data(), sizes[i]);
+                recorder.onFrame(frame, info, captureStart + fragmentPeriod * (block * n + i));
+                // Lets the I/O thread keep up instead of dropping
+                if (++nFrames % 256 == 0) std::this_thread::sleep_for(milliseconds(1));
+            }
+        }
+        recorder.stop();
+        recorder.waitUntilClosed();
+        const auto stats = recorder.getStats();
+        printf("generated %d blocks %u/%u: %llu of %llu fragments received, %llu dropped by the recorder\n", nBlocks, k, n,
+               (unsigned long long)stats.nFramesRecorded, (unsigned long long)nBlocks * n,
+               (unsigned long long)stats.nFramesDropped);
+        return stats.nFramesDropped == 0 && stats.nWriteErrors == 0;
+    }
+
+    // The data and session packets of radioPort, time relative to the first packet of the capture
+    bool load(const std::string &path, const uint8_t radioPort, std::vector<Fragment> &fragments) {
+        PcapReader reader;
+        if (!reader.open(path)) return false;
+        const bool radiotap = reader.getLinkType() == PcapReader::LINKTYPE_IEEE802_11_RADIOTAP;
+        if (!radiotap && reader.getLinkType() != PcapReader::LINKTYPE_IEEE802_11) return false;
+        PcapReader::Packet packet;
+        int64_t start = -1;
+        while (reader.next(packet)) {
+            if (start < 0) start = packet.timestampUs;
+            Radiotap::Parsed parsed;
+            if (radiotap && !Radiotap::parse(packet.data.data(), packet.data.size(), parsed)) continue;
+            // Like PcapRadioDevice: plain 802.11 captures are expected to have the FCS
+            const size_t fcsSize = radiotap && !parsed.hasFcs ? 0 : WfbHeader::FCS_SIZE;
+            if (packet.data.size() < parsed.length + WfbHeader::SIZE + fcsSize + HEADER_SIZE) continue;
+            const uint8_t *frame = packet.data.data() + parsed.length;
+            const size_t payloadSize = packet.data.size() - parsed.length - WfbHeader::SIZE - fcsSize;
+            const uint8_t *payload = frame + WfbHeader::SIZE;
+            if (frame[WfbHeader::SRC_MAC] != WfbHeader::MAGIC[0] || frame[WfbHeader::SRC_MAC + 1] != WfbHeader::MAGIC[1] ||
+                frame[WfbHeader::SRC_RADIO_PORT] != radioPort) {
+                continue;
+            }
+            const microseconds time(packet.timestampUs - start);
+            if (payload[0] == WfbPacket::TYPE_SESSION) {
+                fragments.push_back({time, 0, std::vector<uint8_t>(payload, payload + payloadSize), true});
+            } else if (payload[0] == WfbPacket::TYPE_DATA) {
+                fragments.push_back({time, WfbPacket::nonce(payload), std::vector<uint8_t>(payload + HEADER_SIZE, payload + payloadSize), false});
+            }
+        }
+        return true;
+    }
+
+    struct Result {
+        FecReassembler::Stats stats;
+        std::vector<microseconds> holds;
+        // By nonce
+        std::map<uint64_t, microseconds> emitted;
+        bool inOrder = true;
+        bool sameData = true;
+    };
+
+    Result replay(const std::vector<Fragment> &fragments, FecReassembler::Options options, const Sent *sent) {
+        Result result;
+        uint64_t last = 0;
+        bool first = true;
+        FecReassembler::TIME_POINT now;
+        FecReassembler reassembler(options, [&](uint64_t block, unsigned fragment, const uint8_t *data, size_t size,
+                                                microseconds hold) {
+            const uint64_t nonce = (block << 8) | fragment;
+            result.inOrder = result.inOrder && (first || nonce > last);
+            first = false;
+            last = nonce;
+            result.emitted[nonce] = duration_cast<microseconds>(now.time_since_epoch());
+            result.holds.push_back(hold);
+            if (sent == nullptr) return;
+            const auto it = sent->find(nonce);
+            const bool same = it != sent->end() && size >= it->second.size() &&
+                              memcmp(data, it->second.data(), it->second.size()) == 0 &&
+                              std::all_of(data + it->second.size(), data + size, [](uint8_t value) { return value == 0; });
+            result.sameData = result.sameData && same;
+        });
+        FecReassembler::TIME_POINT nextTick;
+        for (const Fragment &fragment : fragments) {
+            const FecReassembler::TIME_POINT arrival(fragment.time);
+            for (; nextTick < arrival; nextTick += milliseconds(1)) {
+                now = nextTick;
+                reassembler.update(now);
+            }
+            now = arrival;
+            if (fragment.session) {
+                reassembler.onSessionPacket(fragment.data.data(), fragment.data.size(), now);
+            } else {
+                reassembler.onFragment(fragment.nonce, fragment.data.data(), fragment.data.size(), now);
+            }
+        }
+        reassembler.flush(now);
+        result.stats = reassembler.getStats();
+        return result;
+    }
+
+    double percentile(std::vector<microseconds> values, const double p) {
+        if (values.empty()) return 0;
+        std::sort(values.begin(), values.end());
+        return (double)values[size_t(p / 100 * (double)(values.size() - 1))].count() / 1000.0;
+    }
+
+    double average(const Result &result) {
+        const uint64_t nReceived = result.stats.nEmitted - result.stats.nRecovered;
+        return nReceived == 0 ? 0 : (double)result.stats.totalHold.count() / (double)nReceived / 1000.0;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string capture = argc > 1 ? argv[1] : "";
+    const uint8_t radioPort = argc > 2 ? (uint8_t)atoi(argv[2]) : 0;
+    FecReassembler::Options options;
+    options.k = argc > 3 ? (unsigned)atoi(argv[3]) : 8;
+    options.n = argc > 4 ? (unsigned)atoi(argv[4]) : 12;
+    const int nBlocks = argc > 5 ? atoi(argv[5]) : 5000;
+    const microseconds fragmentPeriod(argc > 6 ? atoi(argv[6]) : 250);
+
+    bool ok = true;
+    Sent sent;
+    std::string path = capture;
+    if (path.empty()) {
+        path = "/tmp/fec_hold.pcapng";
+        ok = generate(path, options.k, options.n, nBlocks, fragmentPeriod, sent);
+    }
+    std::vector<Fragment> fragments;
+    if (!load(path, radioPort, fragments)) {
+        printf("cannot read %s\n", path.c_str());
+        return 1;
+    }
+    printf("replaying %zu fragments of radio port %u, %.1fs\n", fragments.size(), radioPort,
+           fragments.empty() ? 0.0 : duration<double>(fragments.back().time).count());
+    const Sent *expected = capture.empty() ? &sent : nullptr;
+
+    const Result reference = replay(fragments, options, expected);
+    for (const int holdMs : {0, 50, 20, 10, 5, 2}) {
+        options.maxHoldTime = milliseconds(holdMs);
+        const Result result = holdMs == 0 ? reference : replay(fragments, options, expected);
+        const auto &stats = result.stats;
+        // Of the fragments both emitted, how much earlier they came out
+        std::vector<microseconds> saved;
+        for (const auto &[nonce, time] : result.emitted) {
+            const auto it = reference.emitted.find(nonce);
+            if (it != reference.emitted.end()) saved.push_back(it->second - time);
+        }
+        char name[16];
+        snprintf(name, sizeof(name), holdMs == 0 ? "no limit" : "%dms", holdMs);
+        printf("%-8s deadline give ups %5llu overflow %5llu | hold avg %6.2fms p99 %7.2fms max %7.2fms | saved avg %6.2fms "
+               "p99 %7.2fms | emitted %llu recovered %llu lost %llu\n",
+               name, (unsigned long long)stats.nDeadlineGiveUps, (unsigned long long)stats.nOverflowGiveUps, average(result),
+               percentile(result.holds, 99), (double)stats.maxHold.count() / 1000.0,
+               saved.empty() ? 0.0 : (double)std::accumulate(saved.begin(), saved.end(), microseconds(0)).count() /
+                                         (double)saved.size() / 1000.0,
+               percentile(saved, 99), (unsigned long long)stats.nEmitted, (unsigned long long)stats.nRecovered,
+               (unsigned long long)stats.nLost);
+        bool same = result.inOrder && result.sameData && stats.nEmitted == result.emitted.size();
+        if (expected) {
+            same = same && stats.nEmitted + stats.nLost == (uint64_t)nBlocks * options.k;
+        }
+        if (!same) printf("%-8s out of order, repeated or wrong data\n", name);
+        ok = ok && same;
+    }
+    if (expected) {
+        // The transmitter restarts with a new session key after RESTART_AFTER blocks, less than the ring: the block
+        // index starts over at 0 and everything after has to come out as well
+        constexpr uint64_t RESTART_AFTER = 20;
+        std::vector<Fragment> restarted;
+        for (const Fragment &fragment : fragments) {
+            if (!fragment.session && (fragment.nonce >> 8) >= RESTART_AFTER) break;
+            restarted.push_back(fragment);
+        }
+        const microseconds restart = restarted.back().time + milliseconds(10);
+        restarted.push_back({restart, 0, sessionPacket(2), true});
+        for (const Fragment &fragment : fragments) {
+            if (fragment.session) continue;
+            restarted.push_back(fragment);
+            restarted.back().time += restart;
+        }
+        options.maxHoldTime = microseconds(0);
+        const auto stats = replay(restarted, options, expected).stats;
+        const bool restartOk = stats.nRestarts == 1 &&
+                               stats.nEmitted + stats.nLost == (RESTART_AFTER + (uint64_t)nBlocks) * options.k;
+        printf("restart  emitted %llu lost %llu restarts %llu %s\n", (unsigned long long)stats.nEmitted,
+               (unsigned long long)stats.nLost, (unsigned long long)stats.nRestarts, restartOk ? "ok" : "FAILED");
+        ok = ok && restartOk;
+    }
+    printf("fec hold: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
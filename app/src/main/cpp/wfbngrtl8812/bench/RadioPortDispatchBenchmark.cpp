@@ -0,0 +1,92 @@
+// Host benchmark of the frame classification in front of the aggregators: frames per second through the
+// RadioPortDispatcher, compared to the linear scan it replaced (validate, then a 12 byte compare per registered stream).
+// The frames are a mix of the registered streams (the last one registered gets the most traffic, which is the worst
+// case for the scan), frames of another link on the same ports and frames on unregistered ports.
+//
+// Usage: RadioPortDispatchBenchmark [nFrames=2000000]
+
+#include "../MockRadioDevice.h"
+#include "../RadioPortDispatcher.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+    constexpr uint32_t LINK_ID = 7669206;
+    constexpr uint32_t OTHER_LINK_ID = 1234567;
+    constexpr size_t FRAME_SIZE = 1500;
+
+    std::vector<uint8_t> createFrame(const uint32_t linkId, const uint8_t radioPort) {
+        return MockRadioDevice::createFrame(linkId, radioPort, FRAME_SIZE - WfbHeader::SIZE - WfbHeader::FCS_SIZE);
+    }
+
+    // What WfbngLink did before the dispatcher
+    struct LinearScan {
+        std::vector<std::array<uint8_t, 4>> channelIds;
+        std::vector<uint64_t> nDispatched;
+        bool dispatch(const std::span<uint8_t> data) {
+            const RxFrame frame(data);
+            if (!frame.IsValidWfbFrame()) return false;
+            for (size_t i = 0; i < channelIds.size(); i++) {
+                const uint8_t *id = channelIds[i].data();
+                if (data[10] == 0x57 && data[11] == 0x42 && data[12] == id[0] && data[13] == id[1] && data[14] == id[2] &&
+                    data[15] == id[3] && data[16] == 0x57 && data[17] == 0x42 && data[18] == id[0] && data[19] == id[1] &&
+                    data[20] == id[2] && data[21] == id[3]) {
+                    nDispatched[i]++;
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    template <typename DISPATCH> double framesPerSecond(std::vector<std::vector<uint8_t>> &frames, const size_t nFrames, DISPATCH dispatch, size_t &nDispatched) {
+        nDispatched = 0;
+        const auto before = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < nFrames; i++) {
+            auto &frame = frames[i % frames.size()];
+            nDispatched += dispatch(std::span<uint8_t>(frame));
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+        return nFrames / seconds;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    const size_t nFrames = argc > 1 ? (size_t)atoll(argv[1]) : 2000000;
+    bool sameResult = true;
+    for (const size_t nStreams : {2, 4, 8}) {
+        std::vector<uint8_t> ports;
+        for (size_t i = 0; i < nStreams; i++) ports.push_back(uint8_t(i * 0x10));
+        // 80% for the last registered stream, the rest spread over the others, another link and unregistered ports
+        std::mt19937 random(42);
+        std::vector<std::vector<uint8_t>> frames;
+        for (int i = 0; i < 4096; i++) {
+            const int kind = (int)(random() % 100);
+            if (kind < 80) frames.push_back(createFrame(LINK_ID, ports.back()));
+            else if (kind < 90) frames.push_back(createFrame(LINK_ID, ports[random() % ports.size()]));
+            else if (kind < 95) frames.push_back(createFrame(OTHER_LINK_ID, ports[random() % ports.size()]));
+            else frames.push_back(createFrame(LINK_ID, 0xF1));
+        }
+        uint64_t handled = 0;
+        RadioPortDispatcher dispatcher;
+        LinearScan scan;
+        for (const auto port : ports) {
+            dispatcher.registerHandler(LINK_ID, port, [&handled](const uint8_t *, size_t payloadSize, const RxInfo &) { handled += payloadSize; });
+            const uint32_t channelId = WfbHeader::channelId(LINK_ID, port);
+            scan.channelIds.push_back({uint8_t(channelId >> 24), uint8_t(channelId >> 16), uint8_t(channelId >> 8), uint8_t(channelId)});
+            scan.nDispatched.push_back(0);
+        }
+        size_t nDispatchedTable, nDispatchedScan;
+        const double table = framesPerSecond(frames, nFrames, [&dispatcher, info = RxInfo{}](std::span<uint8_t> data) { return dispatcher.dispatch(data, info); }, nDispatchedTable);
+        const double linear = framesPerSecond(frames, nFrames, [&scan](std::span<uint8_t> data) { return scan.dispatch(data); }, nDispatchedScan);
+        if (nDispatchedTable != nDispatchedScan) sameResult = false;
+        const auto &stats = dispatcher.getStats();
+        printf("streams:%zu dispatch table:%.1fM frames/s linear scan:%.1fM frames/s dispatched:%zu other link:%llu unknown port:%llu\n", nStreams,
+               table / 1e6, linear / 1e6, nDispatchedTable, (unsigned long long)stats.nOtherLink, (unsigned long long)stats.nUnknownPort);
+    }
+    printf("same classification: %s\n", sameResult ? "yes" : "NO");
+    return sameResult ? 0 : 1;
+}
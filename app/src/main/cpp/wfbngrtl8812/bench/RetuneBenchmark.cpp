@@ -0,0 +1,82 @@
+// Host benchmark of the channel retune control flow, with a MockRadioDevice instead of the adapter.
+// A transmitter sends video on every channel the volume keys cycle through. The receiver is retuned from channel to
+// channel while receiving. Once a frame of the new channel was dispatched no frame of the old one may follow, and the device
+// must never be re-initialized (receive() called once).
+// Prints the time to reprogram the channel and the time until the first frame was dispatched after each retune.
+//
+// Usage: RetuneBenchmark [nRetunes=28] [programLatencyUs=2000] [framePeriodUs=200]
+
+#include "../MockRadioDevice.h"
+#include "../RadioReceiver.h"
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+    constexpr uint32_t LINK_ID = 7669206;
+    constexpr uint8_t VIDEO_RADIO_PORT = 0;
+    const std::vector<uint8_t> CHANNELS = {36, 40, 44, 48, 52, 56, 60, 64, 100, 104, 108, 112, 116, 120,
+                                           124, 128, 132, 136, 140, 144, 149, 153, 157, 161, 165, 169, 171, 173};
+} // namespace
+
+int main(int argc, char **argv) {
+    const int nRetunes = argc > 1 ? atoi(argv[1]) : 28;
+    MockRadioDevice::Options options;
+    options.programLatency = microseconds(argc > 2 ? atoi(argv[2]) : 2000);
+    options.framePeriod = microseconds(argc > 3 ? atoi(argv[3]) : 200);
+    for (const auto channel : CHANNELS) {
+        options.transmitters.push_back({LINK_ID, VIDEO_RADIO_PORT, channel});
+    }
+    auto device = std::make_unique<MockRadioDevice>(options);
+    MockRadioDevice &mock = *device;
+    RadioReceiver receiver(std::move(device), std::make_shared<SignalQuality>());
+    std::atomic<uint8_t> expectedChannel{CHANNELS[0]};
+    // Frames received until the mock starts reprogramming are still on the previous channel
+    std::atomic<uint8_t> previousChannel{CHANNELS[0]};
+    std::atomic<uint8_t> lastChannel{0};
+    std::atomic<uint64_t> nWrongChannel{0};
+    std::atomic<uint32_t> lastFreq{0};
+    receiver.getDispatcher().registerHandler(LINK_ID, VIDEO_RADIO_PORT, [&](const uint8_t *payload, size_t, const RxInfo &info) {
+        const uint8_t channel = payload[MockRadioDevice::CHANNEL_OFFSET];
+        const bool previous = channel == previousChannel && lastChannel != expectedChannel;
+        if (channel != expectedChannel && !previous) {
+            nWrongChannel++;
+        }
+        lastChannel = channel;
+        lastFreq = info.freq;
+    });
+    std::thread receiveThread([&receiver] { receiver.run(CHANNELS[0]); });
+    while (lastChannel != CHANNELS[0]) std::this_thread::sleep_for(milliseconds(1));
+
+    double sumProgramMs = 0, sumFirstFrameMs = 0, maxFirstFrameMs = 0;
+    for (int i = 1; i <= nRetunes; i++) {
+        const uint8_t channel = CHANNELS[i % CHANNELS.size()];
+        previousChannel = expectedChannel.load();
+        expectedChannel = channel;
+        receiver.retune(channel);
+        RadioReceiver::RetuneStats stats;
+        do {
+            std::this_thread::sleep_for(microseconds(100));
+            stats = receiver.getRetuneStats();
+        } while (stats.lastFirstFrame.count() == 0);
+        sumProgramMs += stats.lastProgram.count() / 1000.0;
+        sumFirstFrameMs += stats.lastFirstFrame.count() / 1000.0;
+        maxFirstFrameMs = std::max(maxFirstFrameMs, stats.lastFirstFrame.count() / 1000.0);
+    }
+    // The frequency handed to the aggregators follows the channel
+    std::this_thread::sleep_for(milliseconds(10));
+    const bool freqFollowed = lastFreq == RxInfo::channelToFrequency(expectedChannel);
+    receiver.stop();
+    receiveThread.join();
+
+    const auto stats = receiver.getRetuneStats();
+    printf("retunes:%llu failed:%llu program avg:%.2fms max:%.2fms first frame avg:%.2fms max:%.2fms\n", (unsigned long long)stats.nRetunes,
+           (unsigned long long)stats.nFailed, sumProgramMs / nRetunes, stats.maxProgram.count() / 1000.0, sumFirstFrameMs / nRetunes, maxFirstFrameMs);
+    printf("device initializations:%d frames from the wrong channel:%llu dispatched:%llu freq:%uMHz\n", mock.nReceiveCalls.load(),
+           (unsigned long long)nWrongChannel.load(), (unsigned long long)receiver.getDispatcher().getStats().nDispatched, lastFreq.load());
+    const bool ok = mock.nReceiveCalls == 1 && nWrongChannel == 0 && stats.nRetunes == (uint64_t)nRetunes && freqFollowed;
+    printf("retune control flow: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
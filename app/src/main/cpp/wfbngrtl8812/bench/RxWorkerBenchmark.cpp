@@ -0,0 +1,129 @@
+// Host benchmark of the receive path at a high bitrate: frames arrive at a fixed rate, the "USB thread" handles them
+// either inline (dispatch(): classification, decryption and FEC on the USB thread, as before) or hands them to the
+// RxFrameWorker. The handler spins for the decryption time of each frame and, every fecEvery frames, for a FEC block
+// recovery. Whenever the USB thread is more than fifoFrames frames behind the arrivals, the adapter's RX FIFO would
+// have overflowed and the frame is counted as lost.
+// Prints the time the USB thread spends per frame, the FIFO overflows and the worker queue occupancy / drops.
+// Needs at least 2 cores, otherwise the worker only competes with the USB thread for the same one.
+//
+// Usage: RxWorkerBenchmark [nFrames=50000] [framePeriodUs=60] [decryptUs=8] [fecRecoveryUs=3000] [fecEvery=500] [fifoFrames=16]
+
+#include "../MockRadioDevice.h"
+#include "../RadioPortDispatcher.h"
+#include "../RxFrameWorker.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+    constexpr uint32_t LINK_ID = 7669206;
+    constexpr uint8_t VIDEO_RADIO_PORT = 0;
+    constexpr size_t PAYLOAD_SIZE = 1400;
+
+    struct Options {
+        int nFrames;
+        microseconds framePeriod;
+        microseconds decrypt;
+        microseconds fecRecovery;
+        int fecEvery;
+        int fifoFrames;
+    };
+
+    void spin(const nanoseconds duration) {
+        const auto end = steady_clock::now() + duration;
+        while (steady_clock::now() < end) {
+        }
+    }
+
+    struct Result {
+        std::vector<double> usbTimeUs;
+        int nFifoOverflows = 0;
+        uint64_t nHandled = 0;
+    };
+
+    // useWorker: the handler runs on the RxFrameWorker, otherwise on the calling (USB) thread
+    Result run(const Options &options, const bool useWorker, RxFrameWorker::Stats &workerStats) {
+        std::atomic<uint64_t> nHandled{0};
+        RadioPortDispatcher dispatcher;
+        dispatcher.registerHandler(LINK_ID, VIDEO_RADIO_PORT, [&](const uint8_t *, size_t, const RxInfo &) {
+            const uint64_t n = ++nHandled;
+            spin(options.decrypt);
+            if (n % options.fecEvery == 0) spin(options.fecRecovery);
+        });
+        RxFrameWorker worker([&dispatcher](uint8_t radioPort, const uint8_t *payload, size_t payloadSize, const RxInfo &info) {
+            dispatcher.handle(radioPort, payload, payloadSize, info);
+        });
+        if (useWorker) worker.start();
+        auto frame = MockRadioDevice::createFrame(LINK_ID, VIDEO_RADIO_PORT, PAYLOAD_SIZE);
+        const std::span<uint8_t> data(frame);
+        const RxInfo info;
+        Result result;
+        result.usbTimeUs.reserve(options.nFrames);
+        const auto start = steady_clock::now();
+        for (int i = 0; i < options.nFrames; i++) {
+            const auto arrival = start + options.framePeriod * i;
+            auto now = steady_clock::now();
+            while (now < arrival) now = steady_clock::now();
+            if (now - arrival > options.framePeriod * options.fifoFrames) {
+                // Overwritten in the adapter before we got to it
+                result.nFifoOverflows++;
+                continue;
+            }
+            if (useWorker) {
+                const int radioPort = dispatcher.classify(data);
+                if (radioPort >= 0) {
+                    worker.push((uint8_t)radioPort, data.data() + WfbHeader::SIZE, data.size() - WfbHeader::SIZE - WfbHeader::FCS_SIZE, info);
+                }
+            } else {
+                dispatcher.dispatch(data, info);
+            }
+            result.usbTimeUs.push_back(duration<double, std::micro>(steady_clock::now() - now).count());
+        }
+        worker.stop();
+        workerStats = worker.getStats();
+        result.nHandled = nHandled;
+        return result;
+    }
+
+    double percentile(std::vector<double> values, const double p) {
+        if (values.empty()) return 0;
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (size_t)(p / 100.0 * (double)values.size()))];
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    options.nFrames = argc > 1 ? atoi(argv[1]) : 50000;
+    options.framePeriod = microseconds(argc > 2 ? atoi(argv[2]) : 60);
+    options.decrypt = microseconds(argc > 3 ? atoi(argv[3]) : 8);
+    options.fecRecovery = microseconds(argc > 4 ? atoi(argv[4]) : 3000);
+    options.fecEvery = argc > 5 ? atoi(argv[5]) : 500;
+    options.fifoFrames = argc > 6 ? atoi(argv[6]) : 16;
+    printf("%d frames every %lldus, decrypt %lldus, FEC recovery %lldus every %d frames, RX FIFO %d frames\n", options.nFrames,
+           (long long)options.framePeriod.count(), (long long)options.decrypt.count(), (long long)options.fecRecovery.count(), options.fecEvery,
+           options.fifoFrames);
+    if (std::thread::hardware_concurrency() < 2) {
+        printf("only %u core, the worker cannot run in parallel to the USB thread\n", std::thread::hardware_concurrency());
+    }
+    bool accounted = true;
+    for (const bool useWorker : {false, true}) {
+        RxFrameWorker::Stats workerStats;
+        const Result result = run(options, useWorker, workerStats);
+        printf("%-7s USB thread per frame p50:%.2fus p99:%.2fus max:%.1fus FIFO overflows:%d handled:%llu", useWorker ? "worker" : "inline",
+               percentile(result.usbTimeUs, 50), percentile(result.usbTimeUs, 99), percentile(result.usbTimeUs, 100), result.nFifoOverflows,
+               (unsigned long long)result.nHandled);
+        // Every frame is either handled or counted as lost
+        const uint64_t nLost = result.nFifoOverflows + workerStats.nDropped + workerStats.nTooLarge;
+        accounted = accounted && result.nHandled + nLost == (uint64_t)options.nFrames;
+        if (useWorker) {
+            printf(" queue max:%zu/%zu dropped:%llu", workerStats.maxOccupancy, RxFrameWorker::N_BUFFERS, (unsigned long long)workerStats.nDropped);
+        }
+        printf("\n");
+    }
+    printf("all frames accounted for: %s\n", accounted ? "yes" : "NO");
+    return accounted ? 0 : 1;
+}
@@ -7,4 +7,7 @@ public class NativeRecorder {
 
     public native void startRecordingNative();
     public native void stopRecordingNative();
+    // Raw capture of the received wfb-ng frames (pcapng), for link debugging
+    public native void startCaptureNative();
+    public native void stopCaptureNative();
 }